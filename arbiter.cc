@@ -0,0 +1,224 @@
+import <iostream>;
+import <string>;
+import <chrono>;
+import <exception>;
+
+import types;
+import cli;
+import game;
+import engine;
+import errors;
+
+using namespace std;
+
+// ArbiterOptions holds the match settings parsed from argv
+struct ArbiterOptions
+{
+    string engines[2];
+    int games;
+    chrono::milliseconds movetime;
+    chrono::milliseconds grace; // allowance on top of movetime for the pipes and the scheduler
+    int maxPlies;
+    CommandLineOptions setup;
+};
+
+static ArbiterOptions parseArbiterOptions(int argc, char *argv[])
+{
+    ArbiterOptions opts{{"", ""}, 2, chrono::milliseconds{100}, chrono::milliseconds{10}, 1000, {}};
+    string setup;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "-engine1" && hasValue)
+        {
+            opts.engines[0] = argv[++i];
+        }
+        else if (arg == "-engine2" && hasValue)
+        {
+            opts.engines[1] = argv[++i];
+        }
+        else if (arg == "-games" && hasValue)
+        {
+            opts.games = stoi(argv[++i]);
+        }
+        else if (arg == "-movetime" && hasValue)
+        {
+            opts.movetime = chrono::milliseconds{stoi(argv[++i])};
+        }
+        else if (arg == "-grace" && hasValue)
+        {
+            opts.grace = chrono::milliseconds{stoi(argv[++i])};
+        }
+        else if (arg == "-maxPlies" && hasValue)
+        {
+            opts.maxPlies = stoi(argv[++i]);
+        }
+        else
+        {
+            setup += arg + ' ';
+        }
+    }
+
+    if (opts.engines[0].empty() || opts.engines[1].empty() || opts.games < 1 || opts.movetime.count() < 1)
+    {
+        throw ParseError("usage: arbiter -engine1 <command> -engine2 <command> [-games N] [-movetime MS] "
+                         "[-grace MS] [-maxPlies N] [game options...]");
+    }
+    opts.setup = parseOptionString(setup);
+    return opts;
+}
+
+// EngineTally is one engine's results over the match
+struct EngineTally
+{
+    int wins = 0;
+    int draws = 0;
+    int losses = 0;
+    int forfeits = 0; // losses on time, by an illegal answer or by exiting
+};
+
+static const char *outcomeName(EngineOutcome outcome)
+{
+    switch (outcome)
+    {
+    case EngineOutcome::Timeout:
+        return "time";
+    case EngineOutcome::Illegal:
+        return "illegal answer";
+    case EngineOutcome::Crashed:
+        return "engine exited";
+    default:
+        return "";
+    }
+}
+
+// playGame plays one game with engine first as P1, and returns the winning engine or -1 for a draw
+//  * forfeit is set when the loser lost by breaking the protocol rather than on the board
+static int playGame(const ArbiterOptions &opts, EnginePlayer *players[2], int first, int number, bool &forfeit)
+{
+    const chrono::milliseconds setupLimit{5000};
+    int seatOf[2] = {first, 1 - first}; // engine playing P1, P2
+    string result;
+    int winner = -1;
+    int plies = 0;
+    forfeit = false;
+
+    for (int e = 0; e < 2 && result.empty(); ++e)
+    {
+        if (!players[e]->newGame(opts.setup, setupLimit))
+        {
+            winner = 1 - e;
+            forfeit = true;
+            result = players[e]->name() + " forfeits, not ready for a new game";
+        }
+    }
+
+    EngineGame game{opts.setup};
+    while (result.empty())
+    {
+        if (game.game().isOver())
+        {
+            PlayerId w = game.game().winner();
+            if (w == PlayerId::None)
+            {
+                result = "draw";
+                break;
+            }
+            winner = seatOf[w == PlayerId::P1 ? 0 : 1];
+            result = players[winner]->name() + " wins";
+            break;
+        }
+        if (plies >= opts.maxPlies)
+        {
+            result = "draw by ply limit";
+            break;
+        }
+
+        int e = seatOf[game.game().currentPlayer() == PlayerId::P1 ? 0 : 1];
+        string answer;
+        EngineOutcome outcome = players[e]->turn(game, opts.movetime, opts.grace, answer);
+        if (outcome == EngineOutcome::Played)
+        {
+            players[0]->played(answer);
+            players[1]->played(answer);
+            ++plies;
+        }
+        else if (outcome == EngineOutcome::NoMove)
+        {
+            result = "draw, " + players[e]->name() + " has no move";
+        }
+        else
+        {
+            winner = 1 - e;
+            forfeit = true;
+            result = players[e]->name() + " forfeits on " + outcomeName(outcome) + " (" + answer + ")";
+        }
+    }
+
+    cout << "game " << number << ": " << players[seatOf[0]]->name() << " vs " << players[seatOf[1]]->name()
+         << ": " << result << ", " << plies << " plies" << endl;
+    return winner;
+}
+
+// main plays a match between two engine programs, alternating colours, and reports results and thinking time
+int main(int argc, char *argv[])
+{
+    try
+    {
+        ArbiterOptions opts = parseArbiterOptions(argc, argv);
+
+        EnginePlayer one{opts.engines[0]};
+        EnginePlayer two{opts.engines[1]};
+        EnginePlayer *players[2] = {&one, &two};
+        one.start(chrono::milliseconds{5000});
+        two.start(chrono::milliseconds{5000});
+
+        EngineTally tally[2];
+        for (int g = 0; g < opts.games; ++g)
+        {
+            bool forfeit = false;
+            int winner = playGame(opts, players, g % 2, g + 1, forfeit);
+            if (winner < 0)
+            {
+                ++tally[0].draws;
+                ++tally[1].draws;
+                continue;
+            }
+            ++tally[winner].wins;
+            ++tally[1 - winner].losses;
+            tally[1 - winner].forfeits += forfeit ? 1 : 0;
+        }
+
+        for (int e = 0; e < 2; ++e)
+        {
+            const EnginePlayer &p = *players[e];
+            cout << "engine" << e + 1 << " " << p.name() << ": " << tally[e].wins << " wins, " << tally[e].draws
+                 << " draws, " << tally[e].losses << " losses (" << tally[e].forfeits << " forfeits); " << p.moves()
+                 << " moves, ";
+            if (p.moves() > 0)
+            {
+                cout << "mean " << p.totalMicros() / p.moves() << " us, max " << p.maxMicros() << " us per move";
+            }
+            cout << endl;
+        }
+    }
+    catch (const ParseError &e)
+    {
+        cerr << "Command line error: " << e.message() << endl;
+        return 1;
+    }
+    catch (const RaiiError &e)
+    {
+        cerr << "arbiter error: " << e.message() << endl;
+        return 1;
+    }
+    catch (const exception &e)
+    {
+        cerr << "Unexpected standard exception: " << e.what() << endl;
+        return 1;
+    }
+
+    return 0;
+}
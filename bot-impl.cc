@@ -0,0 +1,619 @@
+module;
+
+#include <pthread.h>
+#include <sched.h>
+
+module bot;
+
+import <string>;
+import <memory>;
+import <random>;
+import <chrono>;
+import <atomic>;
+import <thread>;
+import <unordered_map>;
+import <vector>;
+import <algorithm>;
+import <cmath>;
+import types;
+import board;
+import link;
+import player;
+import game;
+import cli;
+import ability;
+import errors;
+
+using namespace std;
+
+static const Direction allDirections[4] = {Direction::Up, Direction::Down, Direction::Left, Direction::Right};
+
+// labelFor returns the board label for a slot of the given player
+static char labelFor(PlayerId owner, int slot)
+{
+    return (owner == PlayerId::P1)
+               ? static_cast<char>('a' + slot)
+               : static_cast<char>('A' + slot);
+}
+
+int legalMoves(const Game &game, BotMove out[32])
+{
+    PlayerId me = game.currentPlayer();
+    if (me == PlayerId::None)
+    {
+        return 0;
+    }
+
+    int count = 0;
+    for (int slot = 0; slot < 8; ++slot)
+    {
+        char label = labelFor(me, slot);
+        for (Direction dir : allDirections)
+        {
+            if (game.isLegalMove(label, dir))
+            {
+                out[count++] = BotMove{label, dir};
+            }
+        }
+    }
+    return count;
+}
+
+// default bots never use abilities
+bool Bot::chooseAbility(const Game & /*game*/, BotAbility & /*out*/)
+{
+    return false;
+}
+
+// ==================== RandomBot ====================
+
+RandomBot::RandomBot() : rng{0} {}
+
+string RandomBot::name() const
+{
+    return "random";
+}
+
+void RandomBot::seed(unsigned long long value)
+{
+    rng.seed(value);
+}
+
+bool RandomBot::chooseMove(const Game &game, BotMove &out)
+{
+    BotMove moves[32];
+    int count = legalMoves(game, moves);
+    if (count == 0)
+    {
+        return false;
+    }
+
+    uniform_int_distribution<int> pick{0, count - 1};
+    out = moves[pick(rng)];
+    return true;
+}
+
+// ==================== GreedyBot ====================
+
+// expected value for downloading a link the viewer may not know
+//  * a known data link is worth +1, a known virus -1, an unknown link is a coin flip
+static int downloadValue(const LinkView &link)
+{
+    if (!link.known)
+    {
+        return 0;
+    }
+    return (link.kind == LinkKind::Data) ? 100 : -100;
+}
+
+// scoreMove rates a legal move for the current player using only information that player can see
+static int scoreMove(const Game &game, const Projection &seen, BotMove move)
+{
+    PlayerId me = game.currentPlayer();
+    PlayerId opponent = (me == PlayerId::P1) ? PlayerId::P2 : PlayerId::P1;
+    const PlayerState &ps = game.getPlayer(me);
+
+    int slot = (me == PlayerId::P1) ? move.label - 'a' : move.label - 'A';
+    int linkIdx = ps.getLinkIndex(slot);
+    const Link &piece = game.getLink(linkIdx);
+    Position src = seen.links[linkIdx].pos;
+
+    int dr = (move.dir == Direction::Up) ? -1 : (move.dir == Direction::Down) ? 1 : 0;
+    int dc = (move.dir == Direction::Left) ? -1 : (move.dir == Direction::Right) ? 1 : 0;
+    int step = piece.isBoosted() ? 2 : 1;
+    Position dest{src.row + dr * step, src.col + dc * step};
+
+    int forward = (me == PlayerId::P1) ? dr : -dr;
+    bool isData = piece.getKind() == LinkKind::Data;
+
+    // off the opponent edge: the mover downloads its own link
+    if (dest.row < 0 || dest.row >= 8)
+    {
+        return isData ? 200 : -200;
+    }
+
+    const Cell &cell = game.board().at(dest);
+
+    // stepping into the opponent's server port hands them the link
+    if (cell.isServerPortFor(opponent))
+    {
+        return isData ? -200 : 150;
+    }
+
+    int score = 0;
+
+    if (cell.getKind() == CellKind::Link)
+    {
+        int defenderIdx = cell.getLinkIndex();
+        const LinkView &defender = seen.links[defenderIdx];
+        if (game.getLink(defenderIdx).getOwner() == me)
+        {
+            // swaps are neutral
+            return 0;
+        }
+
+        if (defender.known)
+        {
+            bool wins = piece.getStrength() >= defender.strength;
+            if (game.getLink(defenderIdx).isShielded())
+            {
+                wins = false;
+            }
+            if (wins)
+            {
+                score += downloadValue(defender);
+            }
+            else
+            {
+                // the opponent downloads our piece
+                score += isData ? -120 : 80;
+            }
+        }
+        else
+        {
+            // unknown defender: strong pieces attack, weak data pieces stay away
+            score += (piece.getStrength() - 2) * 20;
+            if (isData && piece.getStrength() < 3)
+            {
+                score -= 40;
+            }
+        }
+        return score;
+    }
+
+    if (cell.firewallPresent() && cell.getFirewallOwner() != me && !isData)
+    {
+        // our virus would be downloaded by us
+        return -150;
+    }
+
+    // otherwise prefer advancing data towards the opponent edge
+    if (isData)
+    {
+        score += forward * 10;
+    }
+    else
+    {
+        score += forward * 4;
+    }
+    return score;
+}
+
+GreedyBot::GreedyBot() : rng{0} {}
+
+string GreedyBot::name() const
+{
+    return "greedy";
+}
+
+void GreedyBot::seed(unsigned long long value)
+{
+    rng.seed(value);
+}
+
+// chooseAbility downloads a known enemy data link or scans an unknown link near our pieces
+bool GreedyBot::chooseAbility(const Game &game, BotAbility &out)
+{
+    PlayerId me = game.currentPlayer();
+    PlayerId opponent = (me == PlayerId::P1) ? PlayerId::P2 : PlayerId::P1;
+    const PlayerAbilities &pa = game.getAbilities(me);
+    const PlayerState &theirs = game.getPlayer(opponent);
+    shared_ptr<const Projection> seen = game.projection(me);
+
+    for (int s = 0; s < 5; ++s)
+    {
+        if (pa.isUsed(s))
+        {
+            continue;
+        }
+
+        char code = pa.abilityAt(s).code();
+        for (int slot = 0; slot < 8; ++slot)
+        {
+            int idx = theirs.getLinkIndex(slot);
+            if (idx < 0)
+            {
+                continue;
+            }
+
+            const LinkView &lnk = seen->links[idx];
+            if ((code == 'D' && lnk.known && lnk.kind == LinkKind::Data) ||
+                (code == 'S' && !lnk.known))
+            {
+                out = BotAbility{s, true, false, labelFor(opponent, slot), Position{0, 0}};
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool GreedyBot::chooseMove(const Game &game, BotMove &out)
+{
+    BotMove moves[32];
+    int count = legalMoves(game, moves);
+    if (count == 0)
+    {
+        return false;
+    }
+
+    shared_ptr<const Projection> seen = game.projection(game.currentPlayer());
+
+    // small random jitter breaks ties so self-play does not repeat forever
+    uniform_int_distribution<int> jitter{0, 5};
+
+    int bestScore = 0;
+    int best = -1;
+    for (int i = 0; i < count; ++i)
+    {
+        int score = scoreMove(game, *seen, moves[i]) + jitter(rng);
+        if (best < 0 || score > bestScore)
+        {
+            bestScore = score;
+            best = i;
+        }
+    }
+
+    out = moves[best];
+    return true;
+}
+
+// ==================== SearchBot ====================
+
+// playouts stop after this many plies and score the position reached
+static const int playoutDepth = 6;
+
+// the table is dropped when it grows past this many positions
+static const size_t maxSearchNodes = 1 << 12;
+
+// a ponder gives up after this many playouts, so an opponent that never moves does not keep a core busy
+static const long long maxPonderPlayouts = 1 << 21;
+
+// dealHidden shuffles kind and strength among the opponent's links on the board that viewer has not seen
+//  * every player has the same eight links, so the hidden ones are some ordering of what is left
+static void dealHidden(GameState &s, PlayerId viewer, mt19937_64 &rng)
+{
+    unsigned char known = (viewer == PlayerId::P1) ? GameState::KnownByP1 : GameState::KnownByP2;
+    int first = (viewer == PlayerId::P1) ? 8 : 0;
+
+    int idx[8];
+    unsigned char kind[8];
+    unsigned char strength[8];
+    int n = 0;
+    for (int i = first; i < first + 8; ++i)
+    {
+        unsigned char flags = s.linkFlags[i];
+        if ((flags & GameState::Alive) && !(flags & known))
+        {
+            idx[n] = i;
+            kind[n] = flags & GameState::Virus;
+            strength[n] = s.linkStrength[i];
+            ++n;
+        }
+    }
+
+    for (int i = n - 1; i > 0; --i)
+    {
+        int j = uniform_int_distribution<int>{0, i}(rng);
+        swap(kind[i], kind[j]);
+        swap(strength[i], strength[j]);
+    }
+
+    for (int k = 0; k < n; ++k)
+    {
+        s.linkFlags[idx[k]] = static_cast<unsigned char>((s.linkFlags[idx[k]] & ~GameState::Virus) | kind[k]);
+        s.linkStrength[idx[k]] = strength[k];
+    }
+}
+
+// playoutValue scores a position for me between 0 and 1, a finished game at the ends
+//  * between downloads, data links count for how far they have come towards the far edge
+static double playoutValue(const Game &game, PlayerId me)
+{
+    if (game.isOver())
+    {
+        return game.winner() == me ? 1.0 : 0.0;
+    }
+
+    PlayerId opponent = (me == PlayerId::P1) ? PlayerId::P2 : PlayerId::P1;
+    const PlayerState &mine = game.getPlayer(me);
+    const PlayerState &theirs = game.getPlayer(opponent);
+    int lead = (mine.getDownloadedData() - theirs.getDownloadedData()) -
+               (mine.getDownloadedVirus() - theirs.getDownloadedVirus());
+
+    GameState s = game.snapshot();
+    int advance = 0;
+    for (int sq = 0; sq < 64; ++sq)
+    {
+        int idx = s.cells[sq] - 1;
+        if (idx < 0 || (s.linkFlags[idx] & GameState::Virus))
+        {
+            continue;
+        }
+        bool p1 = idx < 8;
+        int rows = p1 ? sq / 8 : 7 - sq / 8;
+        advance += ((p1 ? PlayerId::P1 : PlayerId::P2) == me) ? rows : -rows;
+    }
+    return clamp(0.5 + 0.1 * lead + 0.005 * advance, 0.02, 0.98);
+}
+
+// playoutMove picks a reply for the side to move the way the greedy bot would, with a lot more noise
+static int playoutMove(const Game &game, const BotMove moves[32], int count, mt19937_64 &rng)
+{
+    shared_ptr<const Projection> seen = game.projection(game.currentPlayer());
+    uniform_int_distribution<int> jitter{0, 60};
+
+    int best = 0;
+    int bestScore = 0;
+    for (int i = 0; i < count; ++i)
+    {
+        int score = scoreMove(game, *seen, moves[i]) + jitter(rng);
+        if (i == 0 || score > bestScore)
+        {
+            best = i;
+            bestScore = score;
+        }
+    }
+    return best;
+}
+
+SearchBot::SearchBot() : rng{0},
+                         scratch{make_unique<Game>(CommandLineOptions{})},
+                         tree{},
+                         playoutLimit{2000},
+                         timeLimit{0},
+                         played{0},
+                         reused{0} {}
+
+string SearchBot::name() const
+{
+    return "search";
+}
+
+void SearchBot::seed(unsigned long long value)
+{
+    rng.seed(value);
+    tree.clear();
+}
+
+void SearchBot::setBudget(long long playouts, chrono::microseconds time)
+{
+    playoutLimit = playouts;
+    timeLimit = time;
+}
+
+long long SearchBot::lastPlayouts() const
+{
+    return played;
+}
+
+long long SearchBot::lastReused() const
+{
+    return reused;
+}
+
+// nodeFor finds position in the table, adding it with its legal moves if it is new
+SearchNode &SearchBot::nodeFor(const GameState &position)
+{
+    unsigned long long key = zobristHash(position);
+    auto found = tree.find(key);
+    if (found != tree.end())
+    {
+        return found->second;
+    }
+
+    if (tree.size() >= maxSearchNodes)
+    {
+        tree.clear();
+    }
+    SearchNode &node = tree[key];
+    scratch->restore(position);
+    node.count = legalMoves(*scratch, node.moves);
+    return node;
+}
+
+// runPlayouts adds count playouts to node, choosing which move to try with UCB1
+void SearchBot::runPlayouts(const GameState &position, SearchNode &node, int count)
+{
+    PlayerId me = (position.current == 0) ? PlayerId::P1 : PlayerId::P2;
+
+    for (int k = 0; k < count; ++k)
+    {
+        int pick = -1;
+        double bestBound = 0;
+        double logTotal = log(static_cast<double>(node.total) + 1.0);
+        for (int i = 0; i < node.count; ++i)
+        {
+            if (node.visits[i] == 0)
+            {
+                pick = i;
+                break;
+            }
+            double bound = node.value[i] / node.visits[i] + 0.7 * sqrt(logTotal / node.visits[i]);
+            if (pick < 0 || bound > bestBound)
+            {
+                pick = i;
+                bestBound = bound;
+            }
+        }
+
+        GameState dealt = position;
+        dealHidden(dealt, me, rng);
+        scratch->restore(dealt);
+        scratch->moveLink(node.moves[pick].label, node.moves[pick].dir);
+
+        for (int ply = 0; ply < playoutDepth && !scratch->isOver(); ++ply)
+        {
+            BotMove replies[32];
+            int n = legalMoves(*scratch, replies);
+            if (n == 0)
+            {
+                break;
+            }
+            const BotMove &reply = replies[playoutMove(*scratch, replies, n, rng)];
+            scratch->moveLink(reply.label, reply.dir);
+        }
+
+        ++node.visits[pick];
+        node.value[pick] += playoutValue(*scratch, me);
+        ++node.total;
+    }
+}
+
+bool SearchBot::chooseMove(const Game &game, BotMove &out)
+{
+    GameState root = game.snapshot();
+    SearchNode &node = nodeFor(root);
+    if (node.count == 0)
+    {
+        return false;
+    }
+
+    reused = static_cast<long long>(node.total);
+    played = 0;
+    auto deadline = chrono::steady_clock::now() + timeLimit;
+    while ((playoutLimit <= 0 || played < playoutLimit) &&
+           (timeLimit.count() == 0 || chrono::steady_clock::now() < deadline))
+    {
+        runPlayouts(root, node, 16);
+        played += 16;
+    }
+
+    // the most tried move is the one the search trusts most
+    int best = 0;
+    for (int i = 1; i < node.count; ++i)
+    {
+        if (node.visits[i] > node.visits[best])
+        {
+            best = i;
+        }
+    }
+    out = node.moves[best];
+    return true;
+}
+
+void SearchBot::ponder(const GameState &position, const atomic<bool> &stop)
+{
+    PlayerId opponent = (position.current == 0) ? PlayerId::P1 : PlayerId::P2;
+    PlayerId me = (opponent == PlayerId::P1) ? PlayerId::P2 : PlayerId::P1;
+
+    // rank the replies the way the greedy bot would, on a deal of the links we cannot see
+    GameState guess = position;
+    dealHidden(guess, me, rng);
+    scratch->restore(guess);
+    if (scratch->isOver())
+    {
+        return;
+    }
+    BotMove replies[32];
+    int n = legalMoves(*scratch, replies);
+    shared_ptr<const Projection> seen = scratch->projection(opponent);
+
+    vector<pair<int, int>> ranked; // score, reply
+    for (int i = 0; i < n; ++i)
+    {
+        ranked.push_back({scoreMove(*scratch, *seen, replies[i]), i});
+    }
+    sort(ranked.begin(), ranked.end(),
+         [](const pair<int, int> &a, const pair<int, int> &b) { return a.first > b.first; });
+
+    // then play them on the real position, these are the positions chooseMove will be asked about
+    vector<GameState> after;
+    for (const pair<int, int> &r : ranked)
+    {
+        scratch->restore(position);
+        scratch->moveLink(replies[r.second].label, replies[r.second].dir);
+        if (!scratch->isOver())
+        {
+            after.push_back(scratch->snapshot());
+        }
+    }
+
+    long long done = 0;
+    while (!after.empty() && done < maxPonderPlayouts && !stop.load())
+    {
+        for (size_t r = 0; r < after.size() && !stop.load(); ++r)
+        {
+            int batch = (r < 3) ? 32 : 8;
+            SearchNode &node = nodeFor(after[r]);
+            if (node.count > 0)
+            {
+                runPlayouts(after[r], node, batch);
+            }
+            done += batch;
+        }
+    }
+}
+
+// ==================== Ponderer ====================
+
+Ponderer::Ponderer(SearchBot &b) : bot{b},
+                                   worker{},
+                                   stopping{false} {}
+
+Ponderer::~Ponderer()
+{
+    stop();
+}
+
+void Ponderer::start(const GameState &position)
+{
+    stop();
+    stopping.store(false);
+    worker = thread{[this, position] {
+        // only take CPU time nothing else wants, pondering must not slow the opponent down on a shared core
+        sched_param idle{};
+        pthread_setschedparam(pthread_self(), SCHED_IDLE, &idle);
+        bot.ponder(position, stopping);
+    }};
+}
+
+void Ponderer::stop()
+{
+    if (worker.joinable())
+    {
+        stopping.store(true);
+        // an idle-class thread can wait unboundedly for a busy core, and the join would charge that wait
+        // to this engine's next move, so the worker is raised back to normal priority to see the flag
+        sched_param normal{};
+        pthread_setschedparam(worker.native_handle(), SCHED_OTHER, &normal);
+        worker.join();
+    }
+}
+
+unique_ptr<Bot> makeBot(const string &name)
+{
+    if (name == "random")
+    {
+        return make_unique<RandomBot>();
+    }
+    if (name == "greedy")
+    {
+        return make_unique<GreedyBot>();
+    }
+    if (name == "search")
+    {
+        return make_unique<SearchBot>();
+    }
+    throw ParseError("unknown bot: " + name);
+}
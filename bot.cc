@@ -0,0 +1,155 @@
+export module bot;
+
+import <string>;
+import <memory>;
+import <random>;
+import <chrono>;
+import <atomic>;
+import <thread>;
+import <unordered_map>;
+import types;
+import game;
+
+using namespace std;
+
+// BotMove is a move chosen by a bot, in the same form Game::moveLink takes
+export struct BotMove
+{
+    char label;
+    Direction dir;
+};
+
+// BotAbility is an ability use chosen by a bot, matching the arguments of Ability::use
+export struct BotAbility
+{
+    int slot;
+    bool hasLabel;
+    bool hasPos;
+    char label;
+    Position pos;
+};
+
+// legalMoves fills out with every legal move for the current player and returns how many there are
+export int legalMoves(const Game &game, BotMove out[32]);
+
+// Bot is the abstract base class for all computer players
+export class Bot
+{
+public:
+    virtual ~Bot() = default;
+
+    // name returns the name the bot is registered under in makeBot
+    virtual string name() const = 0;
+
+    // seed resets the random source so games can be reproduced
+    virtual void seed(unsigned long long value) = 0;
+
+    // chooseAbility optionally picks an ability to use before moving, returns false to skip
+    virtual bool chooseAbility(const Game &game, BotAbility &out);
+
+    // chooseMove picks a legal move for the current player, returns false if there is none
+    virtual bool chooseMove(const Game &game, BotMove &out) = 0;
+};
+
+// RandomBot plays a uniformly random legal move and never uses abilities
+export class RandomBot : public Bot
+{
+    mt19937_64 rng;
+
+public:
+    RandomBot();
+
+    string name() const override;
+    void seed(unsigned long long value) override;
+    bool chooseMove(const Game &game, BotMove &out) override;
+};
+
+// GreedyBot scores every legal move one ply deep using only what its player can see
+export class GreedyBot : public Bot
+{
+    mt19937_64 rng;
+
+public:
+    GreedyBot();
+
+    string name() const override;
+    void seed(unsigned long long value) override;
+    bool chooseAbility(const Game &game, BotAbility &out) override;
+    bool chooseMove(const Game &game, BotMove &out) override;
+};
+
+// SearchNode is what SearchBot knows about one position: its legal moves and the playouts after each
+struct SearchNode
+{
+    int count;
+    BotMove moves[32];
+    unsigned visits[32];
+    double value[32]; // summed playout results for the player to move, each between 0 and 1
+    unsigned long long total;
+};
+
+// SearchBot plays short random games after each of its moves and picks the move that did best
+//  * links it cannot see are dealt again at random for every playout, from the ones still hidden,
+//    so the search never relies on what its player does not know
+//  * statistics live in a table keyed by position hash that is kept between turns; time spent on a
+//    position before it is reached, such as by pondering, adds to the time spent on it when it is
+//  * uses no abilities
+export class SearchBot : public Bot
+{
+public:
+    SearchBot();
+
+    string name() const override;
+    void seed(unsigned long long value) override;
+    bool chooseMove(const Game &game, BotMove &out) override;
+
+    // setBudget bounds each chooseMove by a number of playouts, and by time when time is not zero
+    void setBudget(long long playouts, chrono::microseconds time);
+
+    // ponder searches the positions after each opponent reply from position until stop is set
+    //  * position has the opponent to move; the likeliest replies get the most playouts
+    //  * it shares the table with chooseMove, so the two must never run at the same time
+    void ponder(const GameState &position, const atomic<bool> &stop);
+
+    // the playouts the last chooseMove ran, and how many the position already had when it started
+    long long lastPlayouts() const;
+    long long lastReused() const;
+
+private:
+    mt19937_64 rng;
+    unique_ptr<Game> scratch; // playouts are played here, the caller's game is never touched
+    unordered_map<unsigned long long, SearchNode> tree;
+    long long playoutLimit;
+    chrono::microseconds timeLimit;
+    long long played;
+    long long reused;
+
+    SearchNode &nodeFor(const GameState &position);
+    void runPlayouts(const GameState &position, SearchNode &node, int count);
+};
+
+// Ponderer runs SearchBot::ponder on a background thread while the bot waits for its opponent
+//  * stop is cooperative: the search checks the flag between small batches of playouts
+export class Ponderer
+{
+public:
+    explicit Ponderer(SearchBot &bot);
+    ~Ponderer();
+
+    Ponderer(const Ponderer &) = delete;
+    Ponderer &operator=(const Ponderer &) = delete;
+
+    // start ponders position, stopping any earlier search first
+    void start(const GameState &position);
+
+    // stop asks the search to finish and waits for it, so the bot can be used again
+    void stop();
+
+private:
+    SearchBot &bot;
+    thread worker;
+    atomic<bool> stopping;
+};
+
+// makeBot creates a bot by name ("random", "greedy" or "search")
+export unique_ptr<Bot> makeBot(const string &name);
@@ -0,0 +1,102 @@
+module chessclock;
+
+import <string>;
+import <chrono>;
+import types;
+import cli;
+
+using namespace std;
+
+TimeControl timeControl(const CommandLineOptions &options)
+{
+    return TimeControl{chrono::microseconds{options.timeBase}, chrono::microseconds{options.timeIncrement}};
+}
+
+ChessClock::ChessClock() : control{chrono::microseconds{0}, chrono::microseconds{0}},
+                           left{Clock::duration::zero(), Clock::duration::zero()},
+                           side{PlayerId::P1},
+                           since{},
+                           ticking{false} {}
+
+void ChessClock::reset(const TimeControl &tc)
+{
+    control = tc;
+    left[0] = control.base;
+    left[1] = control.base;
+    side = PlayerId::P1;
+    ticking = false;
+}
+
+bool ChessClock::enabled() const
+{
+    return control.base > chrono::microseconds{0};
+}
+
+bool ChessClock::running() const
+{
+    return ticking;
+}
+
+void ChessClock::start(PlayerId who, Clock::time_point now)
+{
+    side = who;
+    since = now;
+    ticking = enabled();
+}
+
+void ChessClock::press(Clock::time_point now)
+{
+    if (!ticking)
+    {
+        return;
+    }
+    int i = (side == PlayerId::P1) ? 0 : 1;
+    left[i] -= now - since;
+    left[i] += control.increment;
+    side = (side == PlayerId::P1) ? PlayerId::P2 : PlayerId::P1;
+    since = now;
+}
+
+void ChessClock::stop(Clock::time_point now)
+{
+    if (!ticking)
+    {
+        return;
+    }
+    int i = (side == PlayerId::P1) ? 0 : 1;
+    left[i] -= now - since;
+    ticking = false;
+}
+
+ChessClock::Clock::duration ChessClock::remaining(PlayerId who, Clock::time_point now) const
+{
+    int i = (who == PlayerId::P1) ? 0 : 1;
+    if (ticking && who == side)
+    {
+        return left[i] - (now - since);
+    }
+    return left[i];
+}
+
+ChessClock::Clock::time_point ChessClock::deadline() const
+{
+    return since + left[(side == PlayerId::P1) ? 0 : 1];
+}
+
+string formatClock(ChessClock::Clock::duration remaining)
+{
+    long long tenths = chrono::duration_cast<chrono::milliseconds>(remaining).count() / 100;
+    if (tenths < 0)
+    {
+        tenths = 0;
+    }
+
+    long long minutes = tenths / 600;
+    int seconds = static_cast<int>(tenths / 10 % 60);
+    string s = to_string(minutes) + ":";
+    s += static_cast<char>('0' + seconds / 10);
+    s += static_cast<char>('0' + seconds % 10);
+    s += '.';
+    s += static_cast<char>('0' + tenths % 10);
+    return s;
+}
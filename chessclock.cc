@@ -0,0 +1,62 @@
+export module chessclock;
+
+import <string>;
+import <chrono>;
+import types;
+import cli;
+
+using namespace std;
+
+// TimeControl is a base time for each player and an increment added after every move
+export struct TimeControl
+{
+    chrono::microseconds base;      // zero for an untimed game
+    chrono::microseconds increment;
+};
+
+// timeControl reads -time and -increment from the command line options
+export TimeControl timeControl(const CommandLineOptions &options);
+
+// ChessClock keeps both players' remaining time against steady_clock
+//  * nothing ticks: a running side's time is the time left at its last press minus what has passed since,
+//    worked out only when someone asks, so a turn costs two clock reads and no timers or threads
+//  * all arithmetic is in steady_clock's own ticks, rounding happens only when time is shown
+export class ChessClock
+{
+public:
+    using Clock = chrono::steady_clock;
+
+    ChessClock();
+
+    // reset gives both players the base time and stops the clock
+    void reset(const TimeControl &control);
+
+    // enabled is false for an untimed game; running once start has been called and until stop
+    bool enabled() const;
+    bool running() const;
+
+    // start runs side's time from now
+    void start(PlayerId side, Clock::time_point now);
+
+    // press ends the running side's turn at now: its time stops, it gets the increment and the other side's runs
+    void press(Clock::time_point now);
+
+    // stop freezes both times, for a finished game
+    void stop(Clock::time_point now);
+
+    // remaining is side's time left at now, negative once its flag has fallen
+    Clock::duration remaining(PlayerId side, Clock::time_point now) const;
+
+    // deadline is when the running side's flag falls unless it presses first, meaningful only while running
+    Clock::time_point deadline() const;
+
+private:
+    TimeControl control;
+    Clock::duration left[2];
+    PlayerId side;          // whose time is running
+    Clock::time_point since; // when it started running
+    bool ticking;
+};
+
+// formatClock writes a remaining time as m:ss.t, truncated towards zero so it never shows time that is not there
+export string formatClock(ChessClock::Clock::duration remaining);
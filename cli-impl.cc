@@ -2,6 +2,8 @@ module cli;
 
 import <map>;
 import <string>;
+import <exception>;
+import <vector>;
 import errors;
 
 using namespace std;
@@ -12,11 +14,15 @@ CommandLineOptions::CommandLineOptions() : ability1{"LFDSP"},
                                            link1{"V1V2V3V4D1D2D3D4"},
                                            link2{"V1V2V3V4D1D2D3D4"},
                                            enableBonus{false},
-                                           enableGraphics{false} {}
+                                           enableGraphics{false},
+                                           recordFile{},
+                                           skipUnchanged{false},
+                                           timeBase{0},
+                                           timeIncrement{0} {}
 
 // validateAbilityString checks that an ability string is exactly 5 chars,
 // uses only known ability codes, and has at most 2 of each kind
-static void validateAbilityString(const std::string &s, const std::string &optName)
+void validateAbilityString(const std::string &s, const std::string &optName)
 {
     if (s.size() != 5)
     {
@@ -56,7 +62,27 @@ static void validateAbilityString(const std::string &s, const std::string &optNa
     }
 }
 
-// parseOptions handles -ability1/-ability2, -link1/-link2, and view flags
+// parseSeconds reads a non-negative, possibly fractional number of seconds as microseconds
+static long long parseSeconds(const string &val, const string &optName)
+{
+    size_t used = 0;
+    double seconds = -1;
+    try
+    {
+        seconds = stod(val, &used);
+    }
+    catch (const exception &)
+    {
+        used = 0;
+    }
+    if (used != val.size() || !(seconds >= 0) || seconds > 1e9)
+    {
+        throw ParseError(optName + " must be a number of seconds");
+    }
+    return static_cast<long long>(seconds * 1e6 + 0.5);
+}
+
+// parseOptions handles -ability1/-ability2, -link1/-link2, -record, -skipUnchanged, -time/-increment and view flags
 CommandLineOptions parseOptions(int argc, char *argv[])
 {
     CommandLineOptions opts;
@@ -109,6 +135,34 @@ CommandLineOptions parseOptions(int argc, char *argv[])
                 throw ParseError("link2 must describe 8 links like V1V2V3V4D1D2D3D4");
             }
         }
+        else if (arg == "-record")
+        {
+            if (i + 1 >= argc)
+            {
+                throw ParseError("missing argument for -record");
+            }
+            opts.recordFile = argv[++i];
+        }
+        else if (arg == "-time")
+        {
+            if (i + 1 >= argc)
+            {
+                throw ParseError("missing argument for -time");
+            }
+            opts.timeBase = parseSeconds(argv[++i], "time");
+        }
+        else if (arg == "-increment")
+        {
+            if (i + 1 >= argc)
+            {
+                throw ParseError("missing argument for -increment");
+            }
+            opts.timeIncrement = parseSeconds(argv[++i], "increment");
+        }
+        else if (arg == "-skipUnchanged")
+        {
+            opts.skipUnchanged = true;
+        }
         else if (arg == "-enableBonus" || arg == "-enablebonus")
         {
             // cannot mix curses and graphics flags
@@ -137,3 +191,46 @@ CommandLineOptions parseOptions(int argc, char *argv[])
     return opts;
 }
 
+CommandLineOptions parseOptionString(const string &line)
+{
+    // split into owned words first so argv pointers stay valid
+    vector<string> words;
+    string word;
+    for (char ch : line)
+    {
+        if (ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n')
+        {
+            if (!word.empty())
+            {
+                words.push_back(word);
+                word.clear();
+            }
+        }
+        else
+        {
+            word += ch;
+        }
+    }
+    if (!word.empty())
+    {
+        words.push_back(word);
+    }
+
+    vector<char *> argv;
+    string program = "RAIInet";
+    argv.push_back(program.data());
+    for (string &w : words)
+    {
+        argv.push_back(w.data());
+    }
+
+    return parseOptions(static_cast<int>(argv.size()), argv.data());
+}
+
+string optionString(const CommandLineOptions &opts)
+{
+    return "-ability1 " + opts.ability1 +
+           " -ability2 " + opts.ability2 +
+           " -link1 " + opts.link1 +
+           " -link2 " + opts.link2;
+}
@@ -13,10 +13,22 @@ export struct CommandLineOptions
     string link2;
     bool enableBonus;     // use CursesView when true
     bool enableGraphics;  // use XView when true
+    string recordFile;    // binary replay output, empty when not recording
+    bool skipUnchanged;   // TextView drops frames identical to the previous one
+    long long timeBase;      // each player's clock in microseconds, 0 for an untimed game
+    long long timeIncrement; // microseconds added to a player's clock after each of their moves
 
     CommandLineOptions();
 };
 
+// validateAbilityString throws ParseError unless s is a legal 5-card ability string
+export void validateAbilityString(const string &s, const string &optName);
+
 // parseOptions reads argv and fills a CommandLineOptions instance
 export CommandLineOptions parseOptions(int argc, char *argv[]);
 
+// parseOptionString splits a line like "-link1 V1V2V3V4D1D2D3D4" on whitespace and parses it like argv
+export CommandLineOptions parseOptionString(const string &line);
+
+// optionString writes the ability and link settings back out in a form parseOptionString accepts
+export string optionString(const CommandLineOptions &opts);
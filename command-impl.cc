@@ -0,0 +1,377 @@
+module;
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+module command;
+
+import <string>;
+import <string_view>;
+import <vector>;
+import <algorithm>;
+import <climits>;
+import types;
+import errors;
+
+using namespace std;
+
+// Cursor walks a line the way operator>> walks an istream
+struct Cursor
+{
+    string_view text;
+    size_t at;
+
+    static bool isSpace(char ch)
+    {
+        return ch == ' ' || ch == '\t' || ch == '\n' || ch == '\v' || ch == '\f' || ch == '\r';
+    }
+
+    void skipSpace()
+    {
+        while (at < text.size() && isSpace(text[at]))
+        {
+            ++at;
+        }
+    }
+
+    // word reads up to the next whitespace, like >> string
+    bool word(string_view &out)
+    {
+        skipSpace();
+        size_t start = at;
+        while (at < text.size() && !isSpace(text[at]))
+        {
+            ++at;
+        }
+        out = text.substr(start, at - start);
+        return at > start;
+    }
+
+    // character reads the next non-space character, like >> char
+    bool character(char &out)
+    {
+        skipSpace();
+        if (at >= text.size())
+        {
+            return false;
+        }
+        out = text[at++];
+        return true;
+    }
+
+    // integer reads an optionally signed decimal, like >> int, failing on overflow
+    bool integer(int &out)
+    {
+        skipSpace();
+        size_t i = at;
+        bool negative = false;
+        if (i < text.size() && (text[i] == '+' || text[i] == '-'))
+        {
+            negative = text[i] == '-';
+            ++i;
+        }
+        size_t digits = i;
+        long long value = 0;
+        while (i < text.size() && text[i] >= '0' && text[i] <= '9')
+        {
+            value = value * 10 + (text[i] - '0');
+            if (value > static_cast<long long>(INT_MAX) + 1)
+            {
+                return false;
+            }
+            ++i;
+        }
+        if (i == digits)
+        {
+            return false;
+        }
+        value = negative ? -value : value;
+        if (value > INT_MAX || value < INT_MIN)
+        {
+            return false;
+        }
+        out = static_cast<int>(value);
+        at = i;
+        return true;
+    }
+};
+
+static bool parseDirection(string_view s, Direction &dir)
+{
+    if (s == "up")
+    {
+        dir = Direction::Up;
+    }
+    else if (s == "down")
+    {
+        dir = Direction::Down;
+    }
+    else if (s == "left")
+    {
+        dir = Direction::Left;
+    }
+    else if (s == "right")
+    {
+        dir = Direction::Right;
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+static bool isLinkLabel(char ch)
+{
+    return (ch >= 'a' && ch <= 'h') || (ch >= 'A' && ch <= 'H');
+}
+
+// parseAbilityArgs reads the optional label and/or position after the ability id
+static ParseStatus parseAbilityArgs(Cursor &cur, Command &out)
+{
+    string_view token;
+    if (!cur.word(token))
+    {
+        return ParseStatus::Ok;
+    }
+
+    if (token.size() == 1 && isLinkLabel(token[0]))
+    {
+        out.hasLabel = true;
+        out.label = token[0];
+
+        // a position after the label is optional and ignored unless both parts parse
+        int r;
+        int c;
+        if (cur.integer(r) && cur.integer(c))
+        {
+            out.hasPos = true;
+            out.pos = Position{r, c};
+        }
+        return ParseStatus::Ok;
+    }
+
+    // otherwise the token must start with the row
+    Cursor row{token, 0};
+    int r;
+    if (!row.integer(r))
+    {
+        return ParseStatus::BadTarget;
+    }
+
+    int c;
+    if (!cur.integer(c))
+    {
+        return ParseStatus::MissingColumn;
+    }
+
+    out.hasPos = true;
+    out.pos = Position{r, c};
+    return ParseStatus::Ok;
+}
+
+ParseStatus parseCommand(string_view line, Command &out) noexcept
+{
+    out = Command{CommandKind::Empty, '?', Direction::Up, 0, false, false, Position{0, 0}, 0, string_view{}};
+
+    Cursor cur{line, 0};
+    string_view word;
+    if (!cur.word(word))
+    {
+        return ParseStatus::Ok;
+    }
+
+    if (word == "move")
+    {
+        out.kind = CommandKind::Move;
+        string_view dir;
+        if (!cur.character(out.label) || !cur.word(dir))
+        {
+            return ParseStatus::MoveUsage;
+        }
+        if (!parseDirection(dir, out.dir))
+        {
+            out.token = dir;
+            return ParseStatus::BadDirection;
+        }
+        return ParseStatus::Ok;
+    }
+
+    if (word == "ability")
+    {
+        out.kind = CommandKind::Ability;
+        if (!cur.integer(out.abilityId))
+        {
+            return ParseStatus::AbilityUsage;
+        }
+        if (out.abilityId < 1 || out.abilityId > 5)
+        {
+            return ParseStatus::AbilityRange;
+        }
+        return parseAbilityArgs(cur, out);
+    }
+
+    if (word == "abilities")
+    {
+        out.kind = CommandKind::Abilities;
+    }
+    else if (word == "board")
+    {
+        out.kind = CommandKind::Board;
+    }
+    else if (word == "sequence")
+    {
+        out.kind = CommandKind::Sequence;
+        if (!cur.word(out.token))
+        {
+            return ParseStatus::MissingFile;
+        }
+    }
+    else if (word == "bulk")
+    {
+        out.kind = CommandKind::Bulk;
+        if (!cur.word(out.token))
+        {
+            return ParseStatus::MissingFile;
+        }
+        // the optional interval must be a whole non-negative number
+        string_view rest;
+        Cursor after = cur;
+        if (after.word(rest) && (!cur.integer(out.every) || cur.at != after.at || out.every < 0))
+        {
+            return ParseStatus::BulkUsage;
+        }
+    }
+    else if (word == "quit")
+    {
+        out.kind = CommandKind::Quit;
+    }
+    else
+    {
+        out.token = word;
+        return ParseStatus::UnknownCommand;
+    }
+    return ParseStatus::Ok;
+}
+
+string parseErrorMessage(ParseStatus status, const Command &cmd)
+{
+    switch (status)
+    {
+    case ParseStatus::UnknownCommand:
+        return "unknown command: " + string{cmd.token};
+    case ParseStatus::MoveUsage:
+        return "usage: move <label> <dir>";
+    case ParseStatus::BadDirection:
+        return "invalid direction: " + string{cmd.token};
+    case ParseStatus::AbilityUsage:
+        return "usage: ability <N> [args]";
+    case ParseStatus::AbilityRange:
+        return "ability id must be between 1 and 5";
+    case ParseStatus::BadTarget:
+        return "invalid ability target";
+    case ParseStatus::MissingColumn:
+        return "missing column for ability";
+    case ParseStatus::MissingFile:
+        return (cmd.kind == CommandKind::Bulk) ? "missing filename for bulk" : "missing filename for sequence";
+    case ParseStatus::BulkUsage:
+        return "usage: bulk <file> [N]";
+    default:
+        return "";
+    }
+}
+
+// ==================== CommandScript ====================
+
+CommandScript::CommandScript(const string &path) : data{nullptr},
+                                                   length{0}
+{
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        throw ParseError("could not open bulk file: " + path);
+    }
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0)
+    {
+        ::close(fd);
+        throw ParseError("could not read bulk file: " + path);
+    }
+    length = static_cast<size_t>(st.st_size);
+
+    // an empty file has nothing to map
+    if (length > 0)
+    {
+        void *map = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map == MAP_FAILED)
+        {
+            ::close(fd);
+            throw ParseError("could not map bulk file: " + path);
+        }
+        data = static_cast<const char *>(map);
+        ::madvise(map, length, MADV_SEQUENTIAL);
+    }
+    ::close(fd);
+
+    string_view text{data, length};
+    size_t estimate = static_cast<size_t>(count(text.begin(), text.end(), '\n')) + 1;
+    commands.reserve(estimate);
+    lines.reserve(estimate);
+
+    size_t start = 0;
+    unsigned lineNo = 0;
+    while (start < text.size())
+    {
+        size_t end = text.find('\n', start);
+        if (end == string_view::npos)
+        {
+            end = text.size();
+        }
+        ++lineNo;
+
+        Command cmd;
+        ParseStatus status = parseCommand(text.substr(start, end - start), cmd);
+        if (status != ParseStatus::Ok || cmd.kind == CommandKind::Bulk)
+        {
+            string msg = "line " + to_string(lineNo) + ": " +
+                         (status != ParseStatus::Ok ? parseErrorMessage(status, cmd) : "bulk cannot be nested");
+            if (data)
+            {
+                ::munmap(const_cast<char *>(data), length);
+            }
+            throw ParseError(msg);
+        }
+        if (cmd.kind != CommandKind::Empty)
+        {
+            commands.push_back(cmd);
+            lines.push_back(lineNo);
+        }
+        start = end + 1;
+    }
+}
+
+CommandScript::~CommandScript()
+{
+    if (data)
+    {
+        ::munmap(const_cast<char *>(data), length);
+    }
+}
+
+size_t CommandScript::size() const
+{
+    return commands.size();
+}
+
+const Command &CommandScript::at(size_t i) const
+{
+    return commands[i];
+}
+
+size_t CommandScript::line(size_t i) const
+{
+    return lines[i];
+}
@@ -0,0 +1,82 @@
+export module command;
+
+import <string>;
+import <string_view>;
+import <vector>;
+import types;
+
+using namespace std;
+
+// the commands a player can type at the prompt
+export enum class CommandKind {
+    Empty,
+    Move,
+    Ability,
+    Abilities,
+    Board,
+    Sequence,
+    Bulk,
+    Quit
+};
+
+// ParseStatus is the result of parseCommand, Ok or the reason the line was rejected
+export enum class ParseStatus {
+    Ok,
+    UnknownCommand,   // token holds the command word
+    MoveUsage,
+    BadDirection,     // token holds the direction
+    AbilityUsage,
+    AbilityRange,
+    BadTarget,
+    MissingColumn,
+    MissingFile,
+    BulkUsage
+};
+
+// Command is a parsed command line
+//  * token views into the parsed line, so it is only valid while the line is
+export struct Command
+{
+    CommandKind kind;
+    char label;        // move, and ability when hasLabel
+    Direction dir;     // move
+    int abilityId;     // ability, 1 based
+    bool hasLabel;
+    bool hasPos;
+    Position pos;
+    int every;         // bulk: show the board every this many commands, 0 only at the end
+    string_view token; // sequence or bulk file name, or the offending word on an error
+};
+
+// parseCommand tokenizes line in place without allocating
+//  * it accepts exactly what the stream extraction in the original controller did
+//  * on an ability target error kind and abilityId are still filled in so the caller can check the card first
+export ParseStatus parseCommand(string_view line, Command &out) noexcept;
+
+// parseErrorMessage builds the message shown to the player for a failed parse
+export string parseErrorMessage(ParseStatus status, const Command &cmd);
+
+// CommandScript memory-maps a command file and parses every line up front
+//  * blank lines are dropped, any parse error or nested bulk command throws ParseError naming the line
+//  * the commands point into the mapping, so they live as long as the script
+export class CommandScript
+{
+public:
+    explicit CommandScript(const string &path);
+    ~CommandScript();
+
+    CommandScript(const CommandScript &) = delete;
+    CommandScript &operator=(const CommandScript &) = delete;
+
+    size_t size() const;
+    const Command &at(size_t i) const;
+
+    // line returns the 1 based line number command i came from
+    size_t line(size_t i) const;
+
+private:
+    const char *data;
+    size_t length;
+    vector<Command> commands;
+    vector<unsigned> lines;
+};
@@ -5,6 +5,8 @@ module;
 module controller;
 
 import <string>;
+import <string_view>;
+import <coroutine>;
 import <sstream>;
 import <fstream>;
 import <iostream>;
@@ -13,16 +15,188 @@ import view;
 import ability;
 import types;
 import errors;
+import replay;
+import command;
+import chessclock;
 
 using namespace std;
 
+// ==================== CommandFeed ====================
+
+bool CommandFeed::Awaiter::await_ready() const noexcept
+{
+    return false;
+}
+
+void CommandFeed::Awaiter::await_suspend(coroutine_handle<> session) noexcept
+{
+    feed.waiter = session;
+}
+
+string CommandFeed::Awaiter::await_resume()
+{
+    string taken;
+    taken.swap(feed.line);
+    return taken;
+}
+
+CommandFeed::CommandFeed() : waiter{},
+                             line{} {}
+
+CommandFeed::Awaiter CommandFeed::next()
+{
+    return Awaiter{*this};
+}
+
+void CommandFeed::push(string text)
+{
+    if (!waiter)
+    {
+        throw FatalError("no controller session is waiting for input");
+    }
+    line.swap(text);
+    coroutine_handle<> session = waiter;
+    waiter = nullptr;
+    session.resume();
+}
+
+bool CommandFeed::waiting() const
+{
+    return static_cast<bool>(waiter);
+}
+
+// ==================== ControllerTask ====================
+
+ControllerTask ControllerTask::promise_type::get_return_object()
+{
+    return ControllerTask{coroutine_handle<promise_type>::from_promise(*this)};
+}
+
+suspend_never ControllerTask::promise_type::initial_suspend() noexcept
+{
+    return {};
+}
+
+// the frame stays until the task is destroyed, so done() can still be asked
+suspend_always ControllerTask::promise_type::final_suspend() noexcept
+{
+    return {};
+}
+
+void ControllerTask::promise_type::return_void() noexcept
+{
+}
+
+// rethrowing here sends the exception to whoever resumed the session, and leaves it finished
+void ControllerTask::promise_type::unhandled_exception()
+{
+    throw;
+}
+
+ControllerTask::ControllerTask() : handle{} {}
+
+ControllerTask::ControllerTask(coroutine_handle<promise_type> h) : handle{h} {}
+
+ControllerTask::ControllerTask(ControllerTask &&other) noexcept : handle{other.handle}
+{
+    other.handle = nullptr;
+}
+
+ControllerTask &ControllerTask::operator=(ControllerTask &&other) noexcept
+{
+    if (this != &other)
+    {
+        if (handle)
+        {
+            handle.destroy();
+        }
+        handle = other.handle;
+        other.handle = nullptr;
+    }
+    return *this;
+}
+
+ControllerTask::~ControllerTask()
+{
+    if (handle)
+    {
+        handle.destroy();
+    }
+}
+
+bool ControllerTask::done() const
+{
+    return !handle || handle.done();
+}
+
+// ==================== Controller ====================
+
 // Controller constructor initializes references and state
 Controller::Controller(Game &g, IView &v) : game{g},
                                             view{v},
                                             abilityUsedThisTurn{false},
                                             quitRequested{false},
                                             lastMessage{"P1's Turn"},
-                                            suppressBoardOnce{false} {}
+                                            suppressBoardOnce{false},
+                                            recorder{nullptr},
+                                            endDelay{2000000},
+                                            fileCommands{true},
+                                            clock{},
+                                            timeWinner{PlayerId::None} {}
+
+void Controller::setRecorder(ReplayWriter *writer)
+{
+    recorder = writer;
+}
+
+void Controller::setEndDelay(unsigned microseconds)
+{
+    endDelay = microseconds;
+}
+
+void Controller::setFileCommands(bool allowed)
+{
+    fileCommands = allowed;
+}
+
+void Controller::setTimeControl(const TimeControl &control)
+{
+    clock.reset(control);
+    timeWinner = PlayerId::None;
+}
+
+bool Controller::clockDeadline(ChessClock::Clock::time_point &at) const
+{
+    if (!clock.running())
+    {
+        return false;
+    }
+    at = clock.deadline();
+    return true;
+}
+
+bool Controller::flagFall(ChessClock::Clock::time_point now)
+{
+    PlayerId mover = game.currentPlayer();
+    if (!clock.running() || clock.remaining(mover, now) > ChessClock::Clock::duration::zero())
+    {
+        return false;
+    }
+    clock.stop(now);
+    timeWinner = (mover == PlayerId::P1) ? PlayerId::P2 : PlayerId::P1;
+    lastMessage = (timeWinner == PlayerId::P1) ? "Player 1 wins on time" : "Player 2 wins on time";
+    return true;
+}
+
+bool Controller::decided() const
+{
+    return game.isOver() || timeWinner != PlayerId::None;
+}
+
+void Controller::showClocks(ChessClock::Clock::time_point now)
+{
+    view.showClocks(formatClock(clock.remaining(PlayerId::P1, now)), formatClock(clock.remaining(PlayerId::P2, now)));
+}
 
 // currentPrompt handles building the right prompt for the active player
 string Controller::currentPrompt() const
@@ -42,155 +216,201 @@ string Controller::currentPrompt() const
 // runs the main loop: display, read command, execute, handle errors
 void Controller::run()
 {
-    while (!quitRequested && !game.isOver())
+    while (!finished())
     {
-        if (!suppressBoardOnce)
-        {
-            view.showBoard(game);
-        }
-        else
-        {
-            // keep current screen (for ability list) and just add msg + prompt
-            suppressBoardOnce = false;
-        }
-
-        view.showMessage("msg: " + lastMessage);
-        view.showPrompt(currentPrompt());
-
-        string line = view.readCommand();
-        // ignore pure whitespace lines
-        {
-            bool onlySpace = true;
-            for (char ch : line)
-            {
-                if (!isspace(static_cast<unsigned char>(ch)))
-                {
-                    onlySpace = false;
-                    break;
-                }
-            }
-            if (onlySpace)
-            {
-                continue;
-            }
-        }
-
-        try
-        {
-            executeCommand(line);
-        }
-        catch (const RaiiError &err)
-        {
-            string base = err.message();
-            PlayerId curr = game.currentPlayer();
-            if (curr == PlayerId::P1)
-            {
-                lastMessage = base + ", P1's Turn";
-            }
-            else if (curr == PlayerId::P2)
-            {
-                lastMessage = base + ", P2's Turn";
-            }
-            else
-            {
-                lastMessage = base;
-            }
-        }
+        showTurn();
+        handleLine(view.readCommand());
     }
 
-    // final display if game ended via moves or abilities
-    if (game.isOver())
+    // final display if game ended via moves, abilities or a clock
+    if (decided())
     {
-        view.showBoard(game);
-        view.showMessage("msg: " + lastMessage);
-        usleep(2000000); // give time to see the game ended
+        showResult();
+        usleep(endDelay); // give time to see the game ended
     }
 }
 
-// executeCommand parses the first word and dispatches to the right handler
-void Controller::executeCommand(string line)
+// play is run() with the view's readCommand replaced by the feed
+ControllerTask Controller::play(CommandFeed &feed)
 {
-    istringstream iss{line};
-    string cmd;
-    if (!(iss >> cmd))
+    while (!finished())
     {
-        return; // empty line
+        showTurn();
+        string line = co_await feed.next();
+        handleLine(line);
     }
 
-    if (cmd == "move")
+    if (decided())
     {
-        cmdMove(iss);
+        showResult();
     }
-    else if (cmd == "ability")
+}
+
+bool Controller::finished() const
+{
+    return quitRequested || decided();
+}
+
+// showTurn draws the board (unless the abilities list is on screen), the last message and the prompt
+void Controller::showTurn()
+{
+    if (clock.enabled())
     {
-        cmdAbility(iss);
+        ChessClock::Clock::time_point now = ChessClock::Clock::now();
+        if (!clock.running() && !finished())
+        {
+            clock.start(game.currentPlayer(), now);
+        }
+        showClocks(now);
     }
-    else if (cmd == "abilities")
+
+    if (!suppressBoardOnce)
     {
-        cmdAbilities();
+        view.showBoard(game);
     }
-    else if (cmd == "board")
+    else
     {
-        cmdBoard();
+        // keep current screen (for ability list) and just add msg + prompt
+        suppressBoardOnce = false;
     }
-    else if (cmd == "sequence")
+
+    view.showMessage("msg: " + lastMessage);
+    view.showPrompt(currentPrompt());
+}
+
+// handleLine executes one input line, turning any error into the next message
+void Controller::handleLine(const string &line)
+{
+    // time is charged up to the moment the line arrived
+    if (clock.running() && flagFall(ChessClock::Clock::now()))
+    {
+        return;
+    }
+
+    // ignore pure whitespace lines
+    bool onlySpace = true;
+    for (char ch : line)
     {
-        string fileName;
-        if (!(iss >> fileName))
+        if (!isspace(static_cast<unsigned char>(ch)))
         {
-            throw ParseError("missing filename for sequence");
+            onlySpace = false;
+            break;
         }
-        cmdSequence(fileName);
     }
-    else if (cmd == "quit")
+    if (onlySpace)
     {
-        quitRequested = true;
+        return;
     }
-    else
+
+    try
     {
-        throw ParseError("unknown command: " + cmd);
+        executeCommand(line);
+    }
+    catch (const RaiiError &err)
+    {
+        string base = err.message();
+        PlayerId curr = game.currentPlayer();
+        if (curr == PlayerId::P1)
+        {
+            lastMessage = base + ", P1's Turn";
+        }
+        else if (curr == PlayerId::P2)
+        {
+            lastMessage = base + ", P2's Turn";
+        }
+        else
+        {
+            lastMessage = base;
+        }
     }
 }
 
-// cmdMove parses label and direction, validates, and calls Game::moveLink
-void Controller::cmdMove(istream &iss)
+// showResult draws the final board and the winning message
+void Controller::showResult()
 {
-    char label;
-    string dirStr;
-
-    if (!(iss >> label >> dirStr))
+    if (clock.enabled())
     {
-        throw ParseError("usage: move <label> <dir>");
+        showClocks(ChessClock::Clock::now());
     }
+    view.showBoard(game);
+    view.showMessage("msg: " + lastMessage);
+}
 
-    Direction dir;
+// executeCommand parses the line and dispatches to the right handler
+void Controller::executeCommand(string_view line)
+{
+    Command cmd;
+    ParseStatus status = parseCommand(line, cmd);
 
-    if (dirStr == "up")
+    // ability target errors are reported after the card checks, like before
+    if (status != ParseStatus::Ok && cmd.kind != CommandKind::Ability)
     {
-        dir = Direction::Up;
+        throw ParseError(parseErrorMessage(status, cmd));
     }
-    else if (dirStr == "down")
+
+    switch (cmd.kind)
     {
-        dir = Direction::Down;
+    case CommandKind::Move:
+        cmdMove(cmd);
+        break;
+    case CommandKind::Ability:
+        cmdAbility(cmd, status);
+        break;
+    case CommandKind::Abilities:
+        cmdAbilities();
+        break;
+    case CommandKind::Board:
+        cmdBoard();
+        break;
+    case CommandKind::Sequence:
+        cmdSequence(string{cmd.token});
+        break;
+    case CommandKind::Bulk:
+        cmdBulk(string{cmd.token}, cmd.every);
+        break;
+    case CommandKind::Quit:
+        quitRequested = true;
+        break;
+    default:
+        break; // empty line
     }
-    else if (dirStr == "left")
+}
+
+// cmdMove checks a parsed label and direction against the turn's legal mask, then calls Game::moveLink
+void Controller::cmdMove(const Command &cmd)
+{
+    char label = cmd.label;
+    Direction dir = cmd.dir;
+
+    // an illegal move is a lookup, the game is never asked to try it
+    if (!game.legalMask().canMove(label, dir))
     {
-        dir = Direction::Left;
+        throw MoveError("Invalid Move");
     }
-    else if (dirStr == "right")
+
+    MoveResult res = game.moveLink(label, dir);
+    if (!res.ok)
     {
-        dir = Direction::Right;
+        // the mask and the model disagree, treat it like any illegal move
+        throw MoveError("Invalid Move");
     }
-    else
+
+    if (recorder)
     {
-        throw ParseError("invalid direction: " + dirStr);
+        recorder->recordMove(game, label, dir);
     }
 
-    MoveResult res = game.moveLink(label, dir);
-    if (!res.ok)
+    if (clock.running())
     {
-        // model rejected the move as illegal
-        throw MoveError("Invalid Move");
+        ChessClock::Clock::time_point now = ChessClock::Clock::now();
+        if (res.gameOver)
+        {
+            clock.stop(now);
+        }
+        else
+        {
+            clock.press(now);
+        }
     }
 
     if (res.gameOver)
@@ -230,18 +450,12 @@ void Controller::cmdMove(istream &iss)
     }
 }
 
-// cmdAbility parses ability index and optional args, then calls Ability::use
-void Controller::cmdAbility(istream &iss)
+// cmdAbility checks the card, then calls Ability::use with the parsed arguments
+void Controller::cmdAbility(const Command &cmd, ParseStatus status)
 {
-    int id;
-    if (!(iss >> id))
+    if (status == ParseStatus::AbilityUsage || status == ParseStatus::AbilityRange)
     {
-        throw ParseError("usage: ability <N> [args]");
-    }
-
-    if (id < 1 || id > 5)
-    {
-        throw ParseError("ability id must be between 1 and 5");
+        throw ParseError(parseErrorMessage(status, cmd));
     }
 
     if (abilityUsedThisTurn)
@@ -252,59 +466,23 @@ void Controller::cmdAbility(istream &iss)
     PlayerId user = game.currentPlayer();
     PlayerAbilities &pa = game.getAbilities(user);
 
-    int slot = id - 1;
+    int slot = cmd.abilityId - 1;
     if (pa.isUsed(slot))
     {
         throw AbilityError("ability card already used");
     }
 
-    Ability &ability = pa.abilityAt(slot);
-
-    // parse optional arguments: either a link label, a position, or both
-    bool hasLabel = false;
-    bool hasPos = false;
-    char label = '?';
-    Position pos{0, 0};
-
-    string token;
-    if (iss >> token)
+    if (status != ParseStatus::Ok)
     {
-        // first extra token could be a link label or a row number
-        if (token.size() == 1 &&
-            ((token[0] >= 'a' && token[0] <= 'h') ||
-             (token[0] >= 'A' && token[0] <= 'H')))
-        {
-            hasLabel = true;
-            label = token[0];
-
-            // optionally parse row/col after label
-            int r, c;
-            if (iss >> r >> c)
-            {
-                hasPos = true;
-                pos = Position{r, c};
-            }
-        }
-        else
-        {
-            // treat it as the row
-            int r;
-            if (!(istringstream{token} >> r))
-            {
-                throw ParseError("invalid ability target");
-            }
-
-            int c;
-            if (!(iss >> c))
-            {
-                throw ParseError("missing column for ability");
-            }
-
-            hasPos = true;
-            pos = Position{r, c};
-        }
+        throw ParseError(parseErrorMessage(status, cmd));
     }
 
+    Ability &ability = pa.abilityAt(slot);
+    bool hasLabel = cmd.hasLabel;
+    bool hasPos = cmd.hasPos;
+    char label = cmd.label;
+    Position pos = cmd.pos;
+
     // Ability::use is currently a stub that throws AbilityError
     // Later we will implement real behavior in each concrete ability
     ability.use(game, user, hasLabel, hasPos, label, pos);
@@ -312,6 +490,11 @@ void Controller::cmdAbility(istream &iss)
     pa.markUsed(slot);
     abilityUsedThisTurn = true;
 
+    if (recorder)
+    {
+        recorder->recordAbility(game, slot, hasLabel, label, hasPos, pos);
+    }
+
     // keep the same player's turn; movement will still be required
     PlayerId curr = game.currentPlayer();
     if (curr == PlayerId::P1)
@@ -357,6 +540,11 @@ void Controller::cmdAbilities()
 // cmdSequence opens a file and feeds each line back into executeCommand
 void Controller::cmdSequence(string file)
 {
+    if (!fileCommands)
+    {
+        throw ParseError("sequence is not available here");
+    }
+
     ifstream in{file};
     if (!in)
     {
@@ -390,3 +578,56 @@ void Controller::cmdSequence(string file)
         executeCommand(line);
     }
 }
+
+// cmdBulk runs a command file without the per-line work of cmdSequence
+//  * the whole file is mapped and parsed before anything runs, so a typo anywhere rejects it untouched
+//  * board and abilities commands are skipped since rendering is suppressed until the end
+void Controller::cmdBulk(string file, int every)
+{
+    if (!fileCommands)
+    {
+        throw ParseError("bulk is not available here");
+    }
+
+    CommandScript script{file};
+
+    for (size_t i = 0; i < script.size(); ++i)
+    {
+        if (quitRequested || game.isOver())
+        {
+            break;
+        }
+
+        const Command &cmd = script.at(i);
+        try
+        {
+            switch (cmd.kind)
+            {
+            case CommandKind::Move:
+                cmdMove(cmd);
+                break;
+            case CommandKind::Ability:
+                cmdAbility(cmd, ParseStatus::Ok);
+                break;
+            case CommandKind::Sequence:
+                cmdSequence(string{cmd.token});
+                break;
+            case CommandKind::Quit:
+                quitRequested = true;
+                break;
+            default:
+                break;
+            }
+        }
+        catch (const RaiiError &)
+        {
+            view.showMessage("bulk stopped at line " + to_string(script.line(i)));
+            throw;
+        }
+
+        if (every > 0 && (i + 1) % every == 0)
+        {
+            view.showBoard(game);
+        }
+    }
+}
@@ -1,12 +1,80 @@
 export module controller;
 
 import <string>;
-import <iostream>;
+import <string_view>;
+import <coroutine>;
 import game;
 import view;
+import replay;
+import command;
+import chessclock;
 
 using namespace std;
 
+// CommandFeed is the input of a controller session running as a coroutine
+//  * the session suspends in co_await next() until the driver pushes it a line
+//  * a feed belongs to one session, and holds nothing but the waiting handle and one line
+export class CommandFeed
+{
+public:
+    struct Awaiter
+    {
+        CommandFeed &feed;
+
+        bool await_ready() const noexcept;
+        void await_suspend(coroutine_handle<> session) noexcept;
+        string await_resume();
+    };
+
+    CommandFeed();
+
+    CommandFeed(const CommandFeed &) = delete;
+    CommandFeed &operator=(const CommandFeed &) = delete;
+
+    Awaiter next();
+
+    // push hands line to the waiting session and runs it until it waits again or finishes
+    //  * throws FatalError when no session is waiting
+    void push(string line);
+
+    // waiting is true while a session is suspended on this feed
+    bool waiting() const;
+
+private:
+    coroutine_handle<> waiter;
+    string line;
+};
+
+// ControllerTask owns a controller session coroutine, it starts running as soon as it is created
+export class ControllerTask
+{
+public:
+    struct promise_type
+    {
+        ControllerTask get_return_object();
+        suspend_never initial_suspend() noexcept;
+        suspend_always final_suspend() noexcept;
+        void return_void() noexcept;
+        void unhandled_exception();
+    };
+
+    ControllerTask();
+    ControllerTask(ControllerTask &&other) noexcept;
+    ControllerTask &operator=(ControllerTask &&other) noexcept;
+    ~ControllerTask();
+
+    ControllerTask(const ControllerTask &) = delete;
+    ControllerTask &operator=(const ControllerTask &) = delete;
+
+    // done is true once the session has returned, and for an empty task
+    bool done() const;
+
+private:
+    explicit ControllerTask(coroutine_handle<promise_type> h);
+
+    coroutine_handle<promise_type> handle;
+};
+
 // Controller coordinates commands between the view and the game
 export class Controller
 {
@@ -16,14 +84,27 @@ public:
     // runs the main game loop until quit, EOF, or game over
     void run();
 
+    // play is run as a coroutine: the same loop, but each line is awaited from feed instead of read from the view
+    //  * one thread can drive any number of sessions, resuming each with CommandFeed::push as its input arrives
+    //  * an exception other than the game's own errors propagates out of the push that resumed the session
+    ControllerTask play(CommandFeed &feed);
+
+    // the steps of run(), for callers that feed input themselves instead of blocking in readCommand
+    //  * showTurn draws the board, last message and prompt; handleLine executes one line, errors become the message
+    //  * once finished() is true, showResult draws the final board if the game was won
+    void showTurn();
+    void handleLine(const string &line);
+    bool finished() const;
+    void showResult();
+
     // executeCommand parses a single command line and dispatches helpers
-    void executeCommand(string line);
+    void executeCommand(string_view line);
 
-    // cmdMove parses and executes a move command
-    void cmdMove(istream &iss);
+    // cmdMove executes a parsed move command
+    void cmdMove(const Command &cmd);
 
-    // cmdAbility parses and executes an ability command
-    void cmdAbility(istream &iss);
+    // cmdAbility executes a parsed ability command, status carries any error in its arguments
+    void cmdAbility(const Command &cmd, ParseStatus status);
 
     // cmdBoard shows the current board
     void cmdBoard();
@@ -34,6 +115,33 @@ public:
     // cmdSequence executes commands from a file
     void cmdSequence(string file);
 
+    // cmdBulk executes a whole pre-parsed command file, showing the board every `every` commands
+    void cmdBulk(string file, int every);
+
+    // setRecorder makes every accepted move and ability go into a binary replay
+    void setRecorder(ReplayWriter *writer);
+
+    // setEndDelay sets how long run() leaves the final board up, headless runners use 0
+    void setEndDelay(unsigned microseconds);
+
+    // setFileCommands turns sequence and bulk on or off, a server must not let clients read its files
+    void setFileCommands(bool allowed);
+
+    // setTimeControl gives each player a clock, started by the first showTurn and shown in the player panels
+    //  * a line that arrives after its player's time has run out is not played, that player loses on time
+    void setTimeControl(const TimeControl &control);
+
+    // decided is true once the game has a winner, on the board or on time
+    bool decided() const;
+
+    // clockDeadline sets at to when the player to move runs out of time, false when no clock is running
+    bool clockDeadline(ChessClock::Clock::time_point &at) const;
+
+    // flagFall ends the game on time if the player to move has none left at now, true when it did
+    //  * a driver that does not wait on input can call it at the clock's deadline, then feed an empty
+    //    line so the session shows the result
+    bool flagFall(ChessClock::Clock::time_point now);
+
 private:
     Game &game;
     IView &view;
@@ -41,6 +149,14 @@ private:
     bool quitRequested;
     string lastMessage;
     bool suppressBoardOnce;
+    ReplayWriter *recorder;
+    unsigned endDelay;
+    bool fileCommands;
+    ChessClock clock;
+    PlayerId timeWinner; // PlayerId::None unless a flag has fallen
+
+    // showClocks hands both players' remaining time at now to the view
+    void showClocks(ChessClock::Clock::time_point now);
 
     // currentPrompt builds the prompt string for the active player
     string currentPrompt() const;
@@ -0,0 +1,487 @@
+module;
+
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+
+module engine;
+
+import <string>;
+import <string_view>;
+import <vector>;
+import <memory>;
+import <chrono>;
+import types;
+import cli;
+import game;
+import view;
+import controller;
+import command;
+import bot;
+import errors;
+
+using namespace std;
+
+EngineGame::EngineGame(const CommandLineOptions &setup) : state{setup},
+                                                          sink{},
+                                                          view{sink},
+                                                          controller{make_unique<Controller>(state, view)}
+{
+    controller->setFileCommands(false);
+    controller->setEndDelay(0);
+}
+
+Game &EngineGame::game()
+{
+    return state;
+}
+
+// reset also replaces the controller, so an ability played before the reset cannot block one after it
+void EngineGame::reset(const CommandLineOptions &setup)
+{
+    state.reset(setup);
+    controller = make_unique<Controller>(state, view);
+    controller->setFileCommands(false);
+    controller->setEndDelay(0);
+}
+
+bool EngineGame::play(string_view line)
+{
+    Command cmd;
+    ParseStatus status = parseCommand(line, cmd);
+
+    if (status != ParseStatus::Ok && cmd.kind != CommandKind::Ability)
+    {
+        throw ParseError(parseErrorMessage(status, cmd));
+    }
+
+    bool moved = false;
+    if (cmd.kind == CommandKind::Move)
+    {
+        controller->cmdMove(cmd);
+        moved = true;
+    }
+    else if (cmd.kind == CommandKind::Ability)
+    {
+        controller->cmdAbility(cmd, status);
+    }
+    else
+    {
+        throw ParseError("only move and ability commands can be played: " + string{line});
+    }
+
+    // the view is never drawn to, but keep it from growing if the controller ever does
+    sink.clear();
+    return moved;
+}
+
+void EngineGame::playList(string_view list)
+{
+    for (string_view line : splitCommands(list))
+    {
+        play(line);
+    }
+}
+
+string moveCommand(const BotMove &move)
+{
+    const char *dirs[4] = {"up", "down", "left", "right"};
+    string s = "move ";
+    s += move.label;
+    s += ' ';
+    s += dirs[static_cast<int>(move.dir)];
+    return s;
+}
+
+string abilityCommand(const BotAbility &ability)
+{
+    string s = "ability " + to_string(ability.slot + 1);
+    if (ability.hasLabel)
+    {
+        s += ' ';
+        s += ability.label;
+    }
+    if (ability.hasPos)
+    {
+        s += " " + to_string(ability.pos.row) + " " + to_string(ability.pos.col);
+    }
+    return s;
+}
+
+vector<string_view> splitCommands(string_view list)
+{
+    vector<string_view> out;
+    while (!list.empty())
+    {
+        size_t end = list.find(';');
+        string_view piece = list.substr(0, end);
+        list = (end == string_view::npos) ? string_view{} : list.substr(end + 1);
+
+        size_t first = piece.find_first_not_of(" \t\r");
+        if (first == string_view::npos)
+        {
+            continue;
+        }
+        size_t last = piece.find_last_not_of(" \t\r");
+        out.push_back(piece.substr(first, last - first + 1));
+    }
+    return out;
+}
+
+// waitReady polls fd for events until deadline, false once the deadline has passed
+//  * ppoll takes a timespec, so the wait is not rounded to whole milliseconds
+static bool waitReady(int fd, short events, EngineProcess::Clock::time_point deadline)
+{
+    for (;;)
+    {
+        auto left = chrono::duration_cast<chrono::nanoseconds>(deadline - EngineProcess::Clock::now()).count();
+        if (left <= 0)
+        {
+            return false;
+        }
+
+        pollfd p{fd, events, 0};
+        timespec ts{static_cast<time_t>(left / 1000000000), static_cast<long>(left % 1000000000)};
+        int n = ppoll(&p, 1, &ts, nullptr);
+        if (n > 0)
+        {
+            return true;
+        }
+        if (n < 0 && errno != EINTR)
+        {
+            throw FatalError(string{"poll failed: "} + strerror(errno));
+        }
+    }
+}
+
+EngineProcess::EngineProcess(const string &command) : cmd{command},
+                                                      pid{-1},
+                                                      toEngine{-1},
+                                                      fromEngine{-1},
+                                                      in{},
+                                                      ended{false}
+{
+    int down[2];
+    int up[2];
+    if (pipe2(down, O_CLOEXEC) < 0)
+    {
+        throw FatalError(string{"cannot create a pipe: "} + strerror(errno));
+    }
+    if (pipe2(up, O_CLOEXEC) < 0)
+    {
+        close(down[0]);
+        close(down[1]);
+        throw FatalError(string{"cannot create a pipe: "} + strerror(errno));
+    }
+
+    // a write to an engine that has exited must fail with EPIPE rather than kill the arbiter
+    signal(SIGPIPE, SIG_IGN);
+
+    pid = fork();
+    if (pid == 0)
+    {
+        // only async-signal-safe calls between fork and exec
+        signal(SIGPIPE, SIG_DFL);
+        dup2(down[0], STDIN_FILENO);
+        dup2(up[1], STDOUT_FILENO);
+        execl("/bin/sh", "sh", "-c", command.c_str(), static_cast<char *>(nullptr));
+        _exit(127);
+    }
+
+    close(down[0]);
+    close(up[1]);
+    if (pid < 0)
+    {
+        close(down[1]);
+        close(up[0]);
+        throw FatalError(string{"cannot start engine: "} + strerror(errno));
+    }
+
+    toEngine = down[1];
+    fromEngine = up[0];
+    fcntl(toEngine, F_SETFL, fcntl(toEngine, F_GETFL) | O_NONBLOCK);
+    fcntl(fromEngine, F_SETFL, fcntl(fromEngine, F_GETFL) | O_NONBLOCK);
+}
+
+EngineProcess::~EngineProcess()
+{
+    Clock::time_point deadline = Clock::now() + chrono::milliseconds{200};
+    send("quit", deadline);
+    close(toEngine);
+
+    // give the engine a moment to exit by itself, reading whatever it still says so it cannot block on a full pipe
+    string rest;
+    while (readLine(rest, deadline))
+    {
+    }
+
+    int status = 0;
+    if (waitpid(pid, &status, WNOHANG) == 0)
+    {
+        kill(pid, SIGKILL);
+        waitpid(pid, &status, 0);
+    }
+    close(fromEngine);
+}
+
+bool EngineProcess::send(const string &line, Clock::time_point deadline)
+{
+    string data = line + '\n';
+    size_t put = 0;
+
+    while (put < data.size())
+    {
+        ssize_t n = write(toEngine, data.data() + put, data.size() - put);
+        if (n > 0)
+        {
+            put += static_cast<size_t>(n);
+        }
+        else if (n < 0 && errno == EAGAIN)
+        {
+            if (!waitReady(toEngine, POLLOUT, deadline))
+            {
+                return false;
+            }
+        }
+        else if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        else
+        {
+            ended = true; // EPIPE: the engine has gone
+            return false;
+        }
+    }
+    return true;
+}
+
+bool EngineProcess::readLine(string &line, Clock::time_point deadline)
+{
+    for (;;)
+    {
+        size_t nl = in.find('\n');
+        if (nl != string::npos)
+        {
+            line.assign(in, 0, nl);
+            if (!line.empty() && line.back() == '\r')
+            {
+                line.pop_back();
+            }
+            in.erase(0, nl + 1);
+            return true;
+        }
+        if (ended)
+        {
+            return false;
+        }
+
+        char buf[4096];
+        ssize_t n = read(fromEngine, buf, sizeof buf);
+        if (n > 0)
+        {
+            in.append(buf, static_cast<size_t>(n));
+        }
+        else if (n == 0)
+        {
+            ended = true;
+        }
+        else if (errno == EAGAIN)
+        {
+            if (!waitReady(fromEngine, POLLIN, deadline))
+            {
+                return false;
+            }
+        }
+        else if (errno != EINTR)
+        {
+            ended = true;
+        }
+    }
+}
+
+bool EngineProcess::alive() const
+{
+    return !ended;
+}
+
+const string &EngineProcess::command() const
+{
+    return cmd;
+}
+
+EnginePlayer::EnginePlayer(const string &command) : process{command},
+                                                    engineName{command},
+                                                    pending{},
+                                                    turns{0},
+                                                    total{0},
+                                                    longest{0} {}
+
+// waitFor reads lines until reply, picking up the engine's name on the way
+bool EnginePlayer::waitFor(const string &reply, EngineProcess::Clock::time_point deadline)
+{
+    string line;
+    while (process.readLine(line, deadline))
+    {
+        if (line == reply)
+        {
+            return true;
+        }
+        if (line.rfind("id name ", 0) == 0)
+        {
+            engineName = line.substr(8);
+        }
+    }
+    return false;
+}
+
+void EnginePlayer::start(chrono::milliseconds limit)
+{
+    EngineProcess::Clock::time_point deadline = EngineProcess::Clock::now() + limit;
+    if (!process.send("raiinet", deadline) || !waitFor("raiinetok", deadline))
+    {
+        throw FatalError("engine \"" + process.command() + "\" did not answer raiinet");
+    }
+}
+
+bool EnginePlayer::newGame(const CommandLineOptions &setup, chrono::milliseconds limit)
+{
+    EngineProcess::Clock::time_point deadline = EngineProcess::Clock::now() + limit;
+    pending.clear();
+    return process.send("newgame " + optionString(setup), deadline) && process.send("isready", deadline) &&
+           waitFor("readyok", deadline);
+}
+
+EngineOutcome EnginePlayer::turn(EngineGame &game, chrono::milliseconds movetime, chrono::milliseconds grace,
+                                 string &answer)
+{
+    using Clock = EngineProcess::Clock;
+
+    // bringing the engine up to date is not its thinking time
+    if (!pending.empty())
+    {
+        if (!process.send("moves " + pending, Clock::now() + grace + movetime))
+        {
+            answer = "could not send the position";
+            return process.alive() ? EngineOutcome::Timeout : EngineOutcome::Crashed;
+        }
+        pending.clear();
+    }
+
+    Clock::time_point began = Clock::now();
+    Clock::time_point deadline = began + movetime + grace;
+    string line;
+    bool answered = process.send("go movetime " + to_string(movetime.count()), deadline);
+    while (answered && (answered = process.readLine(line, deadline)))
+    {
+        if (line.rfind("bestmove ", 0) == 0)
+        {
+            break;
+        }
+    }
+
+    Clock::duration used = Clock::now() - began;
+    long long micros = chrono::duration_cast<chrono::microseconds>(used).count();
+    ++turns;
+    total += micros;
+    longest = max(longest, micros);
+
+    if (!answered)
+    {
+        answer = process.alive() ? "no bestmove in time" : "engine exited";
+        return process.alive() ? EngineOutcome::Timeout : EngineOutcome::Crashed;
+    }
+    if (used > movetime + grace)
+    {
+        answer = "bestmove after " + to_string(micros) + " us";
+        return EngineOutcome::Timeout;
+    }
+
+    string_view list = string_view{line}.substr(9);
+    vector<string_view> commands = splitCommands(list);
+    if (commands.size() == 1 && commands[0] == "none")
+    {
+        // none only draws when it is true, otherwise it is a claim the arbiter does not accept
+        const LegalMask &legal = game.game().legalMask();
+        for (int slot = 0; slot < 8; ++slot)
+        {
+            if (legal.movable(slot))
+            {
+                answer = "bestmove none with a legal move";
+                return EngineOutcome::Illegal;
+            }
+        }
+        answer = "none";
+        return EngineOutcome::NoMove;
+    }
+
+    // an optional ability, then exactly one move; a list whose ability ends the game may stop early
+    answer.clear();
+    bool moved = false;
+    try
+    {
+        for (string_view c : commands)
+        {
+            if (game.game().isOver())
+            {
+                break;
+            }
+            if (moved)
+            {
+                answer = "more than one move in " + string{list};
+                return EngineOutcome::Illegal;
+            }
+            moved = game.play(c);
+            if (!answer.empty())
+            {
+                answer += "; ";
+            }
+            answer += c;
+        }
+    }
+    catch (const RaiiError &e)
+    {
+        answer = string{e.message()} + " in " + string{list};
+        return EngineOutcome::Illegal;
+    }
+
+    if (!moved && !game.game().isOver())
+    {
+        answer = "no move in " + string{list};
+        return EngineOutcome::Illegal;
+    }
+    return EngineOutcome::Played;
+}
+
+void EnginePlayer::played(const string &list)
+{
+    if (!pending.empty())
+    {
+        pending += "; ";
+    }
+    pending += list;
+}
+
+const string &EnginePlayer::name() const
+{
+    return engineName;
+}
+
+long long EnginePlayer::moves() const
+{
+    return turns;
+}
+
+long long EnginePlayer::totalMicros() const
+{
+    return total;
+}
+
+long long EnginePlayer::maxMicros() const
+{
+    return longest;
+}
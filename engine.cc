@@ -0,0 +1,153 @@
+export module engine;
+
+import <string>;
+import <string_view>;
+import <vector>;
+import <memory>;
+import <chrono>;
+import cli;
+import game;
+import view;
+import controller;
+import bot;
+
+using namespace std;
+
+// The engine protocol lets a separate program play, one text line at a time over its stdin and stdout,
+// in the spirit of UCI for chess engines
+//  * arbiter to engine:
+//      raiinet                        answered by any "id name <name>" lines, then "raiinetok"
+//      isready                        answered by "readyok" once earlier commands are done
+//      newgame <setup>                setup is -ability1 / -ability2 / -link1 / -link2 as RAIInet takes them
+//      position startpos [moves <l>]  back to the starting position, then play the command list l
+//      moves <l>                      play l on top of the current position
+//      go movetime <ms>               think for at most ms milliseconds, then answer with bestmove
+//      quit
+//  * engine to arbiter:
+//      bestmove <l>                   what to play this turn: an optional ability command, then a move
+//      bestmove none                  there is no legal move, the game is drawn; a false claim forfeits
+//      info <text>                    ignored
+//  * a command list is controller commands separated by ';', such as "ability 2 B; move a up"
+//  * engines see the whole setup, like in-process bots they are trusted to play from their own side's view
+
+// EngineGame is a game driven by command lists, with the controller's rules
+//  * the arbiter uses it to check engines' answers, engines to follow the position
+export class EngineGame
+{
+public:
+    explicit EngineGame(const CommandLineOptions &setup);
+
+    EngineGame(const EngineGame &) = delete;
+    EngineGame &operator=(const EngineGame &) = delete;
+
+    Game &game();
+
+    // reset returns to the starting position of setup
+    void reset(const CommandLineOptions &setup);
+
+    // play runs one move or ability command through Controller::cmdMove or cmdAbility
+    //  * throws what the controller throws, and ParseError for any other kind of command
+    //  * returns true for a move
+    bool play(string_view command);
+
+    // playList runs every command in a ';' separated list, stopping at the first error
+    void playList(string_view list);
+
+private:
+    Game state;
+    string sink;
+    BufferView view;
+    unique_ptr<Controller> controller; // replaced on reset, it carries the ability-this-turn flag
+};
+
+// moveCommand and abilityCommand write a bot's choice in controller syntax
+export string moveCommand(const BotMove &move);
+export string abilityCommand(const BotAbility &ability);
+
+// splitCommands splits a command list on ';' and trims the pieces, dropping empty ones
+export vector<string_view> splitCommands(string_view list);
+
+// EngineProcess runs an engine command under /bin/sh with pipes to its stdin and stdout
+//  * both pipes are non-blocking, every wait is a poll bounded by a steady_clock deadline, so an engine
+//    that stops answering or stops reading costs at most the time it was given
+//  * the destructor sends quit, and kills the process if it has not exited shortly after
+export class EngineProcess
+{
+public:
+    using Clock = chrono::steady_clock;
+
+    explicit EngineProcess(const string &command);
+    ~EngineProcess();
+
+    EngineProcess(const EngineProcess &) = delete;
+    EngineProcess &operator=(const EngineProcess &) = delete;
+
+    // send writes line and a newline, returns false if the deadline passed or the engine closed its stdin
+    bool send(const string &line, Clock::time_point deadline);
+
+    // readLine waits for the next line of output, returns false on timeout or when the engine exits
+    bool readLine(string &line, Clock::time_point deadline);
+
+    // alive is false once the engine's output has ended or it has closed its input
+    bool alive() const;
+
+    const string &command() const;
+
+private:
+    string cmd;
+    int pid;
+    int toEngine;
+    int fromEngine;
+    string in;
+    bool ended;
+};
+
+// EngineOutcome is how an engine's turn ended
+export enum class EngineOutcome
+{
+    Played,   // a legal answer in time
+    NoMove,   // bestmove none, and the side to move has no legal move
+    Timeout,  // no bestmove before the deadline
+    Illegal,  // the answer broke the rules or was not a bestmove list ending in one move
+    Crashed   // the engine exited or closed its pipes
+};
+
+// EnginePlayer is one engine as the arbiter sees it, with its per-move time accounting
+//  * pending holds the commands played since this engine was last told the position
+export class EnginePlayer
+{
+public:
+    explicit EnginePlayer(const string &command);
+
+    // start sends raiinet and waits for raiinetok, throwing FatalError if it does not come by the deadline
+    void start(chrono::milliseconds limit);
+
+    // newGame sends the setup and waits for readyok, false if it does not come within limit
+    bool newGame(const CommandLineOptions &setup, chrono::milliseconds limit);
+
+    // turn sends the pending commands and go, then plays the answer on game
+    //  * the move is timed from the go line being written to the bestmove line being read, and is
+    //    lost on time past movetime + grace
+    //  * answer holds the bestmove list, or what went wrong
+    EngineOutcome turn(EngineGame &game, chrono::milliseconds movetime, chrono::milliseconds grace, string &answer);
+
+    // played adds a list to what this engine has not been told yet
+    void played(const string &list);
+
+    const string &name() const;
+
+    // time accounting for every turn that reached an answer or timed out
+    long long moves() const;
+    long long totalMicros() const;
+    long long maxMicros() const;
+
+private:
+    EngineProcess process;
+    string engineName;
+    string pending;
+    long long turns;
+    long long total;
+    long long longest;
+
+    bool waitFor(const string &reply, EngineProcess::Clock::time_point deadline);
+};
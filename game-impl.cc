@@ -2,6 +2,8 @@ module game;
 
 import <string>;
 import <memory>;
+import <vector>;
+import <algorithm>;
 import types;
 import board;
 import link;
@@ -132,11 +134,221 @@ int PlayerAbilities::remaining() const
     return count;
 }
 
+// ==================== events ====================
+
+// event builds a GameEvent with every optional field empty
+static GameEvent event(GameEventKind kind, PlayerId player, int link)
+{
+    return GameEvent{kind, player, link, -1, Position{-1, -1}, Position{-1, -1}, DownloadCause::None, false, false};
+}
+
+EventLog::EventLog(size_t capacity) : ring(capacity > 0 ? capacity : 1),
+                                      count{0}
+{
+}
+
+void EventLog::onGameEvent(const GameEvent &e)
+{
+    ring[count % ring.size()] = e;
+    ++count;
+}
+
+unsigned long long EventLog::next() const
+{
+    return count;
+}
+
+unsigned long long EventLog::oldest() const
+{
+    return count > ring.size() ? count - ring.size() : 0;
+}
+
+const GameEvent &EventLog::at(unsigned long long n) const
+{
+    return ring[n % ring.size()];
+}
+
+void Game::subscribe(GameObserver *observer)
+{
+    observers.push_back(observer);
+}
+
+void Game::unsubscribe(GameObserver *observer)
+{
+    observers.erase(remove(observers.begin(), observers.end(), observer), observers.end());
+}
+
+void Game::emit(const GameEvent &e) const
+{
+    // every event can change what the player to move may do
+    legalValid = false;
+
+    switch (e.kind)
+    {
+    case GameEventKind::Revealed:
+        projections[indexFor(e.player)].reset();
+        break;
+    case GameEventKind::Battle:
+    case GameEventKind::Boosted:
+    case GameEventKind::Shielded:
+    case GameEventKind::TurnChanged:
+        // nothing a projection shows has changed
+        break;
+    default:
+        projections[0].reset();
+        projections[1].reset();
+        break;
+    }
+
+    for (GameObserver *observer : observers)
+    {
+        observer->onGameEvent(e);
+    }
+}
+
+// ==================== projections ====================
+
+shared_ptr<const Projection> Game::projection(PlayerId viewer) const
+{
+    shared_ptr<const Projection> &cached = projections[indexFor(viewer)];
+    if (!cached)
+    {
+        cached = buildProjection(viewer);
+    }
+    return cached;
+}
+
+shared_ptr<const Projection> Game::buildProjection(PlayerId viewer) const
+{
+    auto p = make_shared<Projection>();
+    p->viewer = viewer;
+
+    for (int i = 0; i < 16; ++i)
+    {
+        const Link &lnk = links[i];
+        LinkView &v = p->links[i];
+        v.label = lnk.getLabel();
+        v.alive = lnk.isAlive();
+        v.known = (lnk.getOwner() == viewer) || lnk.isKnownBy(viewer);
+        v.kind = v.known ? lnk.getKind() : LinkKind::Data;
+        v.strength = v.known ? lnk.getStrength() : 0;
+        v.pos = Position{-1, -1};
+    }
+
+    for (int r = 0; r < 8; ++r)
+    {
+        for (int c = 0; c < 8; ++c)
+        {
+            const Cell &cell = boardState.at(Position{r, c});
+            int sq = r * 8 + c;
+            p->linkAt[sq] = -1;
+            if (cell.getKind() == CellKind::Link)
+            {
+                int idx = cell.getLinkIndex();
+                p->linkAt[sq] = static_cast<signed char>(idx);
+                p->glyphs[sq] = links[idx].getLabel();
+                p->links[idx].pos = Position{r, c};
+            }
+            else if (cell.firewallPresent())
+            {
+                p->glyphs[sq] = (cell.getFirewallOwner() == PlayerId::P1) ? 'm' : 'w';
+            }
+            else if (cell.isServerPortFor(PlayerId::P1) || cell.isServerPortFor(PlayerId::P2))
+            {
+                p->glyphs[sq] = 'S';
+            }
+            else
+            {
+                p->glyphs[sq] = '.';
+            }
+        }
+    }
+    return p;
+}
+
+// ==================== legal mask ====================
+
+static int slotForLabel(PlayerId player, char label)
+{
+    char first = (player == PlayerId::P1) ? 'a' : 'A';
+    return (label >= first && label < first + 8) ? label - first : -1;
+}
+
+bool LegalMask::canMove(char label, Direction dir) const
+{
+    int slot = slotForLabel(player, label);
+    return slot >= 0 && (moves[slot] >> static_cast<int>(dir) & 1) != 0;
+}
+
+bool LegalMask::movable(int slot) const
+{
+    return moves[slot] != 0;
+}
+
+const LegalMask &Game::legalMask() const
+{
+    if (!legalValid)
+    {
+        buildLegalMask();
+        legalValid = true;
+    }
+    return legal;
+}
+
+// buildLegalMask runs resolveMove for every label and direction
+void Game::buildLegalMask() const
+{
+    static const Direction directions[4] = {Direction::Up, Direction::Down, Direction::Left, Direction::Right};
+
+    LegalMask &m = legal;
+    m = LegalMask{};
+    m.player = current;
+    if (current != PlayerId::P1 && current != PlayerId::P2)
+    {
+        return;
+    }
+
+    char first = (current == PlayerId::P1) ? 'a' : 'A';
+    for (int slot = 0; slot < 8; ++slot)
+    {
+        for (int d = 0; d < 4; ++d)
+        {
+            int linkIdx = -1;
+            Position src{0, 0};
+            Position dest{0, 0};
+            m.dest[slot][d] = -1;
+            if (resolveMove(static_cast<char>(first + slot), directions[d], linkIdx, src, dest))
+            {
+                m.moves[slot] |= static_cast<unsigned char>(1 << d);
+                if (boardState.inBounds(dest))
+                {
+                    m.dest[slot][d] = static_cast<signed char>(dest.row * 8 + dest.col);
+                }
+            }
+        }
+    }
+}
+
 // Game constructor builds the initial board, links, and player states
 Game::Game(const CommandLineOptions &options)
     : boardState{},
-      current{PlayerId::P1}
+      current{PlayerId::P1},
+      legal{},
+      legalValid{false}
 {
+    reset(options);
+}
+
+// reset puts the game back to its starting position so headless runners can reuse one instance
+void Game::reset(const CommandLineOptions &options)
+{
+    boardState = Board{};
+    current = PlayerId::P1;
+
+    for (int i = 0; i < 16; ++i)
+    {
+        links[i] = Link{};
+    }
 
     players[0] = PlayerState{PlayerId::P1};
     players[1] = PlayerState{PlayerId::P2};
@@ -154,6 +366,223 @@ Game::Game(const CommandLineOptions &options)
     // link layout for each player is controlled by link1/link2 options
     setupLinksForPlayer(PlayerId::P1, options.link1);
     setupLinksForPlayer(PlayerId::P2, options.link2);
+
+    emit(event(GameEventKind::Reset, current, -1));
+}
+
+// snapshot packs the board, links, players and ability cards into a GameState
+GameState Game::snapshot() const
+{
+    GameState s{};
+
+    for (int r = 0; r < 8; ++r)
+    {
+        for (int c = 0; c < 8; ++c)
+        {
+            const Cell &cell = boardState.at(Position{r, c});
+            int i = r * 8 + c;
+            s.cells[i] = (cell.getKind() == CellKind::Link)
+                             ? static_cast<unsigned char>(cell.getLinkIndex() + 1)
+                             : 0;
+            if (cell.firewallPresent())
+            {
+                s.firewalls[i] = (cell.getFirewallOwner() == PlayerId::P1) ? 1 : 2;
+            }
+        }
+    }
+
+    for (int i = 0; i < 16; ++i)
+    {
+        const Link &lnk = links[i];
+        unsigned char flags = 0;
+        flags |= (lnk.getKind() == LinkKind::Virus) ? GameState::Virus : 0;
+        flags |= lnk.isAlive() ? GameState::Alive : 0;
+        flags |= lnk.isKnownBy(PlayerId::P1) ? GameState::KnownByP1 : 0;
+        flags |= lnk.isKnownBy(PlayerId::P2) ? GameState::KnownByP2 : 0;
+        flags |= lnk.isBoosted() ? GameState::Boosted : 0;
+        flags |= lnk.isShielded() ? GameState::Shielded : 0;
+        s.linkFlags[i] = flags;
+        s.linkStrength[i] = static_cast<unsigned char>(lnk.getStrength());
+    }
+
+    for (int p = 0; p < 2; ++p)
+    {
+        s.downloads[2 * p] = static_cast<unsigned char>(players[p].getDownloadedData());
+        s.downloads[2 * p + 1] = static_cast<unsigned char>(players[p].getDownloadedVirus());
+
+        for (int slot = 0; slot < 5; ++slot)
+        {
+            s.abilityCodes[5 * p + slot] = static_cast<unsigned char>(abilities[p].abilityAt(slot).code());
+            s.abilityUsed[5 * p + slot] = abilities[p].isUsed(slot) ? 1 : 0;
+        }
+    }
+
+    s.current = (current == PlayerId::P2) ? 1 : 0;
+    s.turnFlags = static_cast<unsigned char>((jumpReady[0] ? 1 : 0) | (jumpReady[1] ? 2 : 0) |
+                                             (swapReady[0] ? 4 : 0) | (swapReady[1] ? 8 : 0));
+    return s;
+}
+
+// restore rebuilds every piece of game state from a snapshot
+void Game::restore(const GameState &s)
+{
+    boardState = Board{};
+    setupServerPorts();
+
+    for (int i = 0; i < 16; ++i)
+    {
+        PlayerId owner = (i < 8) ? PlayerId::P1 : PlayerId::P2;
+        char label = (i < 8) ? static_cast<char>('a' + i) : static_cast<char>('A' + i - 8);
+        unsigned char flags = s.linkFlags[i];
+
+        links[i] = Link{owner, (flags & GameState::Virus) ? LinkKind::Virus : LinkKind::Data, s.linkStrength[i], label};
+        links[i].setAlive((flags & GameState::Alive) != 0);
+        links[i].setBoosted((flags & GameState::Boosted) != 0);
+        links[i].setShielded((flags & GameState::Shielded) != 0);
+        if (flags & GameState::KnownByP1)
+        {
+            links[i].revealTo(PlayerId::P1);
+        }
+        if (flags & GameState::KnownByP2)
+        {
+            links[i].revealTo(PlayerId::P2);
+        }
+    }
+
+    for (int r = 0; r < 8; ++r)
+    {
+        for (int c = 0; c < 8; ++c)
+        {
+            Cell &cell = boardState.at(Position{r, c});
+            int i = r * 8 + c;
+            if (s.cells[i] != 0)
+            {
+                cell.setLinkIndex(s.cells[i] - 1);
+            }
+            if (s.firewalls[i] != 0)
+            {
+                cell.setFirewall(s.firewalls[i] == 1 ? PlayerId::P1 : PlayerId::P2);
+            }
+        }
+    }
+
+    for (int p = 0; p < 2; ++p)
+    {
+        players[p] = PlayerState{p == 0 ? PlayerId::P1 : PlayerId::P2};
+        players[p].setDownloadedData(s.downloads[2 * p]);
+        players[p].setDownloadedVirus(s.downloads[2 * p + 1]);
+
+        // link slots map to fixed link indices, downloaded links leave an empty slot
+        for (int slot = 0; slot < 8; ++slot)
+        {
+            int idx = 8 * p + slot;
+            players[p].setLinkIndex(slot, links[idx].isAlive() ? idx : -1);
+        }
+
+        string codes(reinterpret_cast<const char *>(s.abilityCodes + 5 * p), 5);
+        abilities[p].configure(codes);
+        for (int slot = 0; slot < 5; ++slot)
+        {
+            if (s.abilityUsed[5 * p + slot])
+            {
+                abilities[p].markUsed(slot);
+            }
+        }
+    }
+
+    current = (s.current == 1) ? PlayerId::P2 : PlayerId::P1;
+    jumpReady[0] = (s.turnFlags & 1) != 0;
+    jumpReady[1] = (s.turnFlags & 2) != 0;
+    swapReady[0] = (s.turnFlags & 4) != 0;
+    swapReady[1] = (s.turnFlags & 8) != 0;
+
+    emit(event(GameEventKind::Reset, current, -1));
+}
+
+// ZobristKeys holds one random key per (field, value) pair of a GameState
+//  * the keys come from a fixed splitmix64 stream so hashes are stable across runs and machines
+struct ZobristKeys
+{
+    unsigned long long cells[64][17];
+    unsigned long long firewalls[64][3];
+    unsigned long long linkFlags[16][64];
+    unsigned long long linkStrength[16][8];
+    unsigned long long downloads[4][8];
+    unsigned long long abilityCodes[10][32];
+    unsigned long long abilityUsed[10];
+    unsigned long long current;
+    unsigned long long turnFlags[16];
+
+    ZobristKeys()
+    {
+        unsigned long long x = 0x5241494E45545A42ULL; // "RAINETZB"
+        auto next = [&x]()
+        {
+            x += 0x9E3779B97F4A7C15ULL;
+            unsigned long long z = x;
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+            return z ^ (z >> 31);
+        };
+
+        auto fillKeys = [&next](unsigned long long *keysOut, int count)
+        {
+            for (int i = 0; i < count; ++i)
+            {
+                keysOut[i] = next();
+            }
+        };
+
+        fillKeys(&cells[0][0], 64 * 17);
+        fillKeys(&firewalls[0][0], 64 * 3);
+        fillKeys(&linkFlags[0][0], 16 * 64);
+        fillKeys(&linkStrength[0][0], 16 * 8);
+        fillKeys(&downloads[0][0], 4 * 8);
+        fillKeys(&abilityCodes[0][0], 10 * 32);
+        fillKeys(abilityUsed, 10);
+        current = next();
+        fillKeys(turnFlags, 16);
+    }
+};
+
+unsigned long long zobristHash(const GameState &s)
+{
+    static const ZobristKeys keys;
+
+    unsigned long long h = 0;
+    for (int i = 0; i < 64; ++i)
+    {
+        h ^= keys.cells[i][s.cells[i] % 17];
+        h ^= keys.firewalls[i][s.firewalls[i] % 3];
+    }
+    for (int i = 0; i < 16; ++i)
+    {
+        h ^= keys.linkFlags[i][s.linkFlags[i] % 64];
+        h ^= keys.linkStrength[i][s.linkStrength[i] % 8];
+    }
+    for (int i = 0; i < 4; ++i)
+    {
+        h ^= keys.downloads[i][s.downloads[i] % 8];
+    }
+    for (int i = 0; i < 10; ++i)
+    {
+        h ^= keys.abilityCodes[i][s.abilityCodes[i] % 32];
+        if (s.abilityUsed[i])
+        {
+            h ^= keys.abilityUsed[i];
+        }
+    }
+    if (s.current)
+    {
+        h ^= keys.current;
+    }
+    h ^= keys.turnFlags[s.turnFlags % 16];
+    return h;
+}
+
+unsigned long long Game::hash() const
+{
+    return zobristHash(snapshot());
 }
 
 // getters and setters
@@ -209,159 +638,55 @@ bool Game::isOver() const
     return winnerIfAny() != PlayerId::None;
 }
 
+PlayerId Game::winner() const
+{
+    return winnerIfAny();
+}
+
 // moveLink implements basic movement, capturing, server ports, ability enhanced movement, and off-edge downloads
 MoveResult Game::moveLink(char label, Direction dir)
 {
-    PlayerId mover = current;
-    if (mover == PlayerId::None)
-    {
-        return MoveResult{false, false, PlayerId::None};
-    }
-
-    // map label to slot for the current player
-    int slot = -1;
-    if (mover == PlayerId::P1)
-    {
-        if (label < 'a' || label > 'h')
-        {
-            return MoveResult{false, false, PlayerId::None};
-        }
-        slot = label - 'a';
-    }
-    else
-    { // PlayerId::P2
-        if (label < 'A' || label > 'H')
-        {
-            return MoveResult{false, false, PlayerId::None};
-        }
-        slot = label - 'A';
-    }
-
-    PlayerState &ps = getPlayer(mover);
-    int linkIdx = ps.getLinkIndex(slot);
-    if (linkIdx < 0)
-    {
-        // link was already downloaded or does not exist
-        return MoveResult{false, false, PlayerId::None};
-    }
+    int linkIdx = -1;
+    Position src{0, 0};
+    Position dest{0, 0};
 
-    Link &piece = links[linkIdx];
-    if (!piece.isAlive() || piece.getOwner() != mover)
-    {
-        // must move one of your own, alive links
-        return MoveResult{false, false, PlayerId::None};
-    }
-
-    Position src;
-    if (!findLinkPosition(linkIdx, src))
-    {
-        // inconsistent state, treat as invalid move from controller’s perspective
-        return MoveResult{false, false, PlayerId::None};
-    }
-
-    int dr = 0;
-    int dc = 0;
-
-    switch (dir)
-    {
-    case Direction::Up:
-        dr = -1;
-        break;
-    case Direction::Down:
-        dr = 1;
-        break;
-    case Direction::Left:
-        dc = -1;
-        break;
-    case Direction::Right:
-        dc = 1;
-        break;
-    default:
-        return MoveResult{false, false, PlayerId::None};
-    }
-
-    if (dr == 0 && dc == 0)
+    if (!resolveMove(label, dir, linkIdx, src, dest))
     {
         return MoveResult{false, false, PlayerId::None};
     }
 
+    PlayerId mover = current;
     int moverIdx = indexFor(mover);
-
-    // Jump: if jumpReady is set, allow a two-square move like a temporary boost
-    int step = (piece.isBoosted() || jumpReady[moverIdx]) ? 2 : 1;
-
-    Position dest{src.row + dr * step, src.col + dc * step};
-
-    // cannot move off the sides of the board at all
-    if (dest.col < 0 || dest.col >= 8)
-    {
-        return MoveResult{false, false, PlayerId::None};
-    }
-
     PlayerId opponent = (mover == PlayerId::P1) ? PlayerId::P2 : PlayerId::P1;
+    Link &piece = links[linkIdx];
 
     // handle moving off the opponent edge for a download
     if (dest.row < 0 || dest.row >= 8)
     {
-        bool offOpponentEdge = false;
-
-        if (dc == 0)
-        {
-            if (mover == PlayerId::P1 &&
-                src.row == 7 && dr > 0 && dest.row >= 8)
-            {
-                offOpponentEdge = true;
-            }
-            else if (mover == PlayerId::P2 &&
-                     src.row == 0 && dr < 0 && dest.row < 0)
-            {
-                offOpponentEdge = true;
-            }
-        }
-
-        if (!offOpponentEdge)
-        {
-            return MoveResult{false, false, PlayerId::None};
-        }
-
         // legal off-edge download of your own link
-        applyDownload(linkIdx, mover);
-
-        // Jump/Swap only last until the next successful move
-        jumpReady[moverIdx] = false;
-        swapReady[moverIdx] = false;
+        download(linkIdx, mover, DownloadCause::Edge);
 
-        // switch turn
-        current = opponent;
+        endMove(moverIdx, opponent);
         PlayerId w = winnerIfAny();
         bool over = (w != PlayerId::None);
-        return MoveResult{true, over, w};
+        return MoveResult{true, over, w, MoveOutcome::EdgeDownload, linkIdx};
     }
 
     // destination is on the board
     Cell &destCell = boardState.at(dest);
 
-    // cannot move onto your own server ports
-    if (destCell.isServerPortFor(mover))
-    {
-        return MoveResult{false, false, PlayerId::None};
-    }
-
     // moving into opponent server port downloads the moving link for the opponent
     if (destCell.isServerPortFor(opponent))
     {
-        applyDownload(linkIdx, opponent);
-
-        jumpReady[moverIdx] = false;
-        swapReady[moverIdx] = false;
+        download(linkIdx, opponent, DownloadCause::Port);
 
-        current = opponent;
+        endMove(moverIdx, opponent);
         PlayerId w = winnerIfAny();
         bool over = (w != PlayerId::None);
-        return MoveResult{true, over, w};
+        return MoveResult{true, over, w, MoveOutcome::PortDownload, linkIdx};
     }
 
-    // if there is a link at the destination, handle blocking, swap, or battle
+    // if there is a link at the destination, handle swap or battle
     if (destCell.getKind() == CellKind::Link)
     {
         int destIdx = destCell.getLinkIndex();
@@ -369,36 +694,34 @@ MoveResult Game::moveLink(char label, Direction dir)
 
         if (defender.getOwner() == mover)
         {
-            // cannot move onto your own link, unless Swap is active
-            if (!swapReady[moverIdx])
-            {
-                return MoveResult{false, false, PlayerId::None};
-            }
-
-            // perform a swap between src and dest
+            // resolveMove only lets this through when Swap is active
             destCell.setLinkIndex(linkIdx);
             boardState.at(src).setLinkIndex(destIdx);
 
-            jumpReady[moverIdx] = false;
-            swapReady[moverIdx] = false;
+            GameEvent swapped = event(GameEventKind::Swapped, mover, linkIdx);
+            swapped.other = destIdx;
+            swapped.from = src;
+            swapped.to = dest;
+            emit(swapped);
 
-            current = opponent;
+            endMove(moverIdx, opponent);
             PlayerId w = winnerIfAny();
             bool over = (w != PlayerId::None);
-            return MoveResult{true, over, w};
+            return MoveResult{true, over, w, MoveOutcome::Swapped};
         }
 
         // reveal both links to both players
-        piece.revealTo(PlayerId::P1);
-        piece.revealTo(PlayerId::P2);
-        defender.revealTo(PlayerId::P1);
-        defender.revealTo(PlayerId::P2);
+        reveal(linkIdx, PlayerId::P1);
+        reveal(linkIdx, PlayerId::P2);
+        reveal(destIdx, PlayerId::P1);
+        reveal(destIdx, PlayerId::P2);
 
         int atkStrength = piece.getStrength();
         int defStrength = defender.getStrength();
 
         bool attackerWins = (atkStrength > defStrength) ||
                             (atkStrength == defStrength); // attacker wins ties
+        bool shieldUsed = false;
 
         // Shield: if the losing link is shielded, flip the outcome and consume shield
         if (attackerWins)
@@ -408,6 +731,7 @@ MoveResult Game::moveLink(char label, Direction dir)
             {
                 attackerWins = false;        // flip outcome
                 defender.setShielded(false); // consume shield
+                shieldUsed = true;
             }
         }
         else
@@ -417,35 +741,50 @@ MoveResult Game::moveLink(char label, Direction dir)
             {
                 attackerWins = true;      // flip outcome
                 piece.setShielded(false); // consume shield
+                shieldUsed = true;
             }
         }
 
+        GameEvent battle = event(GameEventKind::Battle, mover, linkIdx);
+        battle.other = destIdx;
+        battle.from = src;
+        battle.to = dest;
+        battle.attackerWon = attackerWins;
+        battle.shieldUsed = shieldUsed;
+        emit(battle);
+
         if (attackerWins)
         {
             // attacker downloads the defender
-            applyDownload(destIdx, mover);
+            download(destIdx, mover, DownloadCause::Battle);
 
             // move attacker into destination
             boardState.at(src).clearLink();
             destCell.setLinkIndex(linkIdx);
+
+            GameEvent moved = event(GameEventKind::Moved, mover, linkIdx);
+            moved.from = src;
+            moved.to = dest;
+            emit(moved);
         }
         else
         {
             // defender downloads the attacker
-            applyDownload(linkIdx, opponent);
+            download(linkIdx, opponent, DownloadCause::Battle);
             // defender stays in place, src cell already cleared by applyDownload
         }
 
-        jumpReady[moverIdx] = false;
-        swapReady[moverIdx] = false;
-
-        current = opponent;
+        endMove(moverIdx, opponent);
         PlayerId w = winnerIfAny();
-        bool over = (w != PlayerId::None);
-        return MoveResult{true, over, w};
+        MoveResult res{true, w != PlayerId::None, w,
+                       attackerWins ? MoveOutcome::BattleWon : MoveOutcome::BattleLost,
+                       attackerWins ? destIdx : linkIdx};
+        res.shieldUsed = shieldUsed;
+        return res;
     }
 
     // firewall on destination square can affect the moving link
+    bool firewall = false;
     if (destCell.firewallPresent())
     {
         PlayerId fwOwner = destCell.getFirewallOwner();
@@ -453,21 +792,21 @@ MoveResult Game::moveLink(char label, Direction dir)
         if (fwOwner != mover)
         {
             // passing through an opponent firewall reveals this link
-            piece.revealTo(PlayerId::P1);
-            piece.revealTo(PlayerId::P2);
+            firewall = true;
+            reveal(linkIdx, PlayerId::P1);
+            reveal(linkIdx, PlayerId::P2);
 
             if (piece.getKind() == LinkKind::Virus)
             {
                 // viruses are immediately downloaded by their owner
-                applyDownload(linkIdx, mover);
+                download(linkIdx, mover, DownloadCause::Firewall);
 
-                jumpReady[moverIdx] = false;
-                swapReady[moverIdx] = false;
-
-                current = opponent;
+                endMove(moverIdx, opponent);
                 PlayerId w = winnerIfAny();
                 bool over = (w != PlayerId::None);
-                return MoveResult{true, over, w};
+                MoveResult res{true, over, w, MoveOutcome::FirewallDownload, linkIdx};
+                res.firewall = true;
+                return res;
             }
         }
     }
@@ -476,20 +815,34 @@ MoveResult Game::moveLink(char label, Direction dir)
     boardState.at(src).clearLink();
     destCell.setLinkIndex(linkIdx);
 
-    jumpReady[moverIdx] = false;
-    swapReady[moverIdx] = false;
+    GameEvent moved = event(GameEventKind::Moved, mover, linkIdx);
+    moved.from = src;
+    moved.to = dest;
+    emit(moved);
 
-    current = opponent;
+    endMove(moverIdx, opponent);
     PlayerId w = winnerIfAny();
     bool over = (w != PlayerId::None);
-    return MoveResult{true, over, w};
+    MoveResult res{true, over, w};
+    res.firewall = firewall;
+    return res;
+}
+
+// isLegalMove reports whether moveLink would accept the move without changing any state
+bool Game::isLegalMove(char label, Direction dir) const
+{
+    return legalMask().canMove(label, dir);
 }
 
-// applyDownload updates download counts, reveals the link, and removes it from the board
+// applyDownload is the Download ability's entry point
 void Game::applyDownload(int linkIdx, PlayerId receiver)
 {
-    // applyDownload handles a link being downloaded by a player
+    download(linkIdx, receiver, DownloadCause::Ability);
+}
 
+// download updates download counts, reveals the link, and removes it from the board
+void Game::download(int linkIdx, PlayerId receiver, DownloadCause cause)
+{
     if (linkIdx < 0 || linkIdx >= 16)
     {
         throw FatalError("invalid link index for download");
@@ -520,16 +873,19 @@ void Game::applyDownload(int linkIdx, PlayerId receiver)
     }
 
     // reveal to both players, matches battle behaviour and display logic
-    lnk.revealTo(PlayerId::P1);
-    lnk.revealTo(PlayerId::P2);
+    reveal(linkIdx, PlayerId::P1);
+    reveal(linkIdx, PlayerId::P2);
 
     lnk.setAlive(false);
 
     // remove the link from the board if present
+    GameEvent downloaded = event(GameEventKind::Downloaded, receiver, linkIdx);
+    downloaded.cause = cause;
     Position pos;
     if (findLinkPosition(linkIdx, pos))
     {
         boardState.at(pos).clearLink();
+        downloaded.from = pos;
     }
 
     // clear the slot in the owning player's state
@@ -545,6 +901,30 @@ void Game::applyDownload(int linkIdx, PlayerId receiver)
             }
         }
     }
+
+    emit(downloaded);
+}
+
+// reveal is the only place links become known, so Revealed fires once per link and viewer
+void Game::reveal(int linkIdx, PlayerId viewer)
+{
+    Link &lnk = links[linkIdx];
+    if (lnk.isKnownBy(viewer))
+    {
+        return;
+    }
+    lnk.revealTo(viewer);
+    emit(event(GameEventKind::Revealed, viewer, linkIdx));
+}
+
+void Game::endMove(int moverIdx, PlayerId next)
+{
+    // Jump/Swap only last until the next successful move
+    jumpReady[moverIdx] = false;
+    swapReady[moverIdx] = false;
+
+    current = next;
+    emit(event(GameEventKind::TurnChanged, next, -1));
 }
 
 // ability-related behaviour
@@ -577,6 +957,10 @@ void Game::applyFirewall(Position pos, PlayerId owner)
     }
 
     cell.setFirewall(owner);
+
+    GameEvent placed = event(GameEventKind::FirewallPlaced, owner, -1);
+    placed.to = pos;
+    emit(placed);
 }
 
 void Game::applyBoost(int linkIdx)
@@ -601,6 +985,7 @@ void Game::applyBoost(int linkIdx)
     }
 
     lnk.setBoosted(true);
+    emit(event(GameEventKind::Boosted, lnk.getOwner(), linkIdx));
 }
 
 // applyScan reveals a link to a single player without changing its board state
@@ -624,7 +1009,7 @@ void Game::applyScan(int linkIdx, PlayerId viewer)
     }
 
     // only reveal to the player who used Scan
-    lnk.revealTo(viewer);
+    reveal(linkIdx, viewer);
 }
 
 void Game::applyPolarize(int linkIdx)
@@ -653,6 +1038,7 @@ void Game::applyPolarize(int linkIdx)
     {
         lnk.setKind(LinkKind::Data);
     }
+    emit(event(GameEventKind::Polarized, lnk.getOwner(), linkIdx));
 }
 
 void Game::applyShield(int linkIdx)
@@ -677,6 +1063,7 @@ void Game::applyShield(int linkIdx)
     }
 
     lnk.setShielded(true);
+    emit(event(GameEventKind::Shielded, lnk.getOwner(), linkIdx));
 }
 
 void Game::applyJump(PlayerId user)
@@ -689,6 +1076,7 @@ void Game::applyJump(PlayerId user)
 
     int idx = indexFor(user);
     jumpReady[idx] = true;
+    legalValid = false;
 }
 
 void Game::applySwap(PlayerId user)
@@ -701,10 +1089,129 @@ void Game::applySwap(PlayerId user)
 
     int idx = indexFor(user);
     swapReady[idx] = true;
+    legalValid = false;
 }
 
 // private helpers
 
+// resolveMove runs every movement rule check for the current player and
+// fills in the moving link, its source and its destination when the move is legal
+bool Game::resolveMove(char label, Direction dir, int &linkIdx, Position &src, Position &dest) const
+{
+    PlayerId mover = current;
+    if (mover == PlayerId::None)
+    {
+        return false;
+    }
+
+    // map label to slot for the current player
+    int slot = -1;
+    if (mover == PlayerId::P1)
+    {
+        if (label < 'a' || label > 'h')
+        {
+            return false;
+        }
+        slot = label - 'a';
+    }
+    else
+    { // PlayerId::P2
+        if (label < 'A' || label > 'H')
+        {
+            return false;
+        }
+        slot = label - 'A';
+    }
+
+    const PlayerState &ps = getPlayer(mover);
+    linkIdx = ps.getLinkIndex(slot);
+    if (linkIdx < 0)
+    {
+        // link was already downloaded or does not exist
+        return false;
+    }
+
+    const Link &piece = links[linkIdx];
+    if (!piece.isAlive() || piece.getOwner() != mover)
+    {
+        // must move one of your own, alive links
+        return false;
+    }
+
+    if (!findLinkPosition(linkIdx, src))
+    {
+        // inconsistent state, treat as invalid move from controller’s perspective
+        return false;
+    }
+
+    int dr = 0;
+    int dc = 0;
+
+    switch (dir)
+    {
+    case Direction::Up:
+        dr = -1;
+        break;
+    case Direction::Down:
+        dr = 1;
+        break;
+    case Direction::Left:
+        dc = -1;
+        break;
+    case Direction::Right:
+        dc = 1;
+        break;
+    default:
+        return false;
+    }
+
+    int moverIdx = indexFor(mover);
+
+    // Jump: if jumpReady is set, allow a two-square move like a temporary boost
+    int step = (piece.isBoosted() || jumpReady[moverIdx]) ? 2 : 1;
+
+    dest = Position{src.row + dr * step, src.col + dc * step};
+
+    // cannot move off the sides of the board at all
+    if (dest.col < 0 || dest.col >= 8)
+    {
+        return false;
+    }
+
+    // moving off the top or bottom is only allowed off the opponent edge
+    if (dest.row < 0 || dest.row >= 8)
+    {
+        if (dc != 0)
+        {
+            return false;
+        }
+        if (mover == PlayerId::P1)
+        {
+            return src.row == 7 && dr > 0;
+        }
+        return src.row == 0 && dr < 0;
+    }
+
+    const Cell &destCell = boardState.at(dest);
+
+    // cannot move onto your own server ports
+    if (destCell.isServerPortFor(mover))
+    {
+        return false;
+    }
+
+    // cannot move onto your own link, unless Swap is active
+    if (destCell.getKind() == CellKind::Link &&
+        links[destCell.getLinkIndex()].getOwner() == mover &&
+        !swapReady[moverIdx])
+    {
+        return false;
+    }
+
+    return true;
+}
+
+
 int Game::indexFor(PlayerId id) const
 {
     // precondition id is P1 or P2
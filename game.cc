@@ -34,12 +34,159 @@ private:
     bool used[5];
 };
 
+// GameState is a fixed-size, position-independent snapshot of everything Game tracks
+//  * all fields are bytes so the struct can be written to disk as-is
+export struct GameState
+{
+    unsigned char cells[64];          // link index + 1 on each square, 0 when empty
+    unsigned char firewalls[64];      // 0 none, 1 owned by P1, 2 owned by P2
+    unsigned char linkFlags[16];      // see GameState bit constants below
+    unsigned char linkStrength[16];
+    unsigned char downloads[4];       // P1 data, P1 virus, P2 data, P2 virus
+    unsigned char abilityCodes[10];   // five codes per player
+    unsigned char abilityUsed[10];
+    unsigned char current;            // 0 for P1, 1 for P2
+    unsigned char turnFlags;          // jump/swap readiness per player
+
+    static constexpr unsigned char Virus = 1;
+    static constexpr unsigned char Alive = 2;
+    static constexpr unsigned char KnownByP1 = 4;
+    static constexpr unsigned char KnownByP2 = 8;
+    static constexpr unsigned char Boosted = 16;
+    static constexpr unsigned char Shielded = 32;
+};
+
+// GameEventKind says what a GameEvent describes
+export enum class GameEventKind
+{
+    Moved,          // link went from -> to
+    Swapped,        // link and other exchanged squares, link is now on to
+    Battle,         // link attacked other on to, see attackerWon and shieldUsed
+    Downloaded,     // link left the board at from and was downloaded by player because of cause
+    Revealed,       // link became known to player
+    FirewallPlaced, // player's firewall now on to
+    Boosted,        // link
+    Polarized,      // link
+    Shielded,       // link
+    TurnChanged,    // player is now to move
+    Reset           // reset or restore replaced the whole state, consumers must rescan
+};
+
+// DownloadCause is why a link was downloaded
+export enum class DownloadCause
+{
+    None,
+    Edge,     // moved off the far edge by its owner
+    Port,     // moved into the opponent's server port
+    Battle,
+    Firewall, // a virus walked into an opponent firewall
+    Ability
+};
+
+// GameEvent is one change to the game, fields that do not apply to the kind are -1 / None / false
+export struct GameEvent
+{
+    GameEventKind kind;
+    PlayerId player;
+    int link;
+    int other;
+    Position from;
+    Position to;
+    DownloadCause cause;
+    bool attackerWon;
+    bool shieldUsed;
+};
+
+// GameObserver is told about every change a Game makes, right after the state has changed
+export class GameObserver
+{
+public:
+    virtual ~GameObserver() = default;
+    virtual void onGameEvent(const GameEvent &event) = 0;
+};
+
+// EventLog is a GameObserver that keeps the most recent events in a preallocated ring
+//  * events are numbered from 0 in arrival order; a reader keeps the number it wants next
+//  * a reader that falls more than capacity events behind has lost events and should rescan the game
+export class EventLog : public GameObserver
+{
+public:
+    explicit EventLog(size_t capacity = 256);
+
+    void onGameEvent(const GameEvent &event) override;
+
+    // next returns the number the next event will get, oldest the number of the oldest one still held
+    unsigned long long next() const;
+    unsigned long long oldest() const;
+
+    // at returns event n, which must be in [oldest(), next())
+    const GameEvent &at(unsigned long long n) const;
+
+private:
+    vector<GameEvent> ring;
+    unsigned long long count;
+};
+
+// LinkView is one link as a particular player sees it
+//  * kind and strength are only filled in when known, so a projection never leaks hidden information
+export struct LinkView
+{
+    char label;
+    bool alive;
+    bool known; // owned by the viewer or revealed to them
+    LinkKind kind;
+    int strength;
+    Position pos; // row -1 when off the board
+};
+
+// Projection is the game as one player sees it
+export struct Projection
+{
+    PlayerId viewer;
+    char glyphs[64];        // link label, or '.', 'm', 'w', 'S' for empty, P1/P2 firewall and server port
+    signed char linkAt[64]; // link index on each square, -1 when there is none
+    LinkView links[16];
+};
+
+// LegalMask is every move the player to move may make, worked out once per position
+//  * moves has one bit per Direction for each label slot, dest the square that move lands on, -1 off the board
+//  * abilities are not in it, Ability::use stays the one place their rules and error messages live
+export struct LegalMask
+{
+    PlayerId player;
+    unsigned char moves[8];
+    signed char dest[8][4];
+
+    // canMove is the mask's answer for a move command, false for the other player's labels
+    bool canMove(char label, Direction dir) const;
+
+    // movable is true when the link with this label slot has any legal move
+    bool movable(int slot) const;
+};
+
+// zobristHash hashes every field of a snapshot with fixed Zobrist keys
+export unsigned long long zobristHash(const GameState &state);
+
 // Game owns the board, links, and player states for a single match
 export class Game : public AbilityContext
 {
 public:
     Game(const CommandLineOptions &options);
 
+    // a copy would share the original's observers, so a scratch game is made with snapshot and restore instead
+    Game(const Game &) = delete;
+    Game &operator=(const Game &) = delete;
+
+    // reset returns the game to its starting position for the given options
+    void reset(const CommandLineOptions &options);
+
+    // snapshot captures the full game state, restore puts it back
+    GameState snapshot() const;
+    void restore(const GameState &state);
+
+    // hash returns the Zobrist hash of the current state
+    unsigned long long hash() const;
+
     // getters and setters
     PlayerId currentPlayer() const;
     const Board &board() const;
@@ -52,9 +199,31 @@ public:
 
     bool isOver() const;
 
+    // winner returns the winning player or PlayerId::None while the game is running
+    PlayerId winner() const;
+
     // moveLink implements movement and capturing rules
     MoveResult moveLink(char label, Direction dir);
 
+    // isLegalMove checks a move for the current player without applying it
+    bool isLegalMove(char label, Direction dir) const;
+
+    // legalMask returns the moves the current player may make in this position
+    //  * it is built on the first call after any change to the game, every later call is a lookup
+    const LegalMask &legalMask() const;
+
+    // projection returns the game as viewer sees it
+    //  * it is rebuilt on demand after a move, download, reveal or other event that changes what viewer sees
+    //  * the snapshot is immutable, so it can be shared with other threads and stays valid after later moves
+    //  * calls must come from the thread that drives the game
+    shared_ptr<const Projection> projection(PlayerId viewer) const;
+
+    // subscribe registers an observer for every event from now on, unsubscribe removes it
+    //  * the game does not own observers, they must unsubscribe before they are destroyed
+    //  * games cannot be copied, so every observer hears from exactly the game it subscribed to
+    void subscribe(GameObserver *observer);
+    void unsubscribe(GameObserver *observer);
+
     // applyDownload handles a link being downloaded by a player
     void applyDownload(int linkIdx, PlayerId receiver) override;
 
@@ -90,6 +259,33 @@ private:
     bool jumpReady[2];
     bool swapReady[2];
 
+    vector<GameObserver *> observers;
+
+    // cached projection per viewer, null once an event has made it stale
+    mutable shared_ptr<const Projection> projections[2];
+
+    // cached legal mask for the current position, valid until the next event or ability effect
+    mutable LegalMask legal;
+    mutable bool legalValid;
+
+    // buildLegalMask fills legal from the current position
+    void buildLegalMask() const;
+
+    // buildProjection computes a fresh projection for viewer
+    shared_ptr<const Projection> buildProjection(PlayerId viewer) const;
+
+    // emit drops any projection the event makes stale and passes the event to every observer
+    void emit(const GameEvent &event) const;
+
+    // download is applyDownload with the reason recorded in the event
+    void download(int linkIdx, PlayerId receiver, DownloadCause cause);
+
+    // reveal makes a link known to viewer, emitting Revealed only if it was not known already
+    void reveal(int linkIdx, PlayerId viewer);
+
+    // endMove clears one-turn ability flags and passes the turn after a successful move
+    void endMove(int moverIdx, PlayerId next);
+
     // indexFor converts a PlayerId into an index into players
     int indexFor(PlayerId id) const;
 
@@ -99,6 +295,9 @@ private:
     // setupLinksForPlayer builds links and places them on the board
     void setupLinksForPlayer(PlayerId owner, const string &order);
 
+    // resolveMove validates a move and computes the link, source and destination
+    bool resolveMove(char label, Direction dir, int &linkIdx, Position &src, Position &dest) const;
+
     // findLinkPosition locates the current board position of a link
     bool findLinkPosition(int linkIdx, Position &pos) const;
 
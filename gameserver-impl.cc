@@ -0,0 +1,986 @@
+module;
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/signalfd.h>
+#include <sys/resource.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+
+module gameserver;
+
+import <string>;
+import <vector>;
+import <memory>;
+import <atomic>;
+import <thread>;
+import <iostream>;
+import <chrono>;
+import <queue>;
+import <functional>;
+import <utility>;
+import cli;
+import game;
+import view;
+import controller;
+import chessclock;
+import command;
+import wire;
+import threadpool;
+import errors;
+
+using namespace std;
+
+// lines longer than this without a newline are not commands, the client is dropped
+static const size_t maxLineLength = 4096;
+
+// a client that stops reading is dropped once this much output is waiting for it
+static const size_t maxPendingOutput = 1 << 20;
+
+static const int latencyBuckets = 1001;
+
+struct Session
+{
+    int fd;
+    Game game;
+    string out;      // rendered output not yet sent
+    size_t sent;     // bytes of out already sent
+    BufferView view; // renders into out
+    Controller controller;
+    string in;       // received bytes not yet forming a full line or request
+    bool writing;    // EPOLLOUT is registered
+    bool closing;    // close once out has been sent
+    bool binary;     // speaks the wire protocol instead of text
+    WireEncoder wire[2];
+    CommandFeed feed;    // lines for the text session's controller
+    ControllerTask task; // the text session's Controller::play, empty for wire clients
+    ChessClock::Clock::time_point scheduled; // the flag deadline last queued for this session
+
+    Session(int fd, const CommandLineOptions &setup, bool binary) : fd{fd},
+                                                                    game{setup},
+                                                                    out{},
+                                                                    sent{0},
+                                                                    view{out},
+                                                                    controller{game, view},
+                                                                    in{},
+                                                                    writing{false},
+                                                                    closing{false},
+                                                                    binary{binary},
+                                                                    wire{WireEncoder{game, PlayerId::P1},
+                                                                         WireEncoder{game, PlayerId::P2}},
+                                                                    feed{},
+                                                                    task{},
+                                                                    scheduled{}
+    {
+        controller.setFileCommands(false);
+        controller.setEndDelay(0);
+        if (binary)
+        {
+            game.subscribe(&wire[0]);
+            game.subscribe(&wire[1]);
+        }
+        else
+        {
+            // clocks are only kept for text sessions, a wire client plays both seats
+            controller.setTimeControl(timeControl(setup));
+        }
+    }
+
+    ~Session()
+    {
+        if (binary)
+        {
+            game.unsubscribe(&wire[0]);
+            game.unsubscribe(&wire[1]);
+        }
+    }
+};
+
+// Handoff is an accepted connection on its way to the shard that will own its game
+struct Handoff
+{
+    int fd; // -1 tells the shard to stop
+    bool binary;
+};
+
+// Shard is one worker thread with its own epoll loop and the sessions dealt to it
+//  * only the shard's thread touches its sessions and latency figures
+//  * the throughput counters have a single writer, so they are bumped with plain relaxed stores,
+//    and can be read from any thread while the shard runs
+//  * shards are cache line aligned so two shards never write to the same line
+class alignas(64) Shard
+{
+public:
+    Shard(unsigned index, const ServerOptions &options, atomic<size_t> &live);
+    ~Shard();
+
+    Shard(const Shard &) = delete;
+    Shard &operator=(const Shard &) = delete;
+
+    // start runs the loop on a new thread, pinned to cpu unless it is negative
+    void start(int cpu);
+
+    // adopt queues an accepted connection for the shard and wakes it, from any thread
+    void adopt(int fd, bool binary);
+
+    // stop asks the loop to finish, waits for it, and closes the sessions still open
+    void stop();
+
+    // report writes this shard's line and adds its latency histogram to total
+    void report(ostream &out, vector<unsigned long long> &total, long long &slowestOverall) const;
+
+private:
+    unsigned index;
+    int cpu;
+    const ServerOptions &options;
+    atomic<size_t> &live;
+    int epollFd;
+    int wakeFd;
+    MpscQueue<Handoff> incoming;
+    thread worker;
+
+    vector<unique_ptr<Session>> sessions; // indexed by file descriptor
+
+    // flag deadlines of timed sessions, earliest first
+    //  * an entry is queued whenever a session's deadline moves and checked against the session when it is due,
+    //    so entries left behind by a move or a closed session just fall through
+    using FlagDeadline = pair<ChessClock::Clock::time_point, int>;
+    priority_queue<FlagDeadline, vector<FlagDeadline>, greater<FlagDeadline>> deadlines;
+    vector<unsigned long long> latency;   // command handling time in microsecond buckets, the last collects the rest
+    long long slowest;
+
+    atomic<unsigned long long> served;
+    atomic<unsigned long long> commands;
+    atomic<unsigned long long> bytesIn;
+    atomic<unsigned long long> bytesOut;
+
+    void loop();
+    bool takeIncoming();
+    void openSession(const Handoff &h);
+    void readClient(Session &s);
+    void runLines(Session &s);
+    void runRequests(Session &s);
+    void writeClient(Session &s);
+    void closeClient(Session &s);
+    void recordLatency(long long us);
+    void watch(int fd, bool writable, bool add);
+    void scheduleFlag(Session &s);
+    void expireClocks();
+    int waitTimeout() const;
+};
+
+// bump adds to a counter only its owning thread writes, without a locked instruction
+static void bump(atomic<unsigned long long> &counter, unsigned long long by = 1)
+{
+    counter.store(counter.load(memory_order_relaxed) + by, memory_order_relaxed);
+}
+
+// percentile returns the bucket below which the given fraction of count samples fell
+static long long percentile(const vector<unsigned long long> &buckets, unsigned long long count, double fraction)
+{
+    unsigned long long target = static_cast<unsigned long long>(fraction * static_cast<double>(count));
+    unsigned long long seen = 0;
+    for (size_t us = 0; us < buckets.size(); ++us)
+    {
+        seen += buckets[us];
+        if (seen > target)
+        {
+            return static_cast<long long>(us);
+        }
+    }
+    return static_cast<long long>(buckets.size()) - 1;
+}
+
+static string systemError(const string &what)
+{
+    return what + ": " + strerror(errno);
+}
+
+static int listenUnix(const string &path)
+{
+    sockaddr_un addr{};
+    if (path.size() >= sizeof(addr.sun_path))
+    {
+        throw ParseError("socket path too long: " + path);
+    }
+    addr.sun_family = AF_UNIX;
+    memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+
+    int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+    {
+        throw FatalError(systemError("could not create socket"));
+    }
+    ::unlink(path.c_str());
+    if (::bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0 || ::listen(fd, SOMAXCONN) != 0)
+    {
+        string msg = systemError("could not listen on " + path);
+        ::close(fd);
+        throw FatalError(msg);
+    }
+    return fd;
+}
+
+// listenTcp binds the loopback address only, the protocol has no authentication
+static int listenTcp(int port)
+{
+    int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+    {
+        throw FatalError(systemError("could not create socket"));
+    }
+    int one = 1;
+    ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<unsigned short>(port));
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (::bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0 || ::listen(fd, SOMAXCONN) != 0)
+    {
+        string msg = systemError("could not listen on port " + to_string(port));
+        ::close(fd);
+        throw FatalError(msg);
+    }
+    return fd;
+}
+
+// ==================== GameServer ====================
+
+GameServer::GameServer(const ServerOptions &opts) : options{opts},
+                                                     epollFd{-1},
+                                                     unixFd{-1},
+                                                     tcpFd{-1},
+                                                     wireUnixFd{-1},
+                                                     wireTcpFd{-1},
+                                                     signalFd{-1},
+                                                     shards{},
+                                                     nextGame{0},
+                                                     live{0},
+                                                     accepted{0},
+                                                     refused{0}
+{
+    if (options.unixPath.empty() && options.tcpPort == 0 && options.wireUnixPath.empty() && options.wireTcpPort == 0)
+    {
+        throw ParseError("server needs at least one socket to listen on");
+    }
+
+    // thousands of games need thousands of descriptors
+    rlimit files;
+    if (::getrlimit(RLIMIT_NOFILE, &files) == 0 && files.rlim_cur < files.rlim_max)
+    {
+        files.rlim_cur = files.rlim_max;
+        ::setrlimit(RLIMIT_NOFILE, &files);
+    }
+
+    epollFd = ::epoll_create1(EPOLL_CLOEXEC);
+    if (epollFd < 0)
+    {
+        throw FatalError(systemError("could not create epoll instance"));
+    }
+
+    // SIGINT and SIGTERM arrive through the loop so the server can stop cleanly
+    //  * they are blocked before any shard starts, so the shards inherit the mask and never take them
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGINT);
+    sigaddset(&mask, SIGTERM);
+    ::sigprocmask(SIG_BLOCK, &mask, nullptr);
+    signalFd = ::signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (signalFd < 0)
+    {
+        throw FatalError(systemError("could not create signalfd"));
+    }
+    watch(signalFd);
+
+    if (!options.unixPath.empty())
+    {
+        unixFd = listenUnix(options.unixPath);
+        watch(unixFd);
+    }
+    if (options.tcpPort != 0)
+    {
+        tcpFd = listenTcp(options.tcpPort);
+        watch(tcpFd);
+    }
+    if (!options.wireUnixPath.empty())
+    {
+        wireUnixFd = listenUnix(options.wireUnixPath);
+        watch(wireUnixFd);
+    }
+    if (options.wireTcpPort != 0)
+    {
+        wireTcpFd = listenTcp(options.wireTcpPort);
+        watch(wireTcpFd);
+    }
+
+    // one shard per CPU we may run on unless told otherwise, dealt round robin over those CPUs
+    vector<int> cpus;
+    cpu_set_t allowed;
+    if (::sched_getaffinity(0, sizeof(allowed), &allowed) == 0)
+    {
+        for (int c = 0; c < CPU_SETSIZE; ++c)
+        {
+            if (CPU_ISSET(c, &allowed))
+            {
+                cpus.push_back(c);
+            }
+        }
+    }
+    unsigned count = options.shards;
+    if (count == 0)
+    {
+        count = cpus.empty() ? thread::hardware_concurrency() : static_cast<unsigned>(cpus.size());
+    }
+    if (count == 0)
+    {
+        count = 1;
+    }
+
+    for (unsigned i = 0; i < count; ++i)
+    {
+        shards.push_back(make_unique<Shard>(i, options, live));
+    }
+    for (unsigned i = 0; i < count; ++i)
+    {
+        shards[i]->start(cpus.empty() ? -1 : cpus[i % cpus.size()]);
+    }
+}
+
+GameServer::~GameServer()
+{
+    stopShards();
+    if (unixFd >= 0)
+    {
+        ::close(unixFd);
+        ::unlink(options.unixPath.c_str());
+    }
+    if (tcpFd >= 0)
+    {
+        ::close(tcpFd);
+    }
+    if (wireUnixFd >= 0)
+    {
+        ::close(wireUnixFd);
+        ::unlink(options.wireUnixPath.c_str());
+    }
+    if (wireTcpFd >= 0)
+    {
+        ::close(wireTcpFd);
+    }
+    if (signalFd >= 0)
+    {
+        ::close(signalFd);
+    }
+    if (epollFd >= 0)
+    {
+        ::close(epollFd);
+    }
+}
+
+void GameServer::watch(int fd)
+{
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.fd = fd;
+    ::epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ev);
+}
+
+Shard &GameServer::shardFor(unsigned long long id)
+{
+    return *shards[id % shards.size()];
+}
+
+void GameServer::stopShards()
+{
+    for (unique_ptr<Shard> &shard : shards)
+    {
+        shard->stop();
+    }
+}
+
+void GameServer::run()
+{
+    epoll_event events[16];
+    bool stopping = false;
+
+    while (!stopping)
+    {
+        int n = ::epoll_wait(epollFd, events, 16, -1);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            throw FatalError(systemError("epoll_wait failed"));
+        }
+
+        for (int i = 0; i < n; ++i)
+        {
+            int fd = events[i].data.fd;
+            if (fd == signalFd)
+            {
+                stopping = true;
+            }
+            else
+            {
+                acceptClients(fd, fd == tcpFd || fd == wireTcpFd, fd == wireUnixFd || fd == wireTcpFd);
+            }
+        }
+    }
+    stopShards();
+}
+
+// acceptClients takes every pending connection, numbers its game and passes it to the game's shard
+void GameServer::acceptClients(int listenFd, bool tcp, bool binary)
+{
+    while (true)
+    {
+        int fd = ::accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0)
+        {
+            // EAGAIN means the backlog is empty; anything else (e.g. out of descriptors) waits for the next wakeup
+            return;
+        }
+
+        if (live.load(memory_order_relaxed) >= options.maxGames)
+        {
+            static const char full[] = "msg: server full\n";
+            static const char fullFrame[] = {static_cast<char>(WireErrorFrame | static_cast<unsigned char>(WireError::GameOver))};
+            ::send(fd, binary ? fullFrame : full, binary ? 1 : sizeof(full) - 1, MSG_NOSIGNAL);
+            ::close(fd);
+            ++refused;
+            continue;
+        }
+
+        if (tcp)
+        {
+            // every reply is one small write, Nagle would only add latency
+            int one = 1;
+            ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        }
+
+        live.fetch_add(1, memory_order_relaxed);
+        ++accepted;
+        shardFor(nextGame++).adopt(fd, binary);
+    }
+}
+
+void GameServer::report(ostream &out) const
+{
+    out << "sessions: " << accepted << " accepted, " << refused << " refused, " << live.load() << " open" << endl;
+
+    vector<unsigned long long> total(latencyBuckets, 0);
+    long long slowest = 0;
+    for (const unique_ptr<Shard> &shard : shards)
+    {
+        shard->report(out, total, slowest);
+    }
+
+    unsigned long long commands = 0;
+    for (unsigned long long n : total)
+    {
+        commands += n;
+    }
+    out << "commands: " << commands;
+    if (commands > 0)
+    {
+        out << ", latency p50 " << percentile(total, commands, 0.5) << " us, p99 " << percentile(total, commands, 0.99)
+            << " us, max " << slowest << " us";
+    }
+    out << endl;
+}
+
+// ==================== Shard ====================
+
+Shard::Shard(unsigned index, const ServerOptions &options, atomic<size_t> &live) : index{index},
+                                                                                     cpu{-1},
+                                                                                     options{options},
+                                                                                     live{live},
+                                                                                     epollFd{-1},
+                                                                                     wakeFd{-1},
+                                                                                     incoming{},
+                                                                                     worker{},
+                                                                                     sessions{},
+                                                                                     latency(latencyBuckets, 0),
+                                                                                     slowest{0},
+                                                                                     served{0},
+                                                                                     commands{0},
+                                                                                     bytesIn{0},
+                                                                                     bytesOut{0}
+{
+    epollFd = ::epoll_create1(EPOLL_CLOEXEC);
+    wakeFd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epollFd < 0 || wakeFd < 0)
+    {
+        string msg = systemError("could not create shard " + to_string(index));
+        if (epollFd >= 0)
+        {
+            ::close(epollFd);
+        }
+        throw FatalError(msg);
+    }
+    watch(wakeFd, false, true);
+}
+
+Shard::~Shard()
+{
+    stop();
+    ::close(wakeFd);
+    ::close(epollFd);
+}
+
+void Shard::start(int core)
+{
+    cpu = core;
+    worker = thread{[this]
+                    { loop(); }};
+    if (cpu >= 0)
+    {
+        // a shard that cannot be pinned still works, the scheduler just moves it around
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        if (::pthread_setaffinity_np(worker.native_handle(), sizeof(set), &set) != 0)
+        {
+            cpu = -1;
+        }
+    }
+}
+
+void Shard::adopt(int fd, bool binary)
+{
+    incoming.push(Handoff{fd, binary});
+    unsigned long long one = 1;
+    ssize_t ignored = ::write(wakeFd, &one, sizeof(one));
+    (void)ignored;
+}
+
+void Shard::stop()
+{
+    if (!worker.joinable())
+    {
+        return;
+    }
+    adopt(-1, false);
+    worker.join();
+
+    for (unique_ptr<Session> &s : sessions)
+    {
+        if (s)
+        {
+            closeClient(*s);
+        }
+    }
+}
+
+void Shard::watch(int fd, bool writable, bool add)
+{
+    epoll_event ev{};
+    ev.events = writable ? EPOLLIN | EPOLLOUT : EPOLLIN;
+    ev.data.fd = fd;
+    ::epoll_ctl(epollFd, add ? EPOLL_CTL_ADD : EPOLL_CTL_MOD, fd, &ev);
+}
+
+void Shard::loop()
+{
+    epoll_event events[256];
+    while (true)
+    {
+        int n = ::epoll_wait(epollFd, events, 256, waitTimeout());
+        expireClocks();
+        if (n < 0)
+        {
+            // EINTR only, the shard blocks the signals the server handles
+            continue;
+        }
+
+        for (int i = 0; i < n; ++i)
+        {
+            int fd = events[i].data.fd;
+            if (fd == wakeFd)
+            {
+                if (!takeIncoming())
+                {
+                    return;
+                }
+            }
+            else if (static_cast<size_t>(fd) < sessions.size() && sessions[fd])
+            {
+                Session &s = *sessions[fd];
+                if (events[i].events & (EPOLLERR | EPOLLHUP))
+                {
+                    closeClient(s);
+                    continue;
+                }
+                if (events[i].events & EPOLLOUT)
+                {
+                    writeClient(s);
+                }
+                if (sessions[fd] && (events[i].events & EPOLLIN))
+                {
+                    readClient(*sessions[fd]);
+                }
+            }
+        }
+    }
+}
+
+// takeIncoming opens a session for every queued connection, returning false once told to stop
+bool Shard::takeIncoming()
+{
+    unsigned long long wakeups;
+    ssize_t ignored = ::read(wakeFd, &wakeups, sizeof(wakeups));
+    (void)ignored;
+
+    Handoff h{};
+    while (incoming.pop(h))
+    {
+        if (h.fd < 0)
+        {
+            return false;
+        }
+        openSession(h);
+    }
+    return true;
+}
+
+// openSession starts a game for a new connection and sends its first board, or snapshots to wire clients
+void Shard::openSession(const Handoff &h)
+{
+    if (static_cast<size_t>(h.fd) >= sessions.size())
+    {
+        sessions.resize(static_cast<size_t>(h.fd) + 1);
+    }
+    sessions[h.fd] = make_unique<Session>(h.fd, options.setup, h.binary);
+    bump(served);
+    watch(h.fd, false, true);
+
+    Session &s = *sessions[h.fd];
+    if (h.binary)
+    {
+        s.wire[0].flush(s.out);
+        s.wire[1].flush(s.out);
+    }
+    else
+    {
+        // runs up to the first prompt, showing the board
+        s.task = s.controller.play(s.feed);
+        scheduleFlag(s);
+    }
+    writeClient(s);
+}
+
+// scheduleFlag queues the session's flag deadline if it has moved since it was last queued
+void Shard::scheduleFlag(Session &s)
+{
+    ChessClock::Clock::time_point at;
+    if (!s.closing && s.controller.clockDeadline(at) && at != s.scheduled)
+    {
+        s.scheduled = at;
+        deadlines.push(FlagDeadline{at, s.fd});
+    }
+}
+
+// expireClocks ends every game whose player to move has run out of time, without waiting for their next line
+void Shard::expireClocks()
+{
+    ChessClock::Clock::time_point now = ChessClock::Clock::now();
+    while (!deadlines.empty() && deadlines.top().first <= now)
+    {
+        int fd = deadlines.top().second;
+        deadlines.pop();
+        if (static_cast<size_t>(fd) >= sessions.size() || !sessions[fd] || sessions[fd]->binary)
+        {
+            continue;
+        }
+
+        Session &s = *sessions[fd];
+        if (!s.closing && s.feed.waiting() && s.controller.flagFall(now))
+        {
+            // the empty line wakes the session, which finds the game decided and shows the result
+            s.feed.push(string{});
+            s.closing = s.task.done();
+            writeClient(s);
+        }
+    }
+}
+
+// waitTimeout is how long epoll may block before the earliest flag deadline, rounded up, -1 with none queued
+int Shard::waitTimeout() const
+{
+    if (deadlines.empty())
+    {
+        return -1;
+    }
+    ChessClock::Clock::duration left = deadlines.top().first - ChessClock::Clock::now();
+    if (left <= ChessClock::Clock::duration::zero())
+    {
+        return 0;
+    }
+    long long ms = chrono::ceil<chrono::milliseconds>(left).count();
+    return static_cast<int>(ms < 3600000 ? ms : 3600000);
+}
+
+void Shard::recordLatency(long long us)
+{
+    ++latency[us < latencyBuckets - 1 ? us : latencyBuckets - 1];
+    slowest = us > slowest ? us : slowest;
+    bump(commands);
+}
+
+void Shard::report(ostream &out, vector<unsigned long long> &total, long long &slowestOverall) const
+{
+    unsigned long long n = commands.load(memory_order_relaxed);
+    out << "shard " << index;
+    if (cpu >= 0)
+    {
+        out << " (cpu " << cpu << ")";
+    }
+    out << ": " << served.load(memory_order_relaxed) << " sessions, " << n << " commands, "
+        << bytesIn.load(memory_order_relaxed) << " bytes in, " << bytesOut.load(memory_order_relaxed) << " bytes out";
+    if (n > 0)
+    {
+        out << ", latency p50 " << percentile(latency, n, 0.5) << " us, p99 " << percentile(latency, n, 0.99) << " us";
+    }
+    out << endl;
+
+    for (int us = 0; us < latencyBuckets; ++us)
+    {
+        total[us] += latency[us];
+    }
+    slowestOverall = slowest > slowestOverall ? slowest : slowestOverall;
+}
+
+// readClient takes everything the client has sent and runs the complete lines or requests in it
+void Shard::readClient(Session &s)
+{
+    char buf[4096];
+    bool ended = false;
+    while (!ended)
+    {
+        ssize_t got = ::recv(s.fd, buf, sizeof(buf), 0);
+        if (got > 0)
+        {
+            s.in.append(buf, static_cast<size_t>(got));
+            bump(bytesIn, static_cast<unsigned long long>(got));
+            if (got < static_cast<ssize_t>(sizeof(buf)))
+            {
+                break;
+            }
+            continue;
+        }
+        if (got < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        {
+            break;
+        }
+        if (got < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (got < 0)
+        {
+            closeClient(s);
+            return;
+        }
+        // end of input quits the game as it does at the terminal, after the lines already received
+        ended = true;
+    }
+
+    if (s.binary)
+    {
+        runRequests(s);
+    }
+    else
+    {
+        runLines(s);
+    }
+    s.closing = s.closing || ended;
+
+    if (s.in.size() > maxLineLength)
+    {
+        closeClient(s);
+        return;
+    }
+    writeClient(s);
+}
+
+// runLines feeds every complete line to the session's controller and replies to all of them at once
+void Shard::runLines(Session &s)
+{
+    size_t start = 0;
+    size_t eol;
+    while (!s.closing && (eol = s.in.find('\n', start)) != string::npos)
+    {
+        size_t end = (eol > start && s.in[eol - 1] == '\r') ? eol - 1 : eol;
+        auto began = chrono::steady_clock::now();
+
+        s.feed.push(s.in.substr(start, end - start));
+        s.closing = s.task.done();
+        scheduleFlag(s);
+
+        recordLatency(chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - began).count());
+        start = eol + 1;
+    }
+    s.in.erase(0, start);
+}
+
+// handleRequest applies one wire request through the controller, so the rules and checks are the terminal's
+static void handleRequest(Session &s, const WireRequest &req)
+{
+    if (req.kind == WireRequestKind::Quit)
+    {
+        s.closing = true;
+        return;
+    }
+
+    if (req.kind == WireRequestKind::Resync)
+    {
+        s.wire[0].resync();
+        s.wire[1].resync();
+    }
+    else if (s.game.isOver())
+    {
+        encodeError(s.out, WireError::GameOver);
+        return;
+    }
+    else
+    {
+        Command cmd{};
+        cmd.label = req.label;
+        cmd.dir = req.dir;
+        cmd.abilityId = req.slot + 1;
+        cmd.hasLabel = req.hasLabel;
+        cmd.hasPos = req.hasPos;
+        cmd.pos = req.pos;
+
+        PlayerId user = s.game.currentPlayer();
+        try
+        {
+            if (req.kind == WireRequestKind::Move)
+            {
+                cmd.kind = CommandKind::Move;
+                s.controller.cmdMove(cmd);
+            }
+            else
+            {
+                cmd.kind = CommandKind::Ability;
+                s.controller.cmdAbility(cmd, ParseStatus::Ok);
+                s.wire[0].abilityUsed(user, req.slot);
+                s.wire[1].abilityUsed(user, req.slot);
+            }
+        }
+        catch (const MoveError &)
+        {
+            encodeError(s.out, WireError::IllegalMove);
+            return;
+        }
+        catch (const RaiiError &)
+        {
+            encodeError(s.out, WireError::AbilityRejected);
+            return;
+        }
+    }
+
+    s.wire[0].flush(s.out);
+    s.wire[1].flush(s.out);
+}
+
+// runRequests decodes and applies every complete request; a malformed one ends the connection
+void Shard::runRequests(Session &s)
+{
+    size_t start = 0;
+    while (!s.closing && start < s.in.size())
+    {
+        WireRequest req;
+        size_t used = 0;
+        try
+        {
+            used = decodeRequest(s.in.data() + start, s.in.size() - start, req);
+        }
+        catch (const ParseError &)
+        {
+            encodeError(s.out, WireError::Malformed);
+            s.closing = true;
+            break;
+        }
+        if (used == 0)
+        {
+            break;
+        }
+
+        auto began = chrono::steady_clock::now();
+        handleRequest(s, req);
+        recordLatency(chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - began).count());
+        start += used;
+    }
+    s.in.erase(0, start);
+}
+
+// writeClient sends as much queued output as the socket takes and watches for writability if some is left
+void Shard::writeClient(Session &s)
+{
+    while (s.sent < s.out.size())
+    {
+        ssize_t put = ::send(s.fd, s.out.data() + s.sent, s.out.size() - s.sent, MSG_NOSIGNAL);
+        if (put > 0)
+        {
+            s.sent += static_cast<size_t>(put);
+            bump(bytesOut, static_cast<unsigned long long>(put));
+            continue;
+        }
+        if (put < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (put < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        {
+            break;
+        }
+        closeClient(s);
+        return;
+    }
+
+    if (s.sent == s.out.size())
+    {
+        // keep the buffer's capacity for the next reply
+        s.out.clear();
+        s.sent = 0;
+        if (s.closing)
+        {
+            closeClient(s);
+            return;
+        }
+    }
+    else if (s.out.size() - s.sent > maxPendingOutput)
+    {
+        closeClient(s);
+        return;
+    }
+
+    bool pending = s.sent < s.out.size();
+    if (pending != s.writing)
+    {
+        s.writing = pending;
+        watch(s.fd, pending, false);
+    }
+}
+
+void Shard::closeClient(Session &s)
+{
+    int fd = s.fd;
+    ::close(fd); // also removes it from the epoll set
+    sessions[fd].reset();
+    live.fetch_sub(1, memory_order_relaxed);
+}
+
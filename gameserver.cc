@@ -0,0 +1,80 @@
+export module gameserver;
+
+import <string>;
+import <vector>;
+import <memory>;
+import <atomic>;
+import <iostream>;
+import cli;
+
+using namespace std;
+
+// ServerOptions holds the listening sockets and the setup every game starts with
+export struct ServerOptions
+{
+    string unixPath;         // Unix domain socket path, empty for none
+    int tcpPort;             // TCP port on 127.0.0.1, 0 for none
+    string wireUnixPath;     // the same for clients speaking the binary protocol
+    int wireTcpPort;
+    size_t maxGames;         // connections beyond this are told the server is full
+    unsigned shards;         // worker threads, 0 for one per CPU the process may run on
+    CommandLineOptions setup;
+};
+
+// Session is one client connection and its game, Shard a worker thread and the games it owns;
+// both are defined next to the implementation
+struct Session;
+class Shard;
+
+// GameServer hosts many independent games, spread over a fixed set of worker threads
+//  * every connection gets its own Game and Controller and speaks the terminal protocol:
+//    one command per line, answered with exactly what RAIInet prints (board, "msg: ..." and the prompt)
+//  * sockets are non-blocking; output a slow client cannot take yet is queued until it is writable
+//  * sequence and bulk are refused so clients cannot read files on the server
+//  * connections on the wire sockets speak the binary protocol from the wire module instead, driving both
+//    seats and receiving both viewers' frames
+//
+// The thread calling run accepts connections and numbers the games; game n lives on shard n % shards
+//  * each shard is a thread pinned to one CPU with its own epoll loop and is the only thread that touches
+//    its games, so running a command takes no lock and shares nothing with the other shards
+//  * accepted sockets reach their shard through a lock-free MPSC queue and an eventfd wakeup
+//  * finding a game's shard is arithmetic on its id, there is no shared table to look up
+export class GameServer
+{
+public:
+    explicit GameServer(const ServerOptions &options);
+    ~GameServer();
+
+    GameServer(const GameServer &) = delete;
+    GameServer &operator=(const GameServer &) = delete;
+
+    // run serves clients until SIGINT or SIGTERM, then stops the shards
+    void run();
+
+    // report writes session counts, and per shard throughput and command latency percentiles
+    //  * the latency figures are only final once run has returned
+    void report(ostream &out) const;
+
+private:
+    ServerOptions options;
+    int epollFd;
+    int unixFd;
+    int tcpFd;
+    int wireUnixFd;
+    int wireTcpFd;
+    int signalFd;
+
+    vector<unique_ptr<Shard>> shards;
+    unsigned long long nextGame;
+    atomic<size_t> live; // open sessions on all shards, each shard decrements it as it closes one
+
+    unsigned long long accepted;
+    unsigned long long refused;
+
+    void acceptClients(int listenFd, bool tcp, bool binary);
+    void watch(int fd);
+    void stopShards();
+
+    // shardFor returns the shard that owns game id
+    Shard &shardFor(unsigned long long id);
+};
@@ -0,0 +1,550 @@
+module;
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+module gamestats;
+
+import <string>;
+import <vector>;
+import <map>;
+import <fstream>;
+import <algorithm>;
+import <cstring>;
+import types;
+import cli;
+import link;
+import game;
+import replay;
+import threadpool;
+import errors;
+
+using namespace std;
+
+// file layout: 64 byte header, column directory, column data, then the config dictionary
+static const char statsMagic[8] = {'R', 'A', 'I', 'I', 'C', 'O', 'L', '1'};
+static const size_t statsHeaderSize = 64;
+static const size_t columnEntrySize = 48;
+static const size_t columnNameSize = 24;
+static const size_t scanBlock = 1024;
+
+// column names in file order, the table is implied by the list
+static const char *gameColumns[] = {"game", "winner", "plies", "config", "p1data", "p1virus", "p2data", "p2virus",
+                                    "abilities", "battles", "firewalls"};
+static const char *eventColumns[] = {"game", "ply", "player", "kind", "ability", "outcome", "source", "dlkind",
+                                     "dlstrength", "receiver", "shield", "firewall"};
+static const int gameColumnCount = sizeof(gameColumns) / sizeof(gameColumns[0]);
+static const int eventColumnCount = sizeof(eventColumns) / sizeof(eventColumns[0]);
+
+// GameFacts holds the rows one replay contributes, each vector is a column in file order
+struct GameFacts
+{
+    string config;
+    long long game[gameColumnCount];
+    vector<long long> events[eventColumnCount];
+};
+
+static int playerIndex(PlayerId id)
+{
+    return (id == PlayerId::P1) ? 0 : (id == PlayerId::P2) ? 1 : 2;
+}
+
+static DownloadSource sourceFor(MoveOutcome outcome)
+{
+    switch (outcome)
+    {
+    case MoveOutcome::EdgeDownload:
+        return DownloadSource::Edge;
+    case MoveOutcome::PortDownload:
+        return DownloadSource::Port;
+    case MoveOutcome::BattleWon:
+    case MoveOutcome::BattleLost:
+        return DownloadSource::Battle;
+    case MoveOutcome::FirewallDownload:
+        return DownloadSource::Firewall;
+    default:
+        return DownloadSource::None;
+    }
+}
+
+// collectFacts replays one file, recording what each ply did
+static void collectFacts(const string &path, long long gameId, GameFacts &facts)
+{
+    ReplayReader reader{path};
+
+    // the log outlives the game it observes
+    EventLog log{64};
+    Game game{reader.options()};
+    game.subscribe(&log);
+    facts.config = optionString(reader.options());
+
+    long long abilities = 0;
+    long long battles = 0;
+    long long firewalls = 0;
+
+    for (long long ply = 0; ply < reader.size(); ++ply)
+    {
+        ReplayRecord rec = reader.record(ply);
+        PlayerId mover = game.currentPlayer();
+
+        long long kind = 0;
+        long long code = 0;
+        long long outcome = 0;
+        DownloadSource source = DownloadSource::None;
+        int downloaded = -1;
+        long long shield = 0;
+        long long firewall = 0;
+
+        if (rec.kind == ReplayRecord::Move)
+        {
+            if (rec.b > static_cast<unsigned char>(Direction::Right))
+            {
+                throw FatalError("replay contains an illegal move: " + path);
+            }
+            MoveResult res = game.moveLink(static_cast<char>(rec.a), static_cast<Direction>(rec.b));
+            if (!res.ok)
+            {
+                throw FatalError("replay contains an illegal move: " + path);
+            }
+            outcome = static_cast<long long>(res.outcome);
+            source = sourceFor(res.outcome);
+            downloaded = res.downloaded;
+            shield = res.shieldUsed;
+            firewall = res.firewall;
+            if (res.outcome == MoveOutcome::BattleWon || res.outcome == MoveOutcome::BattleLost)
+            {
+                ++battles;
+            }
+            if (res.firewall)
+            {
+                ++firewalls;
+            }
+        }
+        else
+        {
+            // abilities go through applyRecord, a Downloaded event on the way means the ability took a link
+            unsigned long long mark = log.next();
+            kind = 1;
+            code = (rec.a < 5) ? game.getAbilities(mover).abilityAt(rec.a).code() : 0;
+            applyRecord(game, rec);
+            ++abilities;
+            for (unsigned long long n = mark; n < log.next(); ++n)
+            {
+                if (log.at(n).kind == GameEventKind::Downloaded)
+                {
+                    downloaded = log.at(n).link;
+                    source = DownloadSource::Ability;
+                }
+            }
+        }
+
+        // downloads are always credited to the player whose counter went up
+        long long dlKind = 2;
+        long long dlStrength = 0;
+        long long receiver = 2;
+        if (downloaded >= 0)
+        {
+            const Link &lnk = game.getLink(downloaded);
+            dlKind = (lnk.getKind() == LinkKind::Virus) ? 1 : 0;
+            dlStrength = lnk.getStrength();
+            bool ownerTakes = (source == DownloadSource::Edge || source == DownloadSource::Firewall);
+            PlayerId owner = lnk.getOwner();
+            PlayerId other = (owner == PlayerId::P1) ? PlayerId::P2 : PlayerId::P1;
+            receiver = playerIndex(ownerTakes ? owner : other);
+        }
+
+        long long row[eventColumnCount] = {gameId, ply, playerIndex(mover), kind, code, outcome,
+                                           static_cast<long long>(source), dlKind, dlStrength, receiver,
+                                           shield, firewall};
+        for (int c = 0; c < eventColumnCount; ++c)
+        {
+            facts.events[c].push_back(row[c]);
+        }
+    }
+
+    const PlayerState &p1 = game.getPlayer(PlayerId::P1);
+    const PlayerState &p2 = game.getPlayer(PlayerId::P2);
+    long long row[gameColumnCount] = {gameId, playerIndex(game.winner()), reader.size(), 0,
+                                      p1.getDownloadedData(), p1.getDownloadedVirus(),
+                                      p2.getDownloadedData(), p2.getDownloadedVirus(),
+                                      abilities, battles, firewalls};
+    copy(row, row + gameColumnCount, facts.game);
+}
+
+// writeColumn frame-of-reference encodes values and appends them to out, filling in the directory entry
+static void writeColumn(ofstream &out, unsigned char *entry, const char *name, StatsTable table,
+                        const vector<long long> &values)
+{
+    long long lo = values.empty() ? 0 : *min_element(values.begin(), values.end());
+    long long hi = values.empty() ? 0 : *max_element(values.begin(), values.end());
+    unsigned long long range = static_cast<unsigned long long>(hi) - static_cast<unsigned long long>(lo);
+    int width = (range <= 0xff) ? 1 : (range <= 0xffff) ? 2 : (range <= 0xffffffffULL) ? 4 : 8;
+
+    // keep every column 8-byte aligned so readers can use it in place
+    long long pos = out.tellp();
+    while (pos % 8 != 0)
+    {
+        out.put(0);
+        ++pos;
+    }
+
+    memset(entry, 0, columnEntrySize);
+    strncpy(reinterpret_cast<char *>(entry), name, columnNameSize - 1);
+    entry[24] = static_cast<unsigned char>(table);
+    entry[25] = static_cast<unsigned char>(width);
+    putU64(entry + 32, static_cast<unsigned long long>(lo));
+    putU64(entry + 40, static_cast<unsigned long long>(pos));
+
+    vector<unsigned char> packed(values.size() * width);
+    for (size_t i = 0; i < values.size(); ++i)
+    {
+        unsigned long long v = static_cast<unsigned long long>(values[i]) - static_cast<unsigned long long>(lo);
+        for (int b = 0; b < width; ++b)
+        {
+            packed[i * width + b] = static_cast<unsigned char>(v >> (8 * b));
+        }
+    }
+    out.write(reinterpret_cast<const char *>(packed.data()), static_cast<streamsize>(packed.size()));
+}
+
+void exportGameStats(const vector<string> &replayFiles, const string &outPath, unsigned threads)
+{
+    vector<GameFacts> facts(replayFiles.size());
+    {
+        WorkStealingPool pool{threads};
+        for (size_t i = 0; i < replayFiles.size(); ++i)
+        {
+            pool.submit([&, i]
+                        { collectFacts(replayFiles[i], static_cast<long long>(i), facts[i]); });
+        }
+        pool.wait();
+    }
+
+    // dictionary encode the setups and transpose the rows into columns
+    vector<string> configs;
+    map<string, long long> configIds;
+    vector<long long> gameData[gameColumnCount];
+    vector<long long> eventData[eventColumnCount];
+
+    for (GameFacts &f : facts)
+    {
+        auto it = configIds.find(f.config);
+        if (it == configIds.end())
+        {
+            it = configIds.emplace(f.config, static_cast<long long>(configs.size())).first;
+            configs.push_back(f.config);
+        }
+        f.game[3] = it->second;
+
+        for (int c = 0; c < gameColumnCount; ++c)
+        {
+            gameData[c].push_back(f.game[c]);
+        }
+        for (int c = 0; c < eventColumnCount; ++c)
+        {
+            eventData[c].insert(eventData[c].end(), f.events[c].begin(), f.events[c].end());
+            vector<long long>().swap(f.events[c]);
+        }
+    }
+
+    ofstream out{outPath, ios::binary | ios::trunc};
+    if (!out)
+    {
+        throw FatalError("could not open statistics file for writing: " + outPath);
+    }
+
+    int columnCount = gameColumnCount + eventColumnCount;
+    vector<unsigned char> directory(columnCount * columnEntrySize);
+    vector<unsigned char> header(statsHeaderSize, 0);
+    out.write(reinterpret_cast<const char *>(header.data()), statsHeaderSize);
+    out.write(reinterpret_cast<const char *>(directory.data()), static_cast<streamsize>(directory.size()));
+
+    for (int c = 0; c < gameColumnCount; ++c)
+    {
+        writeColumn(out, &directory[c * columnEntrySize], gameColumns[c], StatsTable::Games, gameData[c]);
+    }
+    for (int c = 0; c < eventColumnCount; ++c)
+    {
+        writeColumn(out, &directory[(gameColumnCount + c) * columnEntrySize], eventColumns[c], StatsTable::Events,
+                    eventData[c]);
+    }
+
+    string dictionary;
+    for (const string &s : configs)
+    {
+        dictionary += s + "\n";
+    }
+    unsigned long long dictOffset = out.tellp();
+    out.write(dictionary.data(), static_cast<streamsize>(dictionary.size()));
+
+    // header last, once every offset is known
+    memcpy(header.data(), statsMagic, sizeof(statsMagic));
+    putU64(&header[8], static_cast<unsigned long long>(columnCount));
+    putU64(&header[16], gameData[0].size());
+    putU64(&header[24], eventData[0].size());
+    putU64(&header[32], dictOffset);
+    putU64(&header[40], dictionary.size());
+    out.seekp(0);
+    out.write(reinterpret_cast<const char *>(header.data()), statsHeaderSize);
+    out.write(reinterpret_cast<const char *>(directory.data()), static_cast<streamsize>(directory.size()));
+    if (!out)
+    {
+        throw FatalError("failed to write statistics file: " + outPath);
+    }
+}
+
+// ==================== StatsFile ====================
+
+StatsFile::StatsFile(const string &path) : mapped{nullptr},
+                                           length{0},
+                                           tableRows{0, 0}
+{
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        throw ParseError("could not open statistics file: " + path);
+    }
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < statsHeaderSize)
+    {
+        ::close(fd);
+        throw ParseError("not a statistics file: " + path);
+    }
+    length = static_cast<size_t>(st.st_size);
+
+    void *m = ::mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (m == MAP_FAILED)
+    {
+        throw ParseError("could not map statistics file: " + path);
+    }
+    mapped = static_cast<const unsigned char *>(m);
+
+    unsigned long long columnCount = getU64(mapped + 8);
+    tableRows[0] = getU64(mapped + 16);
+    tableRows[1] = getU64(mapped + 24);
+    unsigned long long dictOffset = getU64(mapped + 32);
+    unsigned long long dictLength = getU64(mapped + 40);
+
+    bool valid = memcmp(mapped, statsMagic, sizeof(statsMagic)) == 0 &&
+                 statsHeaderSize + columnCount * columnEntrySize <= length && dictOffset + dictLength <= length;
+
+    for (unsigned long long c = 0; valid && c < columnCount; ++c)
+    {
+        const unsigned char *e = mapped + statsHeaderSize + c * columnEntrySize;
+        Column col;
+        col.name = string(reinterpret_cast<const char *>(e), strnlen(reinterpret_cast<const char *>(e), columnNameSize));
+        col.table = (e[24] == 0) ? StatsTable::Games : StatsTable::Events;
+        col.width = e[25];
+        col.base = static_cast<long long>(getU64(e + 32));
+        unsigned long long offset = getU64(e + 40);
+        col.data = mapped + offset;
+        valid = (col.width == 1 || col.width == 2 || col.width == 4 || col.width == 8) &&
+                offset + tableRows[e[24] != 0] * col.width <= length;
+        cols.push_back(col);
+    }
+
+    if (!valid)
+    {
+        ::munmap(const_cast<unsigned char *>(mapped), length);
+        throw ParseError("corrupt statistics file: " + path);
+    }
+
+    string dictionary(reinterpret_cast<const char *>(mapped + dictOffset), dictLength);
+    size_t start = 0;
+    size_t end;
+    while ((end = dictionary.find('\n', start)) != string::npos)
+    {
+        configs.push_back(dictionary.substr(start, end - start));
+        start = end + 1;
+    }
+}
+
+StatsFile::~StatsFile()
+{
+    ::munmap(const_cast<unsigned char *>(mapped), length);
+}
+
+unsigned long long StatsFile::rows(StatsTable table) const
+{
+    return tableRows[table == StatsTable::Events];
+}
+
+int StatsFile::column(StatsTable table, const string &name) const
+{
+    for (size_t c = 0; c < cols.size(); ++c)
+    {
+        if (cols[c].table == table && cols[c].name == name)
+        {
+            return static_cast<int>(c);
+        }
+    }
+    throw ParseError("unknown column: " + name);
+}
+
+vector<string> StatsFile::columnNames(StatsTable table) const
+{
+    vector<string> names;
+    for (const Column &c : cols)
+    {
+        if (c.table == table)
+        {
+            names.push_back(c.name);
+        }
+    }
+    return names;
+}
+
+const string &StatsFile::configName(long long id) const
+{
+    static const string unknown = "?";
+    return (id >= 0 && id < static_cast<long long>(configs.size())) ? configs[id] : unknown;
+}
+
+// unpack widens one block of fixed-width little-endian values, simple enough for the compiler to vectorize
+//  * the bytes are assembled explicitly, on a little-endian host this compiles to plain loads
+template <typename T>
+static void unpack(const unsigned char *src, size_t count, long long base, long long *out)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        const unsigned char *p = src + i * sizeof(T);
+        T v = 0;
+        for (size_t b = 0; b < sizeof(T); ++b)
+        {
+            v = static_cast<T>(v | static_cast<T>(static_cast<T>(p[b]) << (8 * b)));
+        }
+        out[i] = base + static_cast<long long>(v);
+    }
+}
+
+void StatsFile::decode(int col, unsigned long long first, size_t count, long long *out) const
+{
+    const Column &c = cols[col];
+    const unsigned char *src = c.data + first * c.width;
+    switch (c.width)
+    {
+    case 1:
+        unpack<unsigned char>(src, count, c.base, out);
+        break;
+    case 2:
+        unpack<unsigned short>(src, count, c.base, out);
+        break;
+    case 4:
+        unpack<unsigned int>(src, count, c.base, out);
+        break;
+    default:
+        unpack<unsigned long long>(src, count, c.base, out);
+        break;
+    }
+}
+
+// ==================== queries ====================
+
+vector<StatsGroup> runStatsQuery(const StatsFile &file, const StatsQuery &query)
+{
+    vector<int> predCols;
+    for (const StatsPredicate &p : query.where)
+    {
+        if (p.op != '=' && p.op != '!' && p.op != '<' && p.op != '>')
+        {
+            throw ParseError(string("unknown comparison: ") + p.op);
+        }
+        predCols.push_back(file.column(query.table, p.column));
+    }
+    int keyCol = query.groupBy.empty() ? -1 : file.column(query.table, query.groupBy);
+    int aggCol = query.aggregate.empty() ? -1 : file.column(query.table, query.aggregate);
+
+    std::map<long long, StatsGroup> groups;
+    unsigned long long rows = file.rows(query.table);
+
+    long long values[scanBlock];
+    long long keys[scanBlock];
+    long long aggs[scanBlock];
+    unsigned char selected[scanBlock];
+
+    for (unsigned long long first = 0; first < rows; first += scanBlock)
+    {
+        size_t n = static_cast<size_t>(min<unsigned long long>(scanBlock, rows - first));
+        fill(selected, selected + n, 1);
+
+        // each predicate narrows the selection over the whole block before the next column is touched
+        for (size_t p = 0; p < predCols.size(); ++p)
+        {
+            file.decode(predCols[p], first, n, values);
+            long long v = query.where[p].value;
+            switch (query.where[p].op)
+            {
+            case '=':
+                for (size_t i = 0; i < n; ++i)
+                {
+                    selected[i] &= (values[i] == v);
+                }
+                break;
+            case '!':
+                for (size_t i = 0; i < n; ++i)
+                {
+                    selected[i] &= (values[i] != v);
+                }
+                break;
+            case '<':
+                for (size_t i = 0; i < n; ++i)
+                {
+                    selected[i] &= (values[i] < v);
+                }
+                break;
+            default:
+                for (size_t i = 0; i < n; ++i)
+                {
+                    selected[i] &= (values[i] > v);
+                }
+                break;
+            }
+        }
+
+        if (keyCol >= 0)
+        {
+            file.decode(keyCol, first, n, keys);
+        }
+        else
+        {
+            fill(keys, keys + n, 0);
+        }
+        if (aggCol >= 0)
+        {
+            file.decode(aggCol, first, n, aggs);
+        }
+        else
+        {
+            fill(aggs, aggs + n, 0);
+        }
+
+        for (size_t i = 0; i < n; ++i)
+        {
+            if (!selected[i])
+            {
+                continue;
+            }
+            auto it = groups.find(keys[i]);
+            if (it == groups.end())
+            {
+                it = groups.emplace(keys[i], StatsGroup{keys[i], 0, 0, aggs[i], aggs[i]}).first;
+            }
+            StatsGroup &g = it->second;
+            ++g.count;
+            g.sum += aggs[i];
+            g.min = min(g.min, aggs[i]);
+            g.max = max(g.max, aggs[i]);
+        }
+    }
+
+    vector<StatsGroup> result;
+    for (const auto &entry : groups)
+    {
+        result.push_back(entry.second);
+    }
+    return result;
+}
@@ -0,0 +1,98 @@
+export module gamestats;
+
+import <string>;
+import <vector>;
+
+using namespace std;
+
+// the two tables in a statistics file
+//  * Games has one row per replay, Events one row per ply
+export enum class StatsTable {
+    Games,
+    Events
+};
+
+// where a downloaded link came from, stored in the events "source" column
+export enum class DownloadSource {
+    None,
+    Edge,     // moved off the far edge by its owner
+    Port,     // moved into the opponent's server port
+    Battle,   // lost a battle
+    Firewall, // virus stopped by an opponent firewall
+    Ability   // the Download ability
+};
+
+// exportGameStats replays every file on a work-stealing pool and writes a columnar statistics file
+export void exportGameStats(const vector<string> &replayFiles, const string &outPath, unsigned threads);
+
+// StatsFile memory-maps a file written by exportGameStats
+//  * each column is frame-of-reference encoded: values minus the column minimum, packed into 1, 2, 4 or 8 bytes
+export class StatsFile
+{
+public:
+    explicit StatsFile(const string &path);
+    ~StatsFile();
+
+    StatsFile(const StatsFile &) = delete;
+    StatsFile &operator=(const StatsFile &) = delete;
+
+    unsigned long long rows(StatsTable table) const;
+
+    // column returns the index of a column, throws ParseError if table has no such column
+    int column(StatsTable table, const string &name) const;
+    vector<string> columnNames(StatsTable table) const;
+
+    // decode expands count values of a column starting at row first into out
+    void decode(int col, unsigned long long first, size_t count, long long *out) const;
+
+    // configName returns the setup string behind a value of the games "config" column
+    const string &configName(long long id) const;
+
+private:
+    struct Column
+    {
+        string name;
+        StatsTable table;
+        int width;
+        long long base;
+        const unsigned char *data;
+    };
+
+    const unsigned char *mapped;
+    size_t length;
+    unsigned long long tableRows[2];
+    vector<Column> cols;
+    vector<string> configs;
+};
+
+// StatsPredicate compares a column against a constant
+//  * op is one of = ! < > (! is not equal)
+export struct StatsPredicate
+{
+    string column;
+    char op;
+    long long value;
+};
+
+// StatsQuery filters one table and aggregates a column, optionally grouped by another
+//  * an empty groupBy puts every selected row in one group, an empty aggregate only counts rows
+export struct StatsQuery
+{
+    StatsTable table;
+    vector<StatsPredicate> where;
+    string groupBy;
+    string aggregate;
+};
+
+// StatsGroup is one output row of a query
+export struct StatsGroup
+{
+    long long key;
+    unsigned long long count;
+    long long sum;
+    long long min;
+    long long max;
+};
+
+// runStatsQuery scans the file a block of rows at a time, filtering and aggregating column by column
+export vector<StatsGroup> runStatsQuery(const StatsFile &file, const StatsQuery &query);
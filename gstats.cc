@@ -0,0 +1,197 @@
+import <iostream>;
+import <string>;
+import <vector>;
+import <exception>;
+
+import replay;
+import gamestats;
+import errors;
+
+using namespace std;
+
+static const char *usage =
+    "usage: gstats export -out <file> [-threads N] <replay files or directories...>\n"
+    "       gstats query <file> [-table games|events] [-where col=N|col!N|col<N|col>N]... [-by col] [-agg col]\n"
+    "       gstats columns <file>";
+
+static int runExport(int argc, char *argv[])
+{
+    string out;
+    unsigned threads = 0;
+    vector<string> inputs;
+
+    for (int i = 2; i < argc; ++i)
+    {
+        string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "-out" && hasValue)
+        {
+            out = argv[++i];
+        }
+        else if (arg == "-threads" && hasValue)
+        {
+            threads = static_cast<unsigned>(stoul(argv[++i]));
+        }
+        else if (!arg.empty() && arg[0] == '-')
+        {
+            throw ParseError("unknown option " + arg);
+        }
+        else
+        {
+            inputs.push_back(arg);
+        }
+    }
+    if (out.empty() || inputs.empty())
+    {
+        throw ParseError(usage);
+    }
+
+    exportGameStats(collectReplayFiles(inputs), out, threads);
+
+    StatsFile file{out};
+    cout << "exported " << file.rows(StatsTable::Games) << " games and " << file.rows(StatsTable::Events)
+         << " plies" << endl;
+    return 0;
+}
+
+// parsePredicate splits "col<op>value" at the first comparison character
+static StatsPredicate parsePredicate(const string &text)
+{
+    size_t at = text.find_first_of("=!<>");
+    if (at == string::npos || at == 0 || at + 1 >= text.size())
+    {
+        throw ParseError("bad -where clause: " + text);
+    }
+    return StatsPredicate{text.substr(0, at), text[at], stoll(text.substr(at + 1))};
+}
+
+static int runQuery(int argc, char *argv[])
+{
+    if (argc < 3)
+    {
+        throw ParseError(usage);
+    }
+
+    StatsFile file{argv[2]};
+    StatsQuery query{StatsTable::Games, {}, "", ""};
+
+    for (int i = 3; i < argc; ++i)
+    {
+        string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "-table" && hasValue)
+        {
+            string t = argv[++i];
+            if (t != "games" && t != "events")
+            {
+                throw ParseError("unknown table: " + t);
+            }
+            query.table = (t == "games") ? StatsTable::Games : StatsTable::Events;
+        }
+        else if (arg == "-where" && hasValue)
+        {
+            query.where.push_back(parsePredicate(argv[++i]));
+        }
+        else if (arg == "-by" && hasValue)
+        {
+            query.groupBy = argv[++i];
+        }
+        else if (arg == "-agg" && hasValue)
+        {
+            query.aggregate = argv[++i];
+        }
+        else
+        {
+            throw ParseError("unknown option " + arg);
+        }
+    }
+
+    vector<StatsGroup> groups = runStatsQuery(file, query);
+
+    bool byConfig = query.table == StatsTable::Games && query.groupBy == "config";
+    cout << (query.groupBy.empty() ? "all" : query.groupBy) << "\tcount";
+    if (!query.aggregate.empty())
+    {
+        cout << "\tsum\tavg\tmin\tmax";
+    }
+    cout << endl;
+
+    for (const StatsGroup &g : groups)
+    {
+        if (byConfig)
+        {
+            cout << file.configName(g.key);
+        }
+        else
+        {
+            cout << g.key;
+        }
+        cout << "\t" << g.count;
+        if (!query.aggregate.empty())
+        {
+            cout << "\t" << g.sum << "\t" << static_cast<double>(g.sum) / g.count << "\t" << g.min << "\t" << g.max;
+        }
+        cout << endl;
+    }
+    return 0;
+}
+
+static int runColumns(int argc, char *argv[])
+{
+    if (argc < 3)
+    {
+        throw ParseError(usage);
+    }
+
+    StatsFile file{argv[2]};
+    cout << "games (" << file.rows(StatsTable::Games) << " rows):";
+    for (const string &name : file.columnNames(StatsTable::Games))
+    {
+        cout << " " << name;
+    }
+    cout << endl;
+    cout << "events (" << file.rows(StatsTable::Events) << " rows):";
+    for (const string &name : file.columnNames(StatsTable::Events))
+    {
+        cout << " " << name;
+    }
+    cout << endl;
+    return 0;
+}
+
+// main exports replay statistics to a columnar file or runs scan/aggregate queries over one
+int main(int argc, char *argv[])
+{
+    try
+    {
+        string mode = argc > 1 ? argv[1] : "";
+        if (mode == "export")
+        {
+            return runExport(argc, argv);
+        }
+        if (mode == "query")
+        {
+            return runQuery(argc, argv);
+        }
+        if (mode == "columns")
+        {
+            return runColumns(argc, argv);
+        }
+        throw ParseError(usage);
+    }
+    catch (const ParseError &e)
+    {
+        cerr << "Command line error: " << e.message() << endl;
+        return 1;
+    }
+    catch (const RaiiError &e)
+    {
+        cerr << "gstats error: " << e.message() << endl;
+        return 1;
+    }
+    catch (const exception &e)
+    {
+        cerr << "Unexpected standard exception: " << e.what() << endl;
+        return 1;
+    }
+}
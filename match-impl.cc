@@ -0,0 +1,85 @@
+module match;
+
+import <string>;
+import types;
+import game;
+import bot;
+import replay;
+import ability;
+import errors;
+
+using namespace std;
+
+// applyBotAbility uses an ability the same way Controller::cmdAbility does
+//  * rejected abilities are ignored so a bot still gets to move this turn
+static void applyBotAbility(Game &game, const BotAbility &choice, ReplayWriter *recorder)
+{
+    PlayerId user = game.currentPlayer();
+    PlayerAbilities &pa = game.getAbilities(user);
+
+    if (choice.slot < 0 || choice.slot >= 5 || pa.isUsed(choice.slot))
+    {
+        return;
+    }
+
+    try
+    {
+        pa.abilityAt(choice.slot).use(game, user, choice.hasLabel, choice.hasPos, choice.label, choice.pos);
+        pa.markUsed(choice.slot);
+        if (recorder)
+        {
+            recorder->recordAbility(game, choice.slot, choice.hasLabel, choice.label, choice.hasPos, choice.pos);
+        }
+    }
+    catch (const AbilityError &)
+    {
+        // the ability card stays unused, matching the interactive controller
+    }
+}
+
+MatchResult playMatch(Game &game, Bot &p1, Bot &p2, int maxPlies, ReplayWriter *recorder)
+{
+    MatchResult result{PlayerId::None, 0, false};
+
+    while (!game.isOver())
+    {
+        if (result.plies >= maxPlies)
+        {
+            result.plyLimit = true;
+            break;
+        }
+
+        Bot &bot = (game.currentPlayer() == PlayerId::P1) ? p1 : p2;
+
+        BotAbility ability;
+        if (bot.chooseAbility(game, ability))
+        {
+            applyBotAbility(game, ability, recorder);
+            if (game.isOver())
+            {
+                break;
+            }
+        }
+
+        BotMove move;
+        if (!bot.chooseMove(game, move))
+        {
+            // a player with no legal move ends the game as a draw
+            break;
+        }
+
+        MoveResult res = game.moveLink(move.label, move.dir);
+        if (!res.ok)
+        {
+            throw FatalError("bot " + bot.name() + " chose an illegal move");
+        }
+        if (recorder)
+        {
+            recorder->recordMove(game, move.label, move.dir);
+        }
+        ++result.plies;
+    }
+
+    result.winner = game.winner();
+    return result;
+}
@@ -0,0 +1,21 @@
+export module match;
+
+import types;
+import game;
+import bot;
+import replay;
+
+using namespace std;
+
+// MatchResult summarizes a headless bot game
+export struct MatchResult
+{
+    PlayerId winner; // PlayerId::None for a draw
+    int plies;       // number of moves made by both players
+    bool plyLimit;   // true when the game was stopped at maxPlies
+};
+
+// playMatch drives game with p1 and p2 until someone wins, a player has no legal move,
+// or maxPlies moves have been made; the game is played from its current state
+//  * every accepted move and ability is appended to recorder when one is given
+export MatchResult playMatch(Game &game, Bot &p1, Bot &p2, int maxPlies, ReplayWriter *recorder = nullptr);
@@ -0,0 +1,568 @@
+import <iostream>;
+import <fstream>;
+import <sstream>;
+import <string>;
+import <vector>;
+import <map>;
+import <mutex>;
+import <memory>;
+import <random>;
+import <algorithm>;
+import <exception>;
+
+import types;
+import cli;
+import game;
+import bot;
+import match;
+import threadpool;
+import errors;
+
+using namespace std;
+
+// OptimizerOptions stores the search configuration parsed from argv
+struct OptimizerOptions
+{
+    string player = "greedy"; // bot that plays the candidate setups
+    vector<string> pool = {"greedy"};
+    CommandLineOptions opponent; // setup used by the bot pool
+    bool evolveAbilities = false;
+    int population = 24;
+    int generations = 30;
+    int patience = 6; // generations without improvement before stopping
+    int games = 16;   // games per genome against each bot
+    int elite = 4;
+    int maxPlies = 400;
+    unsigned threads = 0;
+    unsigned long long seed = 1;
+    string cacheFile = "optimizer.cache";
+    string bookFile = "opening.book";
+    int bookSize = 20;
+};
+
+// Genome is a candidate setup: a link order and a five card ability string
+struct Genome
+{
+    string links;
+    string abilities;
+
+    string key() const
+    {
+        return links + "/" + abilities;
+    }
+};
+
+// Fitness is the average score of a genome over its evaluation games
+struct Fitness
+{
+    double score = 0.0;
+    int games = 0;
+};
+
+static vector<string> splitList(const string &s)
+{
+    vector<string> parts;
+    string cur;
+    for (char ch : s)
+    {
+        if (ch == ',')
+        {
+            if (!cur.empty())
+            {
+                parts.push_back(cur);
+            }
+            cur.clear();
+        }
+        else
+        {
+            cur += ch;
+        }
+    }
+    if (!cur.empty())
+    {
+        parts.push_back(cur);
+    }
+    return parts;
+}
+
+static OptimizerOptions parseOptimizerOptions(int argc, char *argv[])
+{
+    OptimizerOptions opts;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "-player" && hasValue)
+        {
+            opts.player = argv[++i];
+        }
+        else if (arg == "-pool" && hasValue)
+        {
+            opts.pool = splitList(argv[++i]);
+        }
+        else if (arg == "-opponent" && hasValue)
+        {
+            opts.opponent = parseOptionString(argv[++i]);
+        }
+        else if (arg == "-abilities")
+        {
+            opts.evolveAbilities = true;
+        }
+        else if (arg == "-population" && hasValue)
+        {
+            opts.population = stoi(argv[++i]);
+        }
+        else if (arg == "-generations" && hasValue)
+        {
+            opts.generations = stoi(argv[++i]);
+        }
+        else if (arg == "-patience" && hasValue)
+        {
+            opts.patience = stoi(argv[++i]);
+        }
+        else if (arg == "-games" && hasValue)
+        {
+            opts.games = stoi(argv[++i]);
+        }
+        else if (arg == "-maxPlies" && hasValue)
+        {
+            opts.maxPlies = stoi(argv[++i]);
+        }
+        else if (arg == "-threads" && hasValue)
+        {
+            opts.threads = static_cast<unsigned>(stoi(argv[++i]));
+        }
+        else if (arg == "-seed" && hasValue)
+        {
+            opts.seed = stoull(argv[++i]);
+        }
+        else if (arg == "-cache" && hasValue)
+        {
+            opts.cacheFile = argv[++i];
+        }
+        else if (arg == "-book" && hasValue)
+        {
+            opts.bookFile = argv[++i];
+        }
+        else if (arg == "-bookSize" && hasValue)
+        {
+            opts.bookSize = stoi(argv[++i]);
+        }
+        else
+        {
+            throw ParseError("unknown or incomplete option: " + arg);
+        }
+    }
+
+    if (opts.pool.empty())
+    {
+        throw ParseError("-pool needs at least one bot");
+    }
+    makeBot(opts.player);
+    for (const string &name : opts.pool)
+    {
+        makeBot(name);
+    }
+    if (opts.population < 4 || opts.games <= 0)
+    {
+        throw ParseError("-population must be at least 4 and -games positive");
+    }
+    if (opts.elite >= opts.population)
+    {
+        opts.elite = opts.population / 2;
+    }
+    return opts;
+}
+
+// link orders are permutations of 8 two-character pieces
+static vector<string> piecesOf(const string &links)
+{
+    vector<string> pieces;
+    for (int i = 0; i < 8; ++i)
+    {
+        pieces.push_back(links.substr(2 * i, 2));
+    }
+    return pieces;
+}
+
+static string joinPieces(const vector<string> &pieces)
+{
+    string links;
+    for (const string &p : pieces)
+    {
+        links += p;
+    }
+    return links;
+}
+
+// Optimizer runs a generational genetic search with a shared fitness cache
+class Optimizer
+{
+public:
+    Optimizer(const OptimizerOptions &o) : opts{o}, pool{o.threads}, rng{o.seed}, cacheHits{0}
+    {
+        // a cache built with different evaluation settings is thrown away
+        if (loadCache())
+        {
+            cacheOut.open(opts.cacheFile, ios::app);
+        }
+        else
+        {
+            cacheOut.open(opts.cacheFile, ios::trunc);
+            cacheOut << settings() << endl;
+        }
+    }
+
+    void run()
+    {
+        vector<Genome> population;
+        population.push_back(Genome{opts.opponent.link1, opts.opponent.ability1});
+        while (static_cast<int>(population.size()) < opts.population)
+        {
+            population.push_back(randomGenome());
+        }
+
+        double bestScore = -1.0;
+        int stale = 0;
+
+        for (int gen = 0; gen < opts.generations; ++gen)
+        {
+            evaluate(population);
+
+            sort(population.begin(), population.end(), [this](const Genome &a, const Genome &b)
+                 { return cache[a.key()].score > cache[b.key()].score; });
+
+            double top = cache[population[0].key()].score;
+            cerr << "generation " << (gen + 1) << ": best " << top
+                 << " " << population[0].links << " " << population[0].abilities
+                 << " (" << cache.size() << " genomes evaluated, " << cacheHits << " cache hits)" << endl;
+
+            // early stopping once the best genome stops improving
+            if (top > bestScore + 1e-9)
+            {
+                bestScore = top;
+                stale = 0;
+            }
+            else if (++stale >= opts.patience)
+            {
+                cerr << "no improvement for " << opts.patience << " generations, stopping" << endl;
+                break;
+            }
+
+            population = nextGeneration(population);
+        }
+
+        writeBook();
+    }
+
+private:
+    const OptimizerOptions &opts;
+    WorkStealingPool pool;
+    mt19937_64 rng;
+    map<string, Fitness> cache;
+    mutex cacheLock;
+    ofstream cacheOut;
+    long long cacheHits;
+
+    // settings describes everything that affects a fitness value
+    string settings() const
+    {
+        string s = "# player " + opts.player + " pool";
+        for (const string &name : opts.pool)
+        {
+            s += " " + name;
+        }
+        s += " games " + to_string(opts.games) + " maxPlies " + to_string(opts.maxPlies) +
+             " seed " + to_string(opts.seed) + " opponent " + optionString(opts.opponent);
+        return s;
+    }
+
+    bool loadCache()
+    {
+        ifstream in{opts.cacheFile};
+        string header;
+        if (!in || !getline(in, header) || header != settings())
+        {
+            return false;
+        }
+
+        string key;
+        Fitness f;
+        while (in >> key >> f.score >> f.games)
+        {
+            cache[key] = f;
+        }
+        return true;
+    }
+
+    Genome randomGenome()
+    {
+        vector<string> pieces = piecesOf("V1V2V3V4D1D2D3D4");
+        shuffle(pieces.begin(), pieces.end(), rng);
+
+        Genome g{joinPieces(pieces), opts.opponent.ability1};
+        if (opts.evolveAbilities)
+        {
+            g.abilities = randomAbilities();
+        }
+        return g;
+    }
+
+    string randomAbilities()
+    {
+        const string codes = "LFDSPWJH";
+        uniform_int_distribution<int> pick{0, 7};
+        while (true)
+        {
+            string s(5, ' ');
+            for (char &ch : s)
+            {
+                ch = codes[pick(rng)];
+            }
+            try
+            {
+                validateAbilityString(s, "ability1");
+                return s;
+            }
+            catch (const ParseError &)
+            {
+            }
+        }
+    }
+
+    // mutate swaps two link pieces and sometimes replaces an ability card
+    Genome mutate(Genome g)
+    {
+        uniform_int_distribution<int> slot{0, 7};
+        vector<string> pieces = piecesOf(g.links);
+        swap(pieces[slot(rng)], pieces[slot(rng)]);
+        g.links = joinPieces(pieces);
+
+        if (opts.evolveAbilities && uniform_int_distribution<int>{0, 2}(rng) == 0)
+        {
+            const string codes = "LFDSPWJH";
+            for (int tries = 0; tries < 20; ++tries)
+            {
+                string s = g.abilities;
+                s[uniform_int_distribution<int>{0, 4}(rng)] = codes[slot(rng)];
+                try
+                {
+                    validateAbilityString(s, "ability1");
+                    g.abilities = s;
+                    break;
+                }
+                catch (const ParseError &)
+                {
+                }
+            }
+        }
+        return g;
+    }
+
+    // crossover keeps a run of pieces from a and fills the rest in b's order (order crossover)
+    Genome crossover(const Genome &a, const Genome &b)
+    {
+        vector<string> pa = piecesOf(a.links);
+        vector<string> pb = piecesOf(b.links);
+        int lo = uniform_int_distribution<int>{0, 7}(rng);
+        int hi = uniform_int_distribution<int>{lo, 7}(rng);
+
+        vector<string> child(8);
+        vector<bool> taken(8, false);
+        for (int i = lo; i <= hi; ++i)
+        {
+            child[i] = pa[i];
+            for (int j = 0; j < 8; ++j)
+            {
+                if (!taken[j] && pb[j] == pa[i])
+                {
+                    taken[j] = true;
+                    break;
+                }
+            }
+        }
+
+        int next = 0;
+        for (int i = 0; i < 8; ++i)
+        {
+            if (i >= lo && i <= hi)
+            {
+                continue;
+            }
+            while (taken[next])
+            {
+                ++next;
+            }
+            child[i] = pb[next];
+            taken[next] = true;
+        }
+
+        Genome g{joinPieces(child), uniform_int_distribution<int>{0, 1}(rng) ? a.abilities : b.abilities};
+        return g;
+    }
+
+    const Genome &selectParent(const vector<Genome> &ranked)
+    {
+        // tournament selection of size 3 on the ranked population
+        uniform_int_distribution<int> pick{0, static_cast<int>(ranked.size()) - 1};
+        int best = pick(rng);
+        for (int k = 0; k < 2; ++k)
+        {
+            best = min(best, pick(rng));
+        }
+        return ranked[best];
+    }
+
+    vector<Genome> nextGeneration(const vector<Genome> &ranked)
+    {
+        vector<Genome> next(ranked.begin(), ranked.begin() + opts.elite);
+        while (static_cast<int>(next.size()) < opts.population)
+        {
+            Genome child = crossover(selectParent(ranked), selectParent(ranked));
+            next.push_back(mutate(child));
+        }
+        return next;
+    }
+
+    // evaluate scores every genome not already in the cache, in parallel
+    void evaluate(const vector<Genome> &population)
+    {
+        map<string, Genome> todo;
+        {
+            lock_guard<mutex> guard{cacheLock};
+            for (const Genome &g : population)
+            {
+                if (cache.count(g.key()))
+                {
+                    ++cacheHits;
+                }
+                else
+                {
+                    todo[g.key()] = g;
+                }
+            }
+        }
+
+        for (const auto &entry : todo)
+        {
+            Genome g = entry.second;
+            pool.submit([this, g]
+                        { score(g); });
+        }
+        pool.wait();
+    }
+
+    // score plays the genome on both sides against every pool bot, reusing this worker's Game
+    void score(const Genome &g)
+    {
+        thread_local unique_ptr<Game> game;
+
+        CommandLineOptions asFirst = opts.opponent;
+        asFirst.link1 = g.links;
+        asFirst.ability1 = g.abilities;
+
+        CommandLineOptions asSecond = opts.opponent;
+        asSecond.link2 = g.links;
+        asSecond.ability2 = g.abilities;
+        asSecond.link1 = opts.opponent.link2;
+        asSecond.ability1 = opts.opponent.ability2;
+
+        double points = 0.0;
+        int played = 0;
+        unsigned long long seed = opts.seed;
+
+        for (const string &botName : opts.pool)
+        {
+            unique_ptr<Bot> us = makeBot(opts.player);
+            unique_ptr<Bot> them = makeBot(botName);
+
+            for (int i = 0; i < opts.games; ++i)
+            {
+                bool first = (i % 2 == 0);
+                const CommandLineOptions &cfg = first ? asFirst : asSecond;
+                if (!game)
+                {
+                    game = make_unique<Game>(cfg);
+                }
+                else
+                {
+                    game->reset(cfg);
+                }
+
+                // fixed seeds per game index so every genome sees the same dice
+                us->seed(seed + 2 * i);
+                them->seed(seed + 2 * i + 1);
+
+                MatchResult res = first ? playMatch(*game, *us, *them, opts.maxPlies)
+                                        : playMatch(*game, *them, *us, opts.maxPlies);
+                PlayerId mine = first ? PlayerId::P1 : PlayerId::P2;
+                points += (res.winner == mine) ? 1.0 : (res.winner == PlayerId::None) ? 0.5 : 0.0;
+                ++played;
+            }
+        }
+
+        Fitness f{points / played, played};
+
+        lock_guard<mutex> guard{cacheLock};
+        cache[g.key()] = f;
+        if (cacheOut)
+        {
+            cacheOut << g.key() << ' ' << f.score << ' ' << f.games << endl;
+        }
+    }
+
+    // writeBook ranks every evaluated genome and keeps the best as the opening book
+    void writeBook()
+    {
+        vector<pair<string, Fitness>> ranked(cache.begin(), cache.end());
+        sort(ranked.begin(), ranked.end(), [](const auto &a, const auto &b)
+             { return a.second.score > b.second.score; });
+
+        ofstream out{opts.bookFile};
+        if (!out)
+        {
+            throw ParseError("could not open book file: " + opts.bookFile);
+        }
+
+        out << "# rank score games link ability" << '\n';
+        int n = min(opts.bookSize, static_cast<int>(ranked.size()));
+        for (int i = 0; i < n; ++i)
+        {
+            const string &key = ranked[i].first;
+            size_t slash = key.find('/');
+            out << (i + 1) << ' ' << ranked[i].second.score << ' ' << ranked[i].second.games << ' '
+                << key.substr(0, slash) << ' ' << key.substr(slash + 1) << '\n';
+        }
+        cerr << "wrote " << n << " setups to " << opts.bookFile << endl;
+    }
+};
+
+// main evolves link orders (and optionally ability strings) against a bot pool
+int main(int argc, char *argv[])
+{
+    try
+    {
+        OptimizerOptions opts = parseOptimizerOptions(argc, argv);
+        Optimizer optimizer{opts};
+        optimizer.run();
+    }
+    catch (const ParseError &e)
+    {
+        cerr << "Command line error: " << e.message() << endl;
+        return 1;
+    }
+    catch (const RaiiError &e)
+    {
+        cerr << "optimizer error: " << e.message() << endl;
+        return 1;
+    }
+    catch (const exception &e)
+    {
+        cerr << "Unexpected standard exception: " << e.what() << endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -58,6 +58,16 @@ void PlayerState::incrDownloadedVirus()
     ++downloadedVirus;
 }
 
+void PlayerState::setDownloadedData(int count)
+{
+    downloadedData = count;
+}
+
+void PlayerState::setDownloadedVirus(int count)
+{
+    downloadedVirus = count;
+}
+
 int PlayerState::getLinkIndex(int slot) const
 {
     // precondition 0 <= slot < 8
@@ -19,6 +19,8 @@ public:
     int getDownloadedVirus() const;
     void incrDownloadedData();
     void incrDownloadedVirus();
+    void setDownloadedData(int count);
+    void setDownloadedVirus(int count);
 
     int getLinkIndex(int slot) const;
     void setLinkIndex(int slot, int index);
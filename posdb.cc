@@ -0,0 +1,138 @@
+import <iostream>;
+import <string>;
+import <vector>;
+import <exception>;
+import <cstdio>;
+
+import types;
+import cli;
+import game;
+import replay;
+import positiondb;
+import errors;
+
+using namespace std;
+
+static const char *usage =
+    "usage: posdb build -out <db> [-threads N] <replay files or directories...>\n"
+    "       posdb query <db> <replay> <ply>\n"
+    "       posdb query <db> -hash <hex>";
+
+static int runBuild(int argc, char *argv[])
+{
+    string out;
+    unsigned threads = 0;
+    vector<string> inputs;
+
+    for (int i = 2; i < argc; ++i)
+    {
+        string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "-out" && hasValue)
+        {
+            out = argv[++i];
+        }
+        else if (arg == "-threads" && hasValue)
+        {
+            threads = static_cast<unsigned>(stoul(argv[++i]));
+        }
+        else if (!arg.empty() && arg[0] == '-')
+        {
+            throw ParseError("unknown option " + arg);
+        }
+        else
+        {
+            inputs.push_back(arg);
+        }
+    }
+    if (out.empty() || inputs.empty())
+    {
+        throw ParseError(usage);
+    }
+
+    vector<string> files = collectReplayFiles(inputs);
+    buildPositionDb(files, out, threads);
+
+    PositionDb db{out};
+    cout << "indexed " << db.positions() << " positions from " << db.games() << " games" << endl;
+    return 0;
+}
+
+static int runQuery(int argc, char *argv[])
+{
+    if (argc < 5)
+    {
+        throw ParseError(usage);
+    }
+
+    PositionDb db{argv[2]};
+    string arg = argv[3];
+    unsigned long long hash = 0;
+
+    if (arg == "-hash")
+    {
+        hash = stoull(argv[4], nullptr, 16);
+    }
+    else
+    {
+        ReplayReader reader{arg};
+        Game game{reader.options()};
+        reader.seek(game, stoll(argv[4]));
+        hash = game.hash();
+    }
+
+    char hex[17];
+    snprintf(hex, sizeof(hex), "%016llx", hash);
+
+    PositionStats stats;
+    if (!db.lookup(hash, stats))
+    {
+        cout << "position " << hex << " not found" << endl;
+        return 1;
+    }
+
+    unsigned total = stats.p1Wins + stats.draws + stats.p2Wins;
+    cout << "position " << hex << ": seen " << total << " times" << endl;
+    cout << "P1 wins " << stats.p1Wins << ", draws " << stats.draws << ", P2 wins " << stats.p2Wins << endl;
+    cout << "average plies remaining " << stats.averageRemaining << endl;
+    for (const PositionMove &m : stats.moves)
+    {
+        ReplayRecord rec{static_cast<unsigned char>(m.record), static_cast<unsigned char>(m.record >> 8),
+                         static_cast<unsigned char>(m.record >> 16), static_cast<unsigned char>(m.record >> 24)};
+        cout << "  " << m.count << "  " << describeRecord(rec) << endl;
+    }
+    return 0;
+}
+
+// main builds a position database from replays or queries one
+int main(int argc, char *argv[])
+{
+    try
+    {
+        string mode = argc > 1 ? argv[1] : "";
+        if (mode == "build")
+        {
+            return runBuild(argc, argv);
+        }
+        if (mode == "query")
+        {
+            return runQuery(argc, argv);
+        }
+        throw ParseError(usage);
+    }
+    catch (const ParseError &e)
+    {
+        cerr << "Command line error: " << e.message() << endl;
+        return 1;
+    }
+    catch (const RaiiError &e)
+    {
+        cerr << "posdb error: " << e.message() << endl;
+        return 1;
+    }
+    catch (const exception &e)
+    {
+        cerr << "Unexpected standard exception: " << e.what() << endl;
+        return 1;
+    }
+}
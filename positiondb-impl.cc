@@ -0,0 +1,477 @@
+module;
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+module positiondb;
+
+import <string>;
+import <vector>;
+import <fstream>;
+import <algorithm>;
+import <memory>;
+import <mutex>;
+import <atomic>;
+import <cstring>;
+import <cstdio>;
+import <queue>;
+import types;
+import game;
+import replay;
+import threadpool;
+import errors;
+
+using namespace std;
+
+// file layout: 64 byte header, entries sorted by hash, then the move table
+static const char dbMagic[8] = {'R', 'A', 'I', 'I', 'P', 'D', 'B', '1'};
+static const size_t dbHeaderSize = 64;
+static const size_t entrySize = 40;
+static const size_t moveSize = 8;
+
+// a raw observation: position hash, the record played from it, the result and remaining plies
+struct Observation
+{
+    unsigned long long hash;
+    unsigned record;    // 0 at the final position
+    unsigned remaining;
+    unsigned char result; // 0 P1 win, 1 draw, 2 P2 win
+};
+
+static bool observationLess(const Observation &a, const Observation &b)
+{
+    if (a.hash != b.hash)
+    {
+        return a.hash < b.hash;
+    }
+    return a.record < b.record;
+}
+
+static unsigned packRecord(const ReplayRecord &r)
+{
+    return static_cast<unsigned>(r.kind) | (static_cast<unsigned>(r.a) << 8) |
+           (static_cast<unsigned>(r.b) << 16) | (static_cast<unsigned>(r.c) << 24);
+}
+
+// ingestReplay replays one file and appends an observation for every position in it
+static void ingestReplay(const string &path, vector<Observation> &out)
+{
+    ReplayReader reader{path};
+    Game game{reader.options()};
+
+    long long n = reader.size();
+    size_t first = out.size();
+
+    for (long long i = 0; i < n; ++i)
+    {
+        ReplayRecord rec = reader.record(i);
+        out.push_back(Observation{game.hash(), packRecord(rec), static_cast<unsigned>(n - i), 0});
+        applyRecord(game, rec);
+    }
+    out.push_back(Observation{game.hash(), 0, 0, 0});
+
+    PlayerId w = game.winner();
+    unsigned char result = (w == PlayerId::P1) ? 0 : (w == PlayerId::P2) ? 2 : 1;
+    for (size_t i = first; i < out.size(); ++i)
+    {
+        out[i].result = result;
+    }
+}
+
+// RunReader streams one sorted run file during the merge
+struct RunReader
+{
+    ifstream in;
+    Observation current;
+    bool valid;
+
+    explicit RunReader(const string &path) : in{path, ios::binary}, current{}, valid{false}
+    {
+        if (!in)
+        {
+            throw FatalError("could not open run file " + path);
+        }
+        advance();
+    }
+
+    void advance()
+    {
+        valid = static_cast<bool>(in.read(reinterpret_cast<char *>(&current), sizeof(Observation)));
+    }
+};
+
+// RunMerger yields the observations of up to mergeFanIn sorted runs in order
+//  * a min-heap holds one head per run, so each observation costs O(log k) and only k files are open
+class RunMerger
+{
+public:
+    explicit RunMerger(const vector<string> &paths)
+    {
+        for (const string &path : paths)
+        {
+            readers.push_back(make_unique<RunReader>(path));
+            if (readers.back()->valid)
+            {
+                heads.push(readers.size() - 1);
+            }
+        }
+    }
+
+    // next takes the smallest observation left, false once every run is exhausted
+    bool next(Observation &out)
+    {
+        if (heads.empty())
+        {
+            return false;
+        }
+        size_t i = heads.top();
+        heads.pop();
+        out = readers[i]->current;
+        readers[i]->advance();
+        if (readers[i]->valid)
+        {
+            heads.push(i);
+        }
+        return true;
+    }
+
+private:
+    // HeadGreater orders reader indexes so the heap's top is the reader with the smallest observation
+    struct HeadGreater
+    {
+        const vector<unique_ptr<RunReader>> *readers;
+
+        bool operator()(size_t a, size_t b) const
+        {
+            return observationLess((*readers)[b]->current, (*readers)[a]->current);
+        }
+    };
+
+    vector<unique_ptr<RunReader>> readers;
+    priority_queue<size_t, vector<size_t>, HeadGreater> heads{HeadGreater{&readers}};
+};
+
+// runs merged at once, which is also the most run files open in any merge
+static const size_t mergeFanIn = 64;
+
+void buildPositionDb(const vector<string> &replayFiles, const string &outPath, unsigned threads)
+{
+    const size_t runLimit = 1 << 20; // observations per spilled run
+
+    WorkStealingPool pool{threads};
+    mutex runLock;
+    vector<string> runs;
+    size_t runNumber = 0;
+    atomic<unsigned long long> games{0};
+    atomic<size_t> nextFile{0};
+
+    auto newRun = [&]()
+    {
+        lock_guard<mutex> guard{runLock};
+        return outPath + ".run" + to_string(runNumber++);
+    };
+
+    auto spill = [&](vector<Observation> &buf)
+    {
+        if (buf.empty())
+        {
+            return;
+        }
+        sort(buf.begin(), buf.end(), observationLess);
+
+        string path = newRun();
+        {
+            lock_guard<mutex> guard{runLock};
+            runs.push_back(path);
+        }
+
+        ofstream out{path, ios::binary | ios::trunc};
+        out.write(reinterpret_cast<const char *>(buf.data()), static_cast<streamsize>(buf.size() * sizeof(Observation)));
+        if (!out)
+        {
+            throw FatalError("failed to write run file " + path);
+        }
+        buf.clear();
+    };
+
+    // each worker pulls files until none are left and spills sorted runs as it goes
+    for (unsigned w = 0; w < pool.size(); ++w)
+    {
+        pool.submit([&]
+                    {
+            vector<Observation> buf;
+            buf.reserve(runLimit + 4096);
+            while (true)
+            {
+                size_t i = nextFile.fetch_add(1);
+                if (i >= replayFiles.size())
+                {
+                    break;
+                }
+                ingestReplay(replayFiles[i], buf);
+                games.fetch_add(1);
+                if (buf.size() >= runLimit)
+                {
+                    spill(buf);
+                }
+            }
+            spill(buf); });
+    }
+    pool.wait();
+
+    // merge passes cut the runs down to mergeFanIn, merging groups of them into longer runs on the pool
+    while (runs.size() > mergeFanIn)
+    {
+        vector<string> merged((runs.size() + mergeFanIn - 1) / mergeFanIn);
+        for (size_t g = 0; g < merged.size(); ++g)
+        {
+            merged[g] = newRun();
+            pool.submit([&, g]
+                        {
+                vector<string> group(runs.begin() + static_cast<ptrdiff_t>(g * mergeFanIn),
+                                     runs.begin() + static_cast<ptrdiff_t>(min(runs.size(), (g + 1) * mergeFanIn)));
+                ofstream out{merged[g], ios::binary | ios::trunc};
+                {
+                    RunMerger merger{group};
+                    Observation o;
+                    while (merger.next(o))
+                    {
+                        out.write(reinterpret_cast<const char *>(&o), sizeof(Observation));
+                    }
+                }
+                if (!out)
+                {
+                    throw FatalError("failed to write run file " + merged[g]);
+                }
+                for (const string &path : group)
+                {
+                    remove(path.c_str());
+                }});
+        }
+        pool.wait();
+        runs.swap(merged);
+    }
+
+    // final merge of the runs, aggregating equal hashes into entries and moves
+    unique_ptr<RunMerger> merger = make_unique<RunMerger>(runs);
+
+    string entriesPath = outPath + ".entries";
+    string movesPath = outPath + ".moves";
+    ofstream entriesOut{entriesPath, ios::binary | ios::trunc};
+    ofstream movesOut{movesPath, ios::binary | ios::trunc};
+
+    unsigned long long entryCount = 0;
+    unsigned long long moveCount = 0;
+
+    Observation o;
+    bool more = merger->next(o);
+    while (more)
+    {
+        unsigned long long hash = o.hash;
+        unsigned counts[3] = {0, 0, 0};
+        unsigned long long remainingSum = 0;
+        unsigned long long firstMove = moveCount;
+        vector<PositionMove> moves;
+
+        while (more && o.hash == hash)
+        {
+            ++counts[o.result];
+            remainingSum += o.remaining;
+            if (o.remaining > 0)
+            {
+                if (!moves.empty() && moves.back().record == o.record)
+                {
+                    ++moves.back().count;
+                }
+                else
+                {
+                    moves.push_back(PositionMove{o.record, 1});
+                }
+            }
+            more = merger->next(o);
+        }
+
+        sort(moves.begin(), moves.end(), [](const PositionMove &a, const PositionMove &b)
+             { return a.count > b.count; });
+        for (const PositionMove &m : moves)
+        {
+            unsigned char bytes[moveSize];
+            putU32(bytes, m.record);
+            putU32(bytes + 4, m.count);
+            movesOut.write(reinterpret_cast<const char *>(bytes), moveSize);
+        }
+        moveCount += moves.size();
+
+        // hash, remaining sum, first move, then four counters
+        unsigned char entry[entrySize];
+        putU64(entry, hash);
+        putU64(entry + 8, remainingSum);
+        putU64(entry + 16, firstMove);
+        putU32(entry + 24, counts[0]);
+        putU32(entry + 28, counts[1]);
+        putU32(entry + 32, counts[2]);
+        putU32(entry + 36, static_cast<unsigned>(moves.size()));
+        entriesOut.write(reinterpret_cast<const char *>(entry), entrySize);
+        ++entryCount;
+    }
+
+    merger.reset();
+    for (const string &path : runs)
+    {
+        remove(path.c_str());
+    }
+    entriesOut.close();
+    movesOut.close();
+
+    // stitch header, entries and moves into the final file
+    ofstream out{outPath, ios::binary | ios::trunc};
+    if (!out)
+    {
+        throw FatalError("could not open position database for writing: " + outPath);
+    }
+
+    unsigned char header[dbHeaderSize] = {};
+    memcpy(header, dbMagic, sizeof(dbMagic));
+    putU64(header + 8, entryCount);
+    putU64(header + 16, moveCount);
+    putU64(header + 24, games.load());
+    out.write(reinterpret_cast<const char *>(header), dbHeaderSize);
+
+    for (const string &part : {entriesPath, movesPath})
+    {
+        ifstream in{part, ios::binary};
+        out << in.rdbuf();
+        in.close();
+        remove(part.c_str());
+    }
+    if (!out)
+    {
+        throw FatalError("failed to write position database: " + outPath);
+    }
+}
+
+// ==================== PositionDb ====================
+
+PositionDb::PositionDb(const string &path) : data{nullptr},
+                                             length{0},
+                                             entryCount{0},
+                                             moveCount{0},
+                                             gameCount{0},
+                                             entries{nullptr},
+                                             movesBase{nullptr}
+{
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        throw ParseError("could not open position database: " + path);
+    }
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < dbHeaderSize)
+    {
+        ::close(fd);
+        throw ParseError("not a position database: " + path);
+    }
+    length = static_cast<size_t>(st.st_size);
+
+    void *map = ::mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED)
+    {
+        throw ParseError("could not map position database: " + path);
+    }
+    data = static_cast<const unsigned char *>(map);
+
+    entryCount = getU64(data + 8);
+    moveCount = getU64(data + 16);
+    gameCount = getU64(data + 24);
+    if (memcmp(data, dbMagic, sizeof(dbMagic)) != 0 ||
+        dbHeaderSize + entryCount * entrySize + moveCount * moveSize != length)
+    {
+        ::munmap(const_cast<unsigned char *>(data), length);
+        throw ParseError("corrupt position database: " + path);
+    }
+
+    entries = data + dbHeaderSize;
+    movesBase = entries + entryCount * entrySize;
+}
+
+PositionDb::~PositionDb()
+{
+    ::munmap(const_cast<unsigned char *>(data), length);
+}
+
+unsigned long long PositionDb::positions() const
+{
+    return entryCount;
+}
+
+unsigned long long PositionDb::games() const
+{
+    return gameCount;
+}
+
+bool PositionDb::lookup(unsigned long long hash, PositionStats &stats) const
+{
+    if (entryCount == 0)
+    {
+        return false;
+    }
+
+    // Zobrist hashes are uniform, so interpolation search needs O(log log n) probes
+    unsigned long long lo = 0;
+    unsigned long long hi = entryCount - 1;
+    while (lo <= hi)
+    {
+        unsigned long long loHash = getU64(entries + lo * entrySize);
+        unsigned long long hiHash = getU64(entries + hi * entrySize);
+        if (hash < loHash || hash > hiHash)
+        {
+            return false;
+        }
+
+        unsigned long long mid = lo;
+        if (hiHash != loHash)
+        {
+            long double frac = static_cast<long double>(hash - loHash) / static_cast<long double>(hiHash - loHash);
+            mid = lo + static_cast<unsigned long long>(frac * (hi - lo));
+        }
+
+        const unsigned char *e = entries + mid * entrySize;
+        unsigned long long h = getU64(e);
+        if (h == hash)
+        {
+            unsigned long long visits = static_cast<unsigned long long>(getU32(e + 24)) + getU32(e + 28) + getU32(e + 32);
+            stats.hash = hash;
+            stats.p1Wins = getU32(e + 24);
+            stats.draws = getU32(e + 28);
+            stats.p2Wins = getU32(e + 32);
+            stats.averageRemaining = visits ? static_cast<double>(getU64(e + 8)) / visits : 0.0;
+            stats.moves.clear();
+
+            unsigned long long first = getU64(e + 16);
+            unsigned count = getU32(e + 36);
+            for (unsigned i = 0; i < count; ++i)
+            {
+                const unsigned char *m = movesBase + (first + i) * moveSize;
+                stats.moves.push_back(PositionMove{getU32(m), getU32(m + 4)});
+            }
+            return true;
+        }
+        if (h < hash)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            if (mid == 0)
+            {
+                return false;
+            }
+            hi = mid - 1;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,55 @@
+export module positiondb;
+
+import <string>;
+import <vector>;
+
+using namespace std;
+
+// PositionMove is how often one replay record was played from a position
+export struct PositionMove
+{
+    unsigned record; // ReplayRecord bytes packed little-endian
+    unsigned count;
+};
+
+// PositionStats is everything the database knows about one position
+export struct PositionStats
+{
+    unsigned long long hash;
+    unsigned p1Wins;
+    unsigned draws;
+    unsigned p2Wins;
+    double averageRemaining; // plies left until the game ended
+    vector<PositionMove> moves; // most played first
+};
+
+// buildPositionDb replays every replay file on a work-stealing pool and writes a sorted position database
+//  * workers spill sorted runs to disk next to outPath which are then merged, so memory use stays bounded
+export void buildPositionDb(const vector<string> &replayFiles, const string &outPath, unsigned threads);
+
+// PositionDb memory-maps a database built by buildPositionDb
+//  * entries are sorted by hash and looked up with interpolation search
+export class PositionDb
+{
+public:
+    explicit PositionDb(const string &path);
+    ~PositionDb();
+
+    PositionDb(const PositionDb &) = delete;
+    PositionDb &operator=(const PositionDb &) = delete;
+
+    // lookup fills stats for hash, returns false if the position was never seen
+    bool lookup(unsigned long long hash, PositionStats &stats) const;
+
+    unsigned long long positions() const;
+    unsigned long long games() const;
+
+private:
+    const unsigned char *data;
+    size_t length;
+    unsigned long long entryCount;
+    unsigned long long moveCount;
+    unsigned long long gameCount;
+    const unsigned char *entries;
+    const unsigned char *movesBase;
+};
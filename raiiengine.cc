@@ -0,0 +1,232 @@
+import <iostream>;
+import <string>;
+import <string_view>;
+import <memory>;
+import <thread>;
+import <chrono>;
+import <algorithm>;
+import <exception>;
+
+import cli;
+import game;
+import bot;
+import engine;
+import errors;
+
+using namespace std;
+
+// EngineOptions holds the command line settings for the reference engine
+struct EngineOptions
+{
+    string bot;
+    unsigned long long seed;
+    int think;   // milliseconds to wait before every answer, to exercise an arbiter's clock
+    bool ponder; // search on during the opponent's turn, search bot only
+};
+
+static EngineOptions parseEngineOptions(int argc, char *argv[])
+{
+    EngineOptions opts{"greedy", 1, 0, false};
+
+    for (int i = 1; i < argc; ++i)
+    {
+        string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "-bot" && hasValue)
+        {
+            opts.bot = argv[++i];
+        }
+        else if (arg == "-seed" && hasValue)
+        {
+            opts.seed = stoull(argv[++i]);
+        }
+        else if (arg == "-think" && hasValue)
+        {
+            opts.think = stoi(argv[++i]);
+        }
+        else if (arg == "-ponder")
+        {
+            opts.ponder = true;
+        }
+        else
+        {
+            throw ParseError("usage: raiiengine [-bot random|greedy|search] [-seed S] [-think MS] [-ponder]");
+        }
+    }
+    if (opts.ponder && opts.bot != "search")
+    {
+        throw ParseError("only the search bot can ponder");
+    }
+    return opts;
+}
+
+// bestMove asks the bot for this turn and writes it as a command list
+//  * an ability is tried on the game so the move is chosen after it, then the position is put back;
+//    the arbiter's next moves line plays both for real
+//  * after is set to the position the answer leads to, the one to ponder on, unless the game ends
+static string bestMove(Game &game, Bot &bot, GameState &after, bool &hasAfter)
+{
+    hasAfter = false;
+    GameState before = game.snapshot();
+    string list;
+
+    BotAbility ability;
+    if (bot.chooseAbility(game, ability))
+    {
+        PlayerId user = game.currentPlayer();
+        PlayerAbilities &pa = game.getAbilities(user);
+        if (ability.slot >= 0 && ability.slot < 5 && !pa.isUsed(ability.slot))
+        {
+            try
+            {
+                pa.abilityAt(ability.slot).use(game, user, ability.hasLabel, ability.hasPos, ability.label,
+                                               ability.pos);
+                pa.markUsed(ability.slot);
+                list = abilityCommand(ability);
+            }
+            catch (const AbilityError &)
+            {
+                // rejected, move without it
+            }
+        }
+    }
+
+    BotMove move;
+    if (!game.isOver())
+    {
+        if (bot.chooseMove(game, move))
+        {
+            list += (list.empty() ? "" : "; ") + moveCommand(move);
+            game.moveLink(move.label, move.dir);
+            if (!game.isOver())
+            {
+                after = game.snapshot();
+                hasAfter = true;
+            }
+        }
+        else
+        {
+            list.clear();
+        }
+    }
+
+    game.restore(before);
+    return list.empty() ? "none" : list;
+}
+
+// main speaks the engine protocol on stdin and stdout, playing with one of the built-in bots
+int main(int argc, char *argv[])
+{
+    try
+    {
+        EngineOptions opts = parseEngineOptions(argc, argv);
+        unique_ptr<Bot> bot = makeBot(opts.bot);
+        bot->seed(opts.seed);
+        SearchBot *search = dynamic_cast<SearchBot *>(bot.get());
+        unique_ptr<Ponderer> ponderer = opts.ponder ? make_unique<Ponderer>(*search) : nullptr;
+
+        CommandLineOptions setup;
+        EngineGame game{setup};
+
+        string line;
+        while (getline(cin, line))
+        {
+            size_t space = line.find(' ');
+            string word = line.substr(0, space);
+            string rest = (space == string::npos) ? "" : line.substr(space + 1);
+
+            // any input ends the ponder, the bot is needed again
+            if (ponderer)
+            {
+                ponderer->stop();
+            }
+
+            try
+            {
+                if (word == "raiinet")
+                {
+                    cout << "id name " << bot->name() << "\nraiinetok" << endl;
+                }
+                else if (word == "isready")
+                {
+                    cout << "readyok" << endl;
+                }
+                else if (word == "newgame")
+                {
+                    setup = parseOptionString(rest);
+                    game.reset(setup);
+                }
+                else if (word == "position")
+                {
+                    game.reset(setup);
+                    size_t moves = rest.find("moves ");
+                    if (moves != string::npos)
+                    {
+                        game.playList(string_view{rest}.substr(moves + 6));
+                    }
+                }
+                else if (word == "moves")
+                {
+                    game.playList(rest);
+                }
+                else if (word == "go")
+                {
+                    if (opts.think > 0)
+                    {
+                        this_thread::sleep_for(chrono::milliseconds{opts.think});
+                    }
+                    size_t movetime = rest.find("movetime ");
+                    if (search && movetime != string::npos)
+                    {
+                        // leave a tenth of the time for the pipes
+                        long long ms = stoll(rest.substr(movetime + 9));
+                        search->setBudget(0, chrono::microseconds{max(1LL, ms * 900)});
+                    }
+
+                    GameState after;
+                    bool hasAfter = false;
+                    string answer = bestMove(game.game(), *bot, after, hasAfter);
+                    if (search)
+                    {
+                        cout << "info playouts " << search->lastPlayouts() << " reused " << search->lastReused() << '\n';
+                    }
+                    cout << "bestmove " << answer << endl;
+                    if (ponderer && hasAfter)
+                    {
+                        ponderer->start(after);
+                    }
+                }
+                else if (word == "quit")
+                {
+                    break;
+                }
+                else if (!word.empty())
+                {
+                    cout << "info unknown command " << word << endl;
+                }
+            }
+            catch (const RaiiError &e)
+            {
+                // the position may now be off, but the arbiter will notice from the answers
+                cout << "info error " << e.message() << endl;
+            }
+        }
+    }
+    catch (const ParseError &e)
+    {
+        cerr << "Command line error: " << e.message() << endl;
+        return 1;
+    }
+    catch (const RaiiError &e)
+    {
+        cerr << "raiiengine error: " << e.message() << endl;
+        return 1;
+    }
+    catch (const exception &e)
+    {
+        cerr << "Unexpected standard exception: " << e.what() << endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -1,10 +1,13 @@
 import <iostream>;
 import <exception>;
+import <memory>;
 
 import cli;
 import game;
 import view;
 import controller;
+import chessclock;
+import replay;
 import errors;
 
 using namespace std;
@@ -14,17 +17,26 @@ int main(int argc, char *argv[])
 {
     try
     {
-        // parseOptions reads -ability1/-ability2/-link1/-link2 and view flags
+        // parseOptions reads -ability1/-ability2/-link1/-link2, -time/-increment and view flags
         CommandLineOptions options = parseOptions(argc, argv);
 
         // Game holds all model state for a single match
         Game game{options};
 
+        // optional binary replay of every accepted command
+        unique_ptr<ReplayWriter> recorder;
+        if (!options.recordFile.empty())
+        {
+            recorder = make_unique<ReplayWriter>(options.recordFile, options, 0, game);
+        }
+
         if (options.enableGraphics)
         {
             // use X11 view
             XView xView;
             Controller controller{game, xView};
+            controller.setRecorder(recorder.get());
+            controller.setTimeControl(timeControl(options));
             controller.run();
         }
         else if (options.enableBonus)
@@ -32,13 +44,17 @@ int main(int argc, char *argv[])
             // use ncurses view
             CursesView cursesView;
             Controller controller{game, cursesView};
+            controller.setRecorder(recorder.get());
+            controller.setTimeControl(timeControl(options));
             controller.run();
         }
         else
         {
             // plain text view
-            TextView textView;
+            TextView textView{options.skipUnchanged};
             Controller controller{game, textView};
+            controller.setRecorder(recorder.get());
+            controller.setTimeControl(timeControl(options));
             controller.run();
         }
     }
@@ -0,0 +1,95 @@
+import <iostream>;
+import <string>;
+import <exception>;
+
+import cli;
+import gameserver;
+import errors;
+
+using namespace std;
+
+// parseServerOptions reads the socket flags, everything else is game setup as RAIInet takes it
+static ServerOptions parseServerOptions(int argc, char *argv[])
+{
+    ServerOptions opts{"", 0, "", 0, 10000, 0, {}};
+    string setup;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "-unix" && hasValue)
+        {
+            opts.unixPath = argv[++i];
+        }
+        else if (arg == "-port" && hasValue)
+        {
+            opts.tcpPort = stoi(argv[++i]);
+            if (opts.tcpPort <= 0 || opts.tcpPort > 65535)
+            {
+                throw ParseError("port must be between 1 and 65535");
+            }
+        }
+        else if (arg == "-wireUnix" && hasValue)
+        {
+            opts.wireUnixPath = argv[++i];
+        }
+        else if (arg == "-wirePort" && hasValue)
+        {
+            opts.wireTcpPort = stoi(argv[++i]);
+            if (opts.wireTcpPort <= 0 || opts.wireTcpPort > 65535)
+            {
+                throw ParseError("port must be between 1 and 65535");
+            }
+        }
+        else if (arg == "-maxGames" && hasValue)
+        {
+            opts.maxGames = stoul(argv[++i]);
+        }
+        else if (arg == "-shards" && hasValue)
+        {
+            opts.shards = static_cast<unsigned>(stoul(argv[++i]));
+        }
+        else
+        {
+            setup += arg + ' ';
+        }
+    }
+
+    if (opts.unixPath.empty() && opts.tcpPort == 0 && opts.wireUnixPath.empty() && opts.wireTcpPort == 0)
+    {
+        throw ParseError("usage: raiiserver [-unix <path>] [-port <n>] [-wireUnix <path>] [-wirePort <n>] "
+                         "[-maxGames N] [-shards N] [game options...]");
+    }
+    opts.setup = parseOptionString(setup);
+    return opts;
+}
+
+// main serves one independent game per connection until interrupted, then prints its statistics
+int main(int argc, char *argv[])
+{
+    try
+    {
+        ServerOptions opts = parseServerOptions(argc, argv);
+        GameServer server{opts};
+        server.run();
+        server.report(cout);
+    }
+    catch (const ParseError &e)
+    {
+        cerr << "Command line error: " << e.message() << endl;
+        return 1;
+    }
+    catch (const RaiiError &e)
+    {
+        cerr << "raiiserver error: " << e.message() << endl;
+        return 1;
+    }
+    catch (const exception &e)
+    {
+        cerr << "Unexpected standard exception: " << e.what() << endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,394 @@
+module raster;
+
+import <string>;
+import <vector>;
+import <fstream>;
+import <algorithm>;
+import xwindow;
+import errors;
+
+using namespace std;
+
+// palette in Surface colour order, matching the X colour names Xwindow allocates
+static const unsigned char palette[10][3] = {
+    {255, 255, 255}, // white
+    {0, 0, 0},       // black
+    {255, 0, 0},     // red
+    {0, 255, 0},     // green
+    {0, 0, 255},     // blue
+    {0, 255, 255},   // cyan
+    {255, 255, 0},   // yellow
+    {255, 0, 255},   // magenta
+    {255, 165, 0},   // orange
+    {165, 42, 42}    // brown
+};
+
+// font5x7 holds printable ASCII from ' ' to '~', five columns per glyph, bit 0 is the top row
+static const unsigned char font5x7[95][5] = {
+    {0x00, 0x00, 0x00, 0x00, 0x00}, {0x00, 0x00, 0x5F, 0x00, 0x00}, {0x00, 0x07, 0x00, 0x07, 0x00},
+    {0x14, 0x7F, 0x14, 0x7F, 0x14}, {0x24, 0x2A, 0x7F, 0x2A, 0x12}, {0x23, 0x13, 0x08, 0x64, 0x62},
+    {0x36, 0x49, 0x55, 0x22, 0x50}, {0x00, 0x05, 0x03, 0x00, 0x00}, {0x00, 0x1C, 0x22, 0x41, 0x00},
+    {0x00, 0x41, 0x22, 0x1C, 0x00}, {0x08, 0x2A, 0x1C, 0x2A, 0x08}, {0x08, 0x08, 0x3E, 0x08, 0x08},
+    {0x00, 0x50, 0x30, 0x00, 0x00}, {0x08, 0x08, 0x08, 0x08, 0x08}, {0x00, 0x60, 0x60, 0x00, 0x00},
+    {0x20, 0x10, 0x08, 0x04, 0x02}, {0x3E, 0x51, 0x49, 0x45, 0x3E}, {0x00, 0x42, 0x7F, 0x40, 0x00},
+    {0x42, 0x61, 0x51, 0x49, 0x46}, {0x21, 0x41, 0x45, 0x4B, 0x31}, {0x18, 0x14, 0x12, 0x7F, 0x10},
+    {0x27, 0x45, 0x45, 0x45, 0x39}, {0x3C, 0x4A, 0x49, 0x49, 0x30}, {0x01, 0x71, 0x09, 0x05, 0x03},
+    {0x36, 0x49, 0x49, 0x49, 0x36}, {0x06, 0x49, 0x49, 0x29, 0x1E}, {0x00, 0x36, 0x36, 0x00, 0x00},
+    {0x00, 0x56, 0x36, 0x00, 0x00}, {0x08, 0x14, 0x22, 0x41, 0x00}, {0x14, 0x14, 0x14, 0x14, 0x14},
+    {0x00, 0x41, 0x22, 0x14, 0x08}, {0x02, 0x01, 0x51, 0x09, 0x06}, {0x32, 0x49, 0x79, 0x41, 0x3E},
+    {0x7E, 0x11, 0x11, 0x11, 0x7E}, {0x7F, 0x49, 0x49, 0x49, 0x36}, {0x3E, 0x41, 0x41, 0x41, 0x22},
+    {0x7F, 0x41, 0x41, 0x22, 0x1C}, {0x7F, 0x49, 0x49, 0x49, 0x41}, {0x7F, 0x09, 0x09, 0x01, 0x01},
+    {0x3E, 0x41, 0x41, 0x51, 0x32}, {0x7F, 0x08, 0x08, 0x08, 0x7F}, {0x00, 0x41, 0x7F, 0x41, 0x00},
+    {0x20, 0x40, 0x41, 0x3F, 0x01}, {0x7F, 0x08, 0x14, 0x22, 0x41}, {0x7F, 0x40, 0x40, 0x40, 0x40},
+    {0x7F, 0x02, 0x04, 0x02, 0x7F}, {0x7F, 0x04, 0x08, 0x10, 0x7F}, {0x3E, 0x41, 0x41, 0x41, 0x3E},
+    {0x7F, 0x09, 0x09, 0x09, 0x06}, {0x3E, 0x41, 0x51, 0x21, 0x5E}, {0x7F, 0x09, 0x19, 0x29, 0x46},
+    {0x46, 0x49, 0x49, 0x49, 0x31}, {0x01, 0x01, 0x7F, 0x01, 0x01}, {0x3F, 0x40, 0x40, 0x40, 0x3F},
+    {0x1F, 0x20, 0x40, 0x20, 0x1F}, {0x7F, 0x20, 0x18, 0x20, 0x7F}, {0x63, 0x14, 0x08, 0x14, 0x63},
+    {0x03, 0x04, 0x78, 0x04, 0x03}, {0x61, 0x51, 0x49, 0x45, 0x43}, {0x00, 0x7F, 0x41, 0x41, 0x00},
+    {0x02, 0x04, 0x08, 0x10, 0x20}, {0x00, 0x41, 0x41, 0x7F, 0x00}, {0x04, 0x02, 0x01, 0x02, 0x04},
+    {0x40, 0x40, 0x40, 0x40, 0x40}, {0x00, 0x01, 0x02, 0x04, 0x00}, {0x20, 0x54, 0x54, 0x54, 0x78},
+    {0x7F, 0x48, 0x44, 0x44, 0x38}, {0x38, 0x44, 0x44, 0x44, 0x20}, {0x38, 0x44, 0x44, 0x48, 0x7F},
+    {0x38, 0x54, 0x54, 0x54, 0x18}, {0x08, 0x7E, 0x09, 0x01, 0x02}, {0x0C, 0x52, 0x52, 0x52, 0x3E},
+    {0x7F, 0x08, 0x04, 0x04, 0x78}, {0x00, 0x44, 0x7D, 0x40, 0x00}, {0x20, 0x40, 0x44, 0x3D, 0x00},
+    {0x7F, 0x10, 0x28, 0x44, 0x00}, {0x00, 0x41, 0x7F, 0x40, 0x00}, {0x7C, 0x04, 0x18, 0x04, 0x78},
+    {0x7C, 0x08, 0x04, 0x04, 0x78}, {0x38, 0x44, 0x44, 0x44, 0x38}, {0x7C, 0x14, 0x14, 0x14, 0x08},
+    {0x08, 0x14, 0x14, 0x18, 0x7C}, {0x7C, 0x08, 0x04, 0x04, 0x08}, {0x48, 0x54, 0x54, 0x54, 0x20},
+    {0x04, 0x3F, 0x44, 0x40, 0x20}, {0x3C, 0x40, 0x40, 0x20, 0x7C}, {0x1C, 0x20, 0x40, 0x20, 0x1C},
+    {0x3C, 0x40, 0x30, 0x40, 0x3C}, {0x44, 0x28, 0x10, 0x28, 0x44}, {0x0C, 0x50, 0x50, 0x50, 0x3C},
+    {0x44, 0x64, 0x54, 0x4C, 0x44}, {0x00, 0x08, 0x36, 0x41, 0x00}, {0x00, 0x00, 0x7F, 0x00, 0x00},
+    {0x00, 0x41, 0x36, 0x08, 0x00}, {0x08, 0x04, 0x08, 0x10, 0x08}};
+
+RasterSurface::RasterSurface(int width, int height) : w{width},
+                                                      h{height},
+                                                      rgb(static_cast<size_t>(width) * height * 3, 255)
+{
+}
+
+void RasterSurface::setPixel(int x, int y, int colour)
+{
+    unsigned char *p = &rgb[(static_cast<size_t>(y) * w + x) * 3];
+    p[0] = palette[colour][0];
+    p[1] = palette[colour][1];
+    p[2] = palette[colour][2];
+}
+
+void RasterSurface::fillRectangle(int x, int y, int width, int height, int colour)
+{
+    // clip to the image like the X server does
+    int x1 = max(x, 0);
+    int y1 = max(y, 0);
+    int x2 = min(x + width, w);
+    int y2 = min(y + height, h);
+    if (x2 <= x1 || y2 <= y1 || colour < 0 || colour > Brown)
+    {
+        return;
+    }
+
+    // fill the first row, then copy it down
+    unsigned char *first = &rgb[(static_cast<size_t>(y1) * w + x1) * 3];
+    for (int px = x1; px < x2; ++px)
+    {
+        setPixel(px, y1, colour);
+    }
+    size_t rowBytes = static_cast<size_t>(x2 - x1) * 3;
+    for (int py = y1 + 1; py < y2; ++py)
+    {
+        copy(first, first + rowBytes, &rgb[(static_cast<size_t>(py) * w + x1) * 3]);
+    }
+}
+
+void RasterSurface::drawString(int x, int y, const string &msg)
+{
+    // glyph rows sit on the baseline, the lowest row is for descenders
+    int top = y - 7;
+    for (char ch : msg)
+    {
+        unsigned char code = static_cast<unsigned char>(ch);
+        if (code >= ' ' && code <= '~')
+        {
+            const unsigned char *glyph = font5x7[code - ' '];
+            for (int col = 0; col < 5; ++col)
+            {
+                for (int row = 0; row < 8; ++row)
+                {
+                    int px = x + col;
+                    int py = top + row;
+                    if ((glyph[col] >> row) & 1 && px >= 0 && px < w && py >= 0 && py < h)
+                    {
+                        setPixel(px, py, Black);
+                    }
+                }
+            }
+        }
+        x += 6;
+    }
+}
+
+void RasterSurface::present()
+{
+}
+
+int RasterSurface::width() const
+{
+    return w;
+}
+
+int RasterSurface::height() const
+{
+    return h;
+}
+
+const vector<unsigned char> &RasterSurface::pixels() const
+{
+    return rgb;
+}
+
+static void writeFile(const string &path, const vector<unsigned char> &bytes)
+{
+    ofstream out{path, ios::binary | ios::trunc};
+    out.write(reinterpret_cast<const char *>(bytes.data()), static_cast<streamsize>(bytes.size()));
+    if (!out)
+    {
+        throw FatalError("could not write image file: " + path);
+    }
+}
+
+void RasterSurface::writePpm(const string &path) const
+{
+    string header = "P6\n" + to_string(w) + " " + to_string(h) + "\n255\n";
+    vector<unsigned char> bytes;
+    bytes.reserve(header.size() + rgb.size());
+    bytes.insert(bytes.end(), header.begin(), header.end());
+    bytes.insert(bytes.end(), rgb.begin(), rgb.end());
+    writeFile(path, bytes);
+}
+
+// ==================== PNG encoding ====================
+
+// BitWriter packs deflate's least significant bit first stream
+struct BitWriter
+{
+    vector<unsigned char> &out;
+    unsigned long acc;
+    int count;
+
+    void bits(unsigned value, int n)
+    {
+        acc |= static_cast<unsigned long>(value) << count;
+        count += n;
+        while (count >= 8)
+        {
+            out.push_back(static_cast<unsigned char>(acc & 0xff));
+            acc >>= 8;
+            count -= 8;
+        }
+    }
+
+    void flush()
+    {
+        if (count > 0)
+        {
+            out.push_back(static_cast<unsigned char>(acc & 0xff));
+        }
+        acc = 0;
+        count = 0;
+    }
+};
+
+// FixedCodes is deflate's fixed literal/length Huffman table, bit-reversed once for the LSB first writer
+struct FixedCodes
+{
+    unsigned code[288];
+    int length[288];
+
+    FixedCodes()
+    {
+        for (int sym = 0; sym < 288; ++sym)
+        {
+            unsigned c;
+            int n;
+            if (sym < 144)
+            {
+                c = 0x30 + sym;
+                n = 8;
+            }
+            else if (sym < 256)
+            {
+                c = 0x190 + (sym - 144);
+                n = 9;
+            }
+            else if (sym < 280)
+            {
+                c = sym - 256;
+                n = 7;
+            }
+            else
+            {
+                c = 0xc0 + (sym - 280);
+                n = 8;
+            }
+            unsigned reversed = 0;
+            for (int i = 0; i < n; ++i)
+            {
+                reversed = (reversed << 1) | ((c >> i) & 1);
+            }
+            code[sym] = reversed;
+            length[sym] = n;
+        }
+    }
+};
+
+static void fixedSymbol(BitWriter &bw, int sym)
+{
+    static const FixedCodes table;
+    bw.bits(table.code[sym], table.length[sym]);
+}
+
+// fixedMatch writes a match of length 3..258 at distance 1, i.e. a run of the previous byte
+static void fixedMatch(BitWriter &bw, int length)
+{
+    static const int base[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27,
+                                 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+    static const int extra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+                                  2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+    int code = 28;
+    while (base[code] > length)
+    {
+        --code;
+    }
+    fixedSymbol(bw, 257 + code);
+    bw.bits(static_cast<unsigned>(length - base[code]), extra[code]);
+    bw.bits(0, 5); // distance code 0 is distance 1
+}
+
+// deflateRuns compresses data as one fixed Huffman block, turning byte runs into distance 1 matches
+//  * the filtered scanlines of a board frame are mostly long runs of zeros, which this handles well
+static void deflateRuns(const vector<unsigned char> &data, vector<unsigned char> &out)
+{
+    BitWriter bw{out, 0, 0};
+    bw.bits(1, 1); // final block
+    bw.bits(1, 2); // fixed Huffman codes
+
+    size_t i = 0;
+    while (i < data.size())
+    {
+        if (i > 0)
+        {
+            size_t run = 0;
+            while (i + run < data.size() && run < 258 && data[i + run] == data[i - 1])
+            {
+                ++run;
+            }
+            if (run >= 3)
+            {
+                fixedMatch(bw, static_cast<int>(run));
+                i += run;
+                continue;
+            }
+        }
+        fixedSymbol(bw, data[i]);
+        ++i;
+    }
+    fixedSymbol(bw, 256);
+    bw.flush();
+}
+
+static unsigned long crc32(const unsigned char *data, size_t size, unsigned long crc = 0)
+{
+    static const vector<unsigned long> table = []
+    {
+        vector<unsigned long> t(256);
+        for (unsigned long n = 0; n < 256; ++n)
+        {
+            unsigned long c = n;
+            for (int k = 0; k < 8; ++k)
+            {
+                c = (c & 1) ? 0xedb88320UL ^ (c >> 1) : c >> 1;
+            }
+            t[n] = c;
+        }
+        return t;
+    }();
+
+    crc ^= 0xffffffffUL;
+    for (size_t i = 0; i < size; ++i)
+    {
+        crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    }
+    return crc ^ 0xffffffffUL;
+}
+
+static unsigned long adler32(const vector<unsigned char> &data)
+{
+    unsigned long a = 1;
+    unsigned long b = 0;
+    size_t i = 0;
+    while (i < data.size())
+    {
+        // 5552 bytes is the most that can be summed before b could overflow 32 bits
+        size_t end = min(data.size(), i + 5552);
+        for (; i < end; ++i)
+        {
+            a += data[i];
+            b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+    }
+    return (b << 16) | a;
+}
+
+static void putBigEndian(vector<unsigned char> &out, unsigned long value)
+{
+    out.push_back(static_cast<unsigned char>((value >> 24) & 0xff));
+    out.push_back(static_cast<unsigned char>((value >> 16) & 0xff));
+    out.push_back(static_cast<unsigned char>((value >> 8) & 0xff));
+    out.push_back(static_cast<unsigned char>(value & 0xff));
+}
+
+static void putChunk(vector<unsigned char> &png, const char type[4], const vector<unsigned char> &body)
+{
+    putBigEndian(png, body.size());
+    size_t start = png.size();
+    png.insert(png.end(), type, type + 4);
+    png.insert(png.end(), body.begin(), body.end());
+    putBigEndian(png, crc32(&png[start], png.size() - start));
+}
+
+void RasterSurface::writePng(const string &path) const
+{
+    // filter each scanline: Up when it repeats the row above, otherwise Sub, so flat areas become zeros
+    size_t stride = static_cast<size_t>(w) * 3;
+    vector<unsigned char> filtered((stride + 1) * h, 0);
+    for (int y = 0; y < h; ++y)
+    {
+        const unsigned char *row = &rgb[y * stride];
+        unsigned char *dst = &filtered[y * (stride + 1)];
+        if (y > 0 && equal(row, row + stride, row - stride))
+        {
+            dst[0] = 2;
+            continue;
+        }
+        dst[0] = 1;
+        copy(row, row + 3, dst + 1);
+        for (size_t i = 3; i < stride; ++i)
+        {
+            dst[1 + i] = static_cast<unsigned char>(row[i] - row[i - 3]);
+        }
+    }
+
+    vector<unsigned char> idat{0x78, 0x01}; // zlib header, no preset dictionary
+    deflateRuns(filtered, idat);
+    putBigEndian(idat, adler32(filtered));
+
+    vector<unsigned char> ihdr;
+    putBigEndian(ihdr, static_cast<unsigned long>(w));
+    putBigEndian(ihdr, static_cast<unsigned long>(h));
+    ihdr.insert(ihdr.end(), {8, 2, 0, 0, 0}); // 8 bit RGB, no interlace
+
+    vector<unsigned char> png{0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+    putChunk(png, "IHDR", ihdr);
+    putChunk(png, "IDAT", idat);
+    putChunk(png, "IEND", {});
+    writeFile(path, png);
+}
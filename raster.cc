@@ -0,0 +1,39 @@
+export module raster;
+
+import <string>;
+import <vector>;
+import xwindow;
+
+using namespace std;
+
+// RasterSurface is a Surface backed by an RGB buffer in memory, so XView can render without a display
+//  * text uses a built-in 5x7 font on the same 6 pixel advance as the X "fixed" font
+//  * frames are written as binary PPM or as PNG with a self-contained deflate encoder
+export class RasterSurface : public Surface
+{
+public:
+    explicit RasterSurface(int width = XWIN_WIDTH, int height = XWIN_HEIGHT);
+
+    void fillRectangle(int x, int y, int width, int height, int colour = Black) override;
+    void drawString(int x, int y, const string &msg) override;
+
+    // present does nothing, the buffer is always current
+    void present() override;
+
+    int width() const;
+    int height() const;
+
+    // pixels returns width * height * 3 bytes, rows top to bottom
+    const vector<unsigned char> &pixels() const;
+
+    // writePpm and writePng save the current frame, throwing FatalError if the file cannot be written
+    void writePpm(const string &path) const;
+    void writePng(const string &path) const;
+
+private:
+    int w;
+    int h;
+    vector<unsigned char> rgb;
+
+    void setPixel(int x, int y, int colour);
+};
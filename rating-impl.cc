@@ -0,0 +1,238 @@
+module rating;
+
+import <vector>;
+import <cmath>;
+
+using namespace std;
+
+// logistic curve used by Elo ratings
+static double expectedScore(double eloDiff)
+{
+    return 1.0 / (1.0 + pow(10.0, -eloDiff / 400.0));
+}
+
+// inverse of expectedScore, clamped to keep perfect scores finite
+static double eloDiffFor(double score)
+{
+    const double eps = 1e-6;
+    if (score < eps)
+    {
+        score = eps;
+    }
+    if (score > 1.0 - eps)
+    {
+        score = 1.0 - eps;
+    }
+    return -400.0 * log10(1.0 / score - 1.0);
+}
+
+EloEstimate eloFromScore(int wins, int draws, int losses)
+{
+    int n = wins + draws + losses;
+    if (n == 0)
+    {
+        return EloEstimate{0.0, 0.0};
+    }
+
+    double w = static_cast<double>(wins) / n;
+    double d = static_cast<double>(draws) / n;
+    double l = static_cast<double>(losses) / n;
+    double mu = w + d / 2.0;
+
+    // standard error of the mean score, mapped through the Elo curve
+    double var = w * (1.0 - mu) * (1.0 - mu) +
+                 d * (0.5 - mu) * (0.5 - mu) +
+                 l * (0.0 - mu) * (0.0 - mu);
+    double stdev = sqrt(var / n);
+
+    double lo = eloDiffFor(mu - 1.96 * stdev);
+    double hi = eloDiffFor(mu + 1.96 * stdev);
+
+    return EloEstimate{eloDiffFor(mu), (hi - lo) / 2.0};
+}
+
+// probabilities of a first-player win and loss in the BayesElo model
+static void outcomeProbabilities(double diff, double drawElo, double advantage, double &pWin, double &pLoss)
+{
+    pWin = expectedScore(diff + advantage - drawElo);
+    pLoss = expectedScore(-diff - advantage - drawElo);
+}
+
+// logLikelihood of one result under the BayesElo model
+static double logLikelihood(double diff, double score, double drawElo, double advantage)
+{
+    double pWin, pLoss;
+    outcomeProbabilities(diff, drawElo, advantage, pWin, pLoss);
+    double p;
+    if (score > 0.75)
+    {
+        p = pWin;
+    }
+    else if (score < 0.25)
+    {
+        p = pLoss;
+    }
+    else
+    {
+        p = 1.0 - pWin - pLoss;
+    }
+    return log(p > 1e-12 ? p : 1e-12);
+}
+
+BayesEloModel bayesElo(int players, const vector<GameScore> &games, double priorDraws)
+{
+    BayesEloModel model;
+    model.ratings.assign(players, 0.0);
+    const double defaultDrawElo = 97.3; // BayesElo default when there is not enough data
+    model.drawElo = defaultDrawElo;
+    model.advantage = 32.8;
+
+    // estimate drawElo and advantage from the overall first-player results
+    double wins = 0, draws = 0, losses = 0;
+    for (const GameScore &g : games)
+    {
+        if (g.score > 0.75)
+        {
+            wins += 1;
+        }
+        else if (g.score < 0.25)
+        {
+            losses += 1;
+        }
+        else
+        {
+            draws += 1;
+        }
+    }
+    double n = wins + draws + losses;
+    if (n > 0 && wins > 0 && losses > 0)
+    {
+        double w = wins / n;
+        double l = losses / n;
+        model.drawElo = 200.0 * log10(((1.0 - w) / w) * ((1.0 - l) / l));
+        model.advantage = 200.0 * log10((w / l) * ((1.0 - l) / (1.0 - w)));
+        if (model.drawElo < 0)
+        {
+            model.drawElo = 0;
+        }
+    }
+
+    // per player list of games for the coordinate ascent
+    vector<vector<int>> byPlayer(players);
+    for (int i = 0; i < static_cast<int>(games.size()); ++i)
+    {
+        byPlayer[games[i].first].push_back(i);
+        byPlayer[games[i].second].push_back(i);
+    }
+
+    // posterior of player p at rating r (the others fixed)
+    auto posterior = [&](int p, double r)
+    {
+        double total = 0.0;
+        for (int gi : byPlayer[p])
+        {
+            const GameScore &g = games[gi];
+            double diff = (g.first == p)
+                              ? r - model.ratings[g.second]
+                              : model.ratings[g.first] - r;
+            total += logLikelihood(diff, g.score, model.drawElo, model.advantage);
+        }
+        // virtual draws against a 0 rated opponent, using the default draw band so the
+        // prior still bounds ratings when the data has no draws at all
+        total += priorDraws * logLikelihood(r, 0.5, defaultDrawElo, 0.0);
+        return total;
+    };
+
+    // coordinate ascent with a Newton step on numerical derivatives
+    const double h = 1.0;
+    for (int iter = 0; iter < 500; ++iter)
+    {
+        double maxChange = 0.0;
+        for (int p = 0; p < players; ++p)
+        {
+            double r = model.ratings[p];
+            double f0 = posterior(p, r);
+            double fp = posterior(p, r + h);
+            double fm = posterior(p, r - h);
+            double d1 = (fp - fm) / (2.0 * h);
+            double d2 = (fp - 2.0 * f0 + fm) / (h * h);
+
+            double step = (d2 < -1e-12) ? -d1 / d2 : d1 * 100.0;
+            if (step > 100.0)
+            {
+                step = 100.0;
+            }
+            if (step < -100.0)
+            {
+                step = -100.0;
+            }
+            model.ratings[p] = r + step;
+            if (fabs(step) > maxChange)
+            {
+                maxChange = fabs(step);
+            }
+        }
+        if (maxChange < 0.01)
+        {
+            break;
+        }
+    }
+
+    // centre the ratings on zero
+    double mean = 0.0;
+    for (double r : model.ratings)
+    {
+        mean += r;
+    }
+    if (players > 0)
+    {
+        mean /= players;
+    }
+    for (double &r : model.ratings)
+    {
+        r -= mean;
+    }
+
+    return model;
+}
+
+void sprtBounds(double alpha, double beta, double &lower, double &upper)
+{
+    lower = log(beta / (1.0 - alpha));
+    upper = log((1.0 - beta) / alpha);
+}
+
+double sprtLLR(const long long pentanomial[5], double elo0, double elo1)
+{
+    // half a virtual pair in every bucket keeps the variance honest for the first few pairs
+    const double pseudo = 0.5;
+    double counts[5];
+    double pairs = 0.0;
+    for (int i = 0; i < 5; ++i)
+    {
+        counts[i] = static_cast<double>(pentanomial[i]) + pseudo;
+        pairs += counts[i];
+    }
+
+    // pair scores are normalised to [0, 1]
+    double mean = 0.0;
+    for (int i = 0; i < 5; ++i)
+    {
+        mean += counts[i] / pairs * (i / 4.0);
+    }
+    double var = 0.0;
+    for (int i = 0; i < 5; ++i)
+    {
+        double dev = i / 4.0 - mean;
+        var += counts[i] / pairs * dev * dev;
+    }
+    if (var <= 0.0)
+    {
+        return 0.0;
+    }
+
+    double s0 = expectedScore(elo0);
+    double s1 = expectedScore(elo1);
+
+    return pairs * (s1 - s0) * (2.0 * mean - s0 - s1) / (2.0 * var);
+}
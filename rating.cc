@@ -0,0 +1,42 @@
+export module rating;
+
+import <vector>;
+
+using namespace std;
+
+// GameScore records one finished game between two rated players
+export struct GameScore
+{
+    int first;    // player that moved first (P1)
+    int second;   // player that moved second (P2)
+    double score; // 1 for a first-player win, 0.5 for a draw, 0 for a loss
+};
+
+// EloEstimate is a rating difference with its 95% error margin
+export struct EloEstimate
+{
+    double elo;
+    double error;
+};
+
+// eloFromScore converts a win/draw/loss record into an Elo difference against the opposition
+export EloEstimate eloFromScore(int wins, int draws, int losses);
+
+// BayesEloModel holds the fitted ratings and the global parameters of the draw model
+export struct BayesEloModel
+{
+    vector<double> ratings; // centred on 0
+    double drawElo;         // width of the draw band
+    double advantage;       // first-mover advantage
+};
+
+// bayesElo fits ratings with the BayesElo draw model (Coulom) by maximum a posteriori,
+// using a prior of virtual draws against a 0-rated opponent
+export BayesEloModel bayesElo(int players, const vector<GameScore> &games, double priorDraws = 2.0);
+
+// sprtBounds returns the log-likelihood ratio bounds for error rates alpha and beta
+export void sprtBounds(double alpha, double beta, double &lower, double &upper);
+
+// sprtLLR computes the generalized SPRT log-likelihood ratio for H1 (elo1) against H0 (elo0)
+// from pentanomial counts of game pairs scoring 0, 0.5, 1, 1.5 and 2 points
+export double sprtLLR(const long long pentanomial[5], double elo0, double elo1);
@@ -0,0 +1,288 @@
+import <iostream>;
+import <fstream>;
+import <sstream>;
+import <string>;
+import <vector>;
+import <filesystem>;
+import <algorithm>;
+import <exception>;
+import <cstdio>;
+
+import cli;
+import game;
+import view;
+import controller;
+import threadpool;
+import errors;
+
+using namespace std;
+
+// RegressOptions holds the command line settings for the runner
+struct RegressOptions
+{
+    unsigned threads;
+    bool update; // rewrite goldens instead of comparing
+    bool verbose;
+    vector<string> inputs;
+};
+
+// ScriptResult is the outcome of one script, filled in by a pool worker
+struct ScriptResult
+{
+    enum Status
+    {
+        Pass,
+        Fail,
+        Missing,
+        Updated,
+        Error
+    };
+
+    Status status;
+    string detail;
+};
+
+static RegressOptions parseRegressOptions(int argc, char *argv[])
+{
+    RegressOptions opts{0, false, false, {}};
+
+    for (int i = 1; i < argc; ++i)
+    {
+        string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "-threads" && hasValue)
+        {
+            opts.threads = static_cast<unsigned>(stoul(argv[++i]));
+        }
+        else if (arg == "-update")
+        {
+            opts.update = true;
+        }
+        else if (arg == "-v")
+        {
+            opts.verbose = true;
+        }
+        else if (!arg.empty() && arg[0] == '-')
+        {
+            throw ParseError("unknown option " + arg);
+        }
+        else
+        {
+            opts.inputs.push_back(arg);
+        }
+    }
+
+    if (opts.inputs.empty())
+    {
+        throw ParseError("usage: regress [-threads N] [-update] [-v] <.seq files or directories...>");
+    }
+    return opts;
+}
+
+// collectScripts expands directories into the .seq files inside them
+static vector<string> collectScripts(const vector<string> &paths)
+{
+    vector<string> files;
+    for (const string &p : paths)
+    {
+        if (filesystem::is_directory(p))
+        {
+            for (const auto &entry : filesystem::recursive_directory_iterator(p))
+            {
+                if (entry.is_regular_file() && entry.path().extension() == ".seq")
+                {
+                    files.push_back(entry.path().string());
+                }
+            }
+        }
+        else
+        {
+            files.push_back(p);
+        }
+    }
+    sort(files.begin(), files.end());
+    return files;
+}
+
+// siblingPath swaps the extension of a script, x.seq -> x.golden
+static string siblingPath(const string &script, const string &extension)
+{
+    return filesystem::path{script}.replace_extension(extension).string();
+}
+
+static bool readFile(const string &path, string &text)
+{
+    ifstream in{path, ios::binary};
+    if (!in)
+    {
+        return false;
+    }
+    ostringstream oss;
+    oss << in.rdbuf();
+    text = oss.str();
+    return true;
+}
+
+// firstDifference describes the first line where two transcripts disagree
+static string firstDifference(const string &expected, const string &actual)
+{
+    istringstream e{expected};
+    istringstream a{actual};
+    string el;
+    string al;
+    for (int line = 1;; ++line)
+    {
+        bool haveE = static_cast<bool>(getline(e, el));
+        bool haveA = static_cast<bool>(getline(a, al));
+        if (!haveE && !haveA)
+        {
+            return "transcripts differ only in trailing bytes";
+        }
+        if (haveE != haveA || el != al)
+        {
+            return "line " + to_string(line) + "\n    expected: " + (haveE ? el : "<end of output>") +
+                   "\n    actual:   " + (haveA ? al : "<end of output>");
+        }
+    }
+}
+
+// runScript plays one script through a Controller with a CaptureView, as if piped into RAIInet
+//  * a sibling .args file may hold options such as -ability1 LFDSP -link1 ...
+//  * the golden file is "hash <hex>" on the first line followed by the exact transcript
+static ScriptResult runScript(const string &script, bool update)
+{
+    string args;
+    CommandLineOptions options = readFile(siblingPath(script, ".args"), args) ? parseOptionString(args)
+                                                                              : parseOptionString("");
+
+    vector<string> lines;
+    {
+        ifstream in{script};
+        if (!in)
+        {
+            return ScriptResult{ScriptResult::Error, "could not open script"};
+        }
+        string line;
+        while (getline(in, line))
+        {
+            lines.push_back(line);
+        }
+    }
+
+    Game game{options};
+    CaptureView view{lines};
+    Controller controller{game, view};
+    controller.setEndDelay(0);
+    controller.run();
+
+    char hash[32];
+    snprintf(hash, sizeof(hash), "hash %016llx\n", game.hash());
+    string actual = string{hash} + view.output();
+
+    string goldenPath = siblingPath(script, ".golden");
+    if (update)
+    {
+        ofstream out{goldenPath, ios::binary | ios::trunc};
+        out << actual;
+        if (!out)
+        {
+            return ScriptResult{ScriptResult::Error, "could not write " + goldenPath};
+        }
+        return ScriptResult{ScriptResult::Updated, ""};
+    }
+
+    string expected;
+    if (!readFile(goldenPath, expected))
+    {
+        return ScriptResult{ScriptResult::Missing, "no golden file, run with -update"};
+    }
+    if (expected == actual)
+    {
+        return ScriptResult{ScriptResult::Pass, ""};
+    }
+
+    // report the state hash first since it is the more fundamental mismatch
+    size_t eol = expected.find('\n');
+    string expectedHash = expected.substr(0, eol);
+    string actualHash = string{hash}.substr(0, string{hash}.size() - 1);
+    if (expectedHash != actualHash)
+    {
+        return ScriptResult{ScriptResult::Fail, "final state " + actualHash + ", golden has " + expectedHash};
+    }
+    return ScriptResult{ScriptResult::Fail, "output differs at " +
+                                                firstDifference(expected.substr(eol + 1), view.output())};
+}
+
+// main runs every sequence script headlessly in parallel and checks it against its golden file
+int main(int argc, char *argv[])
+{
+    try
+    {
+        RegressOptions opts = parseRegressOptions(argc, argv);
+        vector<string> scripts = collectScripts(opts.inputs);
+        vector<ScriptResult> results(scripts.size());
+
+        {
+            WorkStealingPool pool{opts.threads};
+            for (size_t i = 0; i < scripts.size(); ++i)
+            {
+                pool.submit([&, i]
+                            {
+                    try
+                    {
+                        results[i] = runScript(scripts[i], opts.update);
+                    }
+                    catch (const RaiiError &e)
+                    {
+                        results[i] = ScriptResult{ScriptResult::Error, e.message()};
+                    }
+                    catch (const exception &e)
+                    {
+                        // one bad script must not take the other results with it
+                        results[i] = ScriptResult{ScriptResult::Error, e.what()};
+                    } });
+            }
+            pool.wait();
+        }
+
+        int counts[5] = {0, 0, 0, 0, 0};
+        const char *labels[5] = {"PASS", "FAIL", "MISSING", "UPDATED", "ERROR"};
+        for (size_t i = 0; i < scripts.size(); ++i)
+        {
+            const ScriptResult &r = results[i];
+            ++counts[r.status];
+            if (r.status != ScriptResult::Pass || opts.verbose)
+            {
+                cout << labels[r.status] << " " << scripts[i];
+                if (!r.detail.empty())
+                {
+                    cout << ": " << r.detail;
+                }
+                cout << endl;
+            }
+        }
+
+        cout << scripts.size() << " scripts: " << counts[ScriptResult::Pass] << " passed, "
+             << counts[ScriptResult::Fail] << " failed, " << counts[ScriptResult::Missing] << " missing, "
+             << counts[ScriptResult::Updated] << " updated, " << counts[ScriptResult::Error] << " errors" << endl;
+
+        bool ok = counts[ScriptResult::Fail] == 0 && counts[ScriptResult::Missing] == 0 &&
+                  counts[ScriptResult::Error] == 0;
+        return ok ? 0 : 1;
+    }
+    catch (const ParseError &e)
+    {
+        cerr << "Command line error: " << e.message() << endl;
+        return 1;
+    }
+    catch (const RaiiError &e)
+    {
+        cerr << "regress error: " << e.message() << endl;
+        return 1;
+    }
+    catch (const exception &e)
+    {
+        cerr << "Unexpected standard exception: " << e.what() << endl;
+        return 1;
+    }
+}
@@ -0,0 +1,160 @@
+import <iostream>;
+import <string>;
+import <vector>;
+import <filesystem>;
+import <atomic>;
+import <exception>;
+import <cstdio>;
+
+import game;
+import view;
+import replay;
+import raster;
+import threadpool;
+import errors;
+
+using namespace std;
+
+// RenderOptions holds the command line settings for the renderer
+struct RenderOptions
+{
+    string out;
+    bool png;
+    int every;
+    unsigned threads;
+    vector<string> inputs;
+};
+
+static RenderOptions parseRenderOptions(int argc, char *argv[])
+{
+    RenderOptions opts{"", true, 1, 0, {}};
+
+    for (int i = 1; i < argc; ++i)
+    {
+        string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "-out" && hasValue)
+        {
+            opts.out = argv[++i];
+        }
+        else if (arg == "-format" && hasValue)
+        {
+            string format = argv[++i];
+            if (format != "png" && format != "ppm")
+            {
+                throw ParseError("format must be png or ppm");
+            }
+            opts.png = format == "png";
+        }
+        else if (arg == "-every" && hasValue)
+        {
+            opts.every = stoi(argv[++i]);
+        }
+        else if (arg == "-threads" && hasValue)
+        {
+            opts.threads = static_cast<unsigned>(stoul(argv[++i]));
+        }
+        else if (!arg.empty() && arg[0] == '-')
+        {
+            throw ParseError("unknown option " + arg);
+        }
+        else
+        {
+            opts.inputs.push_back(arg);
+        }
+    }
+
+    if (opts.out.empty() || opts.inputs.empty() || opts.every < 1)
+    {
+        throw ParseError("usage: render -out <dir> [-format png|ppm] [-every N] [-threads N] "
+                         "<replay files or directories...>");
+    }
+    return opts;
+}
+
+// renderGame draws every `every`th position of one replay, and always the final one, into dir/<name>/
+//  * the frames go through XView's own drawing code onto an in-memory surface, so they match the X display
+//  * XView only repaints what changed, so consecutive frames cost little beyond the image encoding
+static long long renderGame(const string &path, const RenderOptions &opts)
+{
+    ReplayReader reader{path};
+    Game game{reader.options()};
+
+    filesystem::path dir = filesystem::path{opts.out} / filesystem::path{path}.stem();
+    filesystem::create_directories(dir);
+
+    RasterSurface surface;
+    XView view{surface};
+
+    long long n = reader.size();
+    long long frames = 0;
+    for (long long ply = 0; ply <= n; ++ply)
+    {
+        if (ply > 0)
+        {
+            ReplayRecord rec = reader.record(ply - 1);
+            applyRecord(game, rec);
+            view.showMessage(describeRecord(rec));
+        }
+        if (ply % opts.every != 0 && ply != n)
+        {
+            continue;
+        }
+
+        view.showBoard(game);
+        char name[32];
+        snprintf(name, sizeof(name), "%05lld.%s", ply, opts.png ? "png" : "ppm");
+        string file = (dir / name).string();
+        if (opts.png)
+        {
+            surface.writePng(file);
+        }
+        else
+        {
+            surface.writePpm(file);
+        }
+        ++frames;
+    }
+    return frames;
+}
+
+// main renders replays to numbered image files without a display, one game per pool task
+int main(int argc, char *argv[])
+{
+    try
+    {
+        RenderOptions opts = parseRenderOptions(argc, argv);
+        vector<string> files = collectReplayFiles(opts.inputs);
+
+        atomic<long long> frames{0};
+        {
+            WorkStealingPool pool{opts.threads};
+            for (const string &file : files)
+            {
+                pool.submit([&opts, &frames, &file]
+                            { frames += renderGame(file, opts); });
+            }
+            pool.wait();
+        }
+
+        cout << "rendered " << frames.load() << " frames from " << files.size() << " replays into " << opts.out
+             << endl;
+    }
+    catch (const ParseError &e)
+    {
+        cerr << "Command line error: " << e.message() << endl;
+        return 1;
+    }
+    catch (const RaiiError &e)
+    {
+        cerr << "render error: " << e.message() << endl;
+        return 1;
+    }
+    catch (const exception &e)
+    {
+        cerr << "Unexpected standard exception: " << e.what() << endl;
+        return 1;
+    }
+
+    return 0;
+}
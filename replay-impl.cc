@@ -0,0 +1,376 @@
+module;
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+module replay;
+
+import <string>;
+import <vector>;
+import <cstring>;
+import <filesystem>;
+import <algorithm>;
+import types;
+import cli;
+import game;
+import ability;
+import errors;
+
+using namespace std;
+
+static const char replayMagic[8] = {'R', 'A', 'I', 'I', 'R', 'E', 'P', '1'};
+static const unsigned replayVersion = 1;
+static const size_t headerSize = 96;
+static const size_t recordSize = 4;
+
+// header field offsets
+static const size_t offVersion = 8;
+static const size_t offInterval = 12;
+static const size_t offSeed = 16;
+static const size_t offCount = 24;
+static const size_t offKeyframes = 32;
+static const size_t offAbility1 = 40;
+static const size_t offAbility2 = 45;
+static const size_t offLink1 = 50;
+static const size_t offLink2 = 66;
+
+ReplayRecord ReplayRecord::move(char label, Direction dir)
+{
+    return ReplayRecord{Move, static_cast<unsigned char>(label), static_cast<unsigned char>(dir), 0};
+}
+
+ReplayRecord ReplayRecord::ability(int slot, bool hasLabel, char label, bool hasPos, Position pos)
+{
+    unsigned char packedPos = NoArg;
+    if (hasPos && pos.row >= 0 && pos.row < 16 && pos.col >= 0 && pos.col < 16)
+    {
+        packedPos = static_cast<unsigned char>(pos.row * 16 + pos.col);
+    }
+    return ReplayRecord{Ability,
+                        static_cast<unsigned char>(slot),
+                        hasLabel ? static_cast<unsigned char>(label) : NoArg,
+                        packedPos};
+}
+
+string describeRecord(const ReplayRecord &rec)
+{
+    if (rec.kind == ReplayRecord::Move)
+    {
+        const char *dirs[4] = {"up", "down", "left", "right"};
+        string s = "move ";
+        s += static_cast<char>(rec.a);
+        s += ' ';
+        s += (rec.b < 4) ? dirs[rec.b] : "?";
+        return s;
+    }
+
+    string s = "ability " + to_string(rec.a + 1);
+    if (rec.b != ReplayRecord::NoArg)
+    {
+        s += ' ';
+        s += static_cast<char>(rec.b);
+    }
+    if (rec.c != ReplayRecord::NoArg)
+    {
+        s += " " + to_string(rec.c / 16) + " " + to_string(rec.c % 16);
+    }
+    return s;
+}
+
+vector<string> collectReplayFiles(const vector<string> &paths)
+{
+    vector<string> files;
+    for (const string &p : paths)
+    {
+        if (filesystem::is_directory(p))
+        {
+            for (const auto &entry : filesystem::recursive_directory_iterator(p))
+            {
+                if (entry.is_regular_file() && entry.path().extension() == ".rpl")
+                {
+                    files.push_back(entry.path().string());
+                }
+            }
+        }
+        else
+        {
+            files.push_back(p);
+        }
+    }
+    sort(files.begin(), files.end());
+    return files;
+}
+
+void applyRecord(Game &game, const ReplayRecord &rec)
+{
+    if (rec.kind == ReplayRecord::Move)
+    {
+        if (rec.b > static_cast<unsigned char>(Direction::Right) ||
+            !game.moveLink(static_cast<char>(rec.a), static_cast<Direction>(rec.b)).ok)
+        {
+            throw FatalError("replay contains an illegal move");
+        }
+        return;
+    }
+
+    if (rec.kind != ReplayRecord::Ability || rec.a >= 5)
+    {
+        throw FatalError("replay contains a corrupt record");
+    }
+
+    PlayerId user = game.currentPlayer();
+    PlayerAbilities &pa = game.getAbilities(user);
+    if (pa.isUsed(rec.a))
+    {
+        throw FatalError("replay uses an ability card twice");
+    }
+
+    bool hasLabel = rec.b != ReplayRecord::NoArg;
+    bool hasPos = rec.c != ReplayRecord::NoArg;
+    Position pos{rec.c / 16, rec.c % 16};
+
+    pa.abilityAt(rec.a).use(game, user, hasLabel, hasPos, static_cast<char>(rec.b), pos);
+    pa.markUsed(rec.a);
+}
+
+// ==================== ReplayWriter ====================
+
+ReplayWriter::ReplayWriter(const string &path, const CommandLineOptions &options, unsigned long long seed,
+                           const Game &start, int keyframeInterval) : fd{-1},
+                                                                      interval{keyframeInterval > 0 ? keyframeInterval : 64},
+                                                                      count{0},
+                                                                      closed{false}
+{
+    fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        throw ParseError("could not open replay file: " + path);
+    }
+
+    unsigned char header[headerSize] = {};
+    memcpy(header, replayMagic, sizeof(replayMagic));
+    header[offVersion] = static_cast<unsigned char>(replayVersion);
+    header[offInterval] = static_cast<unsigned char>(interval & 0xff);
+    header[offInterval + 1] = static_cast<unsigned char>((interval >> 8) & 0xff);
+    putU64(header + offSeed, seed);
+    memcpy(header + offAbility1, options.ability1.data(), options.ability1.size() < 5 ? options.ability1.size() : 5);
+    memcpy(header + offAbility2, options.ability2.data(), options.ability2.size() < 5 ? options.ability2.size() : 5);
+    memcpy(header + offLink1, options.link1.data(), options.link1.size() < 16 ? options.link1.size() : 16);
+    memcpy(header + offLink2, options.link2.data(), options.link2.size() < 16 ? options.link2.size() : 16);
+
+    buffer.reserve(1 << 16);
+    buffer.insert(buffer.end(), header, header + headerSize);
+    keyframes.push_back(start.snapshot());
+}
+
+ReplayWriter::~ReplayWriter()
+{
+    try
+    {
+        close();
+    }
+    catch (const RaiiError &)
+    {
+        // destructors must not throw; a failed close leaves an unfinished replay
+    }
+}
+
+void ReplayWriter::writeAll(const unsigned char *p, size_t size)
+{
+    while (size > 0)
+    {
+        ssize_t n = ::write(fd, p, size);
+        if (n <= 0)
+        {
+            throw FatalError("failed to write replay file");
+        }
+        p += n;
+        size -= static_cast<size_t>(n);
+    }
+}
+
+void ReplayWriter::append(const Game &game, const ReplayRecord &rec)
+{
+    if (closed)
+    {
+        return;
+    }
+
+    unsigned char bytes[recordSize] = {rec.kind, rec.a, rec.b, rec.c};
+    buffer.insert(buffer.end(), bytes, bytes + recordSize);
+    ++count;
+
+    // the state after record k * interval - 1 is the keyframe before record k * interval
+    if (count % static_cast<unsigned long long>(interval) == 0)
+    {
+        keyframes.push_back(game.snapshot());
+    }
+
+    if (buffer.size() >= (1 << 16))
+    {
+        writeAll(buffer.data(), buffer.size());
+        buffer.clear();
+    }
+}
+
+void ReplayWriter::recordMove(const Game &game, char label, Direction dir)
+{
+    append(game, ReplayRecord::move(label, dir));
+}
+
+void ReplayWriter::recordAbility(const Game &game, int slot, bool hasLabel, char label, bool hasPos, Position pos)
+{
+    append(game, ReplayRecord::ability(slot, hasLabel, label, hasPos, pos));
+}
+
+void ReplayWriter::close()
+{
+    if (closed)
+    {
+        return;
+    }
+    closed = true;
+
+    writeAll(buffer.data(), buffer.size());
+    buffer.clear();
+
+    unsigned long long offset = headerSize + count * recordSize;
+    writeAll(reinterpret_cast<const unsigned char *>(keyframes.data()), keyframes.size() * sizeof(GameState));
+
+    // patch the record count and keyframe offset now that both are known
+    unsigned char fields[16];
+    putU64(fields, count);
+    putU64(fields + 8, offset);
+    if (::pwrite(fd, fields, sizeof(fields), offCount) != static_cast<ssize_t>(sizeof(fields)))
+    {
+        ::close(fd);
+        throw FatalError("failed to finish replay file");
+    }
+    ::close(fd);
+    fd = -1;
+}
+
+// ==================== ReplayReader ====================
+
+ReplayReader::ReplayReader(const string &path) : data{nullptr},
+                                                 length{0},
+                                                 setup{},
+                                                 seedValue{0},
+                                                 records{0},
+                                                 interval{64},
+                                                 keyframeOffset{0}
+{
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        throw ParseError("could not open replay file: " + path);
+    }
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < headerSize)
+    {
+        ::close(fd);
+        throw ParseError("not a replay file: " + path);
+    }
+    length = static_cast<size_t>(st.st_size);
+
+    void *map = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED)
+    {
+        throw ParseError("could not map replay file: " + path);
+    }
+    data = static_cast<const unsigned char *>(map);
+
+    if (memcmp(data, replayMagic, sizeof(replayMagic)) != 0 || data[offVersion] != replayVersion)
+    {
+        ::munmap(const_cast<unsigned char *>(data), length);
+        throw ParseError("not a replay file: " + path);
+    }
+
+    interval = data[offInterval] | (data[offInterval + 1] << 8);
+    seedValue = getU64(data + offSeed);
+    setup.ability1.assign(reinterpret_cast<const char *>(data + offAbility1), 5);
+    setup.ability2.assign(reinterpret_cast<const char *>(data + offAbility2), 5);
+    setup.link1.assign(reinterpret_cast<const char *>(data + offLink1), 16);
+    setup.link2.assign(reinterpret_cast<const char *>(data + offLink2), 16);
+
+    keyframeOffset = getU64(data + offKeyframes);
+    if (keyframeOffset == 0)
+    {
+        // the writer never closed this file, every whole record is still usable
+        records = static_cast<long long>((length - headerSize) / recordSize);
+    }
+    else
+    {
+        records = static_cast<long long>(getU64(data + offCount));
+        if (interval <= 0)
+        {
+            // checked before it divides anything below
+            ::munmap(const_cast<unsigned char *>(data), length);
+            throw ParseError("corrupt replay file: " + path);
+        }
+        size_t keyframeCount = static_cast<size_t>(records / interval) + 1;
+        if (keyframeOffset != headerSize + records * recordSize ||
+            keyframeOffset + keyframeCount * sizeof(GameState) > length)
+        {
+            ::munmap(const_cast<unsigned char *>(data), length);
+            throw ParseError("corrupt replay file: " + path);
+        }
+    }
+}
+
+ReplayReader::~ReplayReader()
+{
+    ::munmap(const_cast<unsigned char *>(data), length);
+}
+
+const CommandLineOptions &ReplayReader::options() const
+{
+    return setup;
+}
+
+unsigned long long ReplayReader::seed() const
+{
+    return seedValue;
+}
+
+long long ReplayReader::size() const
+{
+    return records;
+}
+
+ReplayRecord ReplayReader::record(long long i) const
+{
+    // precondition 0 <= i < size()
+    const unsigned char *p = data + headerSize + i * recordSize;
+    return ReplayRecord{p[0], p[1], p[2], p[3]};
+}
+
+void ReplayReader::seek(Game &game, long long ply) const
+{
+    if (ply < 0 || ply > records)
+    {
+        throw ParseError("ply out of range for replay");
+    }
+
+    long long from = 0;
+    if (keyframeOffset != 0)
+    {
+        from = (ply / interval) * interval;
+        GameState state;
+        memcpy(&state, data + keyframeOffset + (ply / interval) * sizeof(GameState), sizeof(GameState));
+        game.restore(state);
+    }
+    else
+    {
+        game.reset(setup);
+    }
+
+    for (long long i = from; i < ply; ++i)
+    {
+        applyRecord(game, record(i));
+    }
+}
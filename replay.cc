@@ -0,0 +1,102 @@
+export module replay;
+
+import <string>;
+import <vector>;
+import types;
+import cli;
+import game;
+
+using namespace std;
+
+// ReplayRecord is one fixed-width (4 byte) entry in a replay file: a move or an ability use
+export struct ReplayRecord
+{
+    unsigned char kind; // Move or Ability
+    unsigned char a;    // move: link label, ability: slot 0..4
+    unsigned char b;    // move: direction, ability: link label or NoArg
+    unsigned char c;    // ability: row * 16 + col or NoArg
+
+    static constexpr unsigned char Move = 1;
+    static constexpr unsigned char Ability = 2;
+    static constexpr unsigned char NoArg = 0xff;
+
+    static ReplayRecord move(char label, Direction dir);
+    static ReplayRecord ability(int slot, bool hasLabel, char label, bool hasPos, Position pos);
+};
+
+// applyRecord replays one record against game with the same rules as the controller
+//  * throws FatalError if the record is not legal in the current position
+export void applyRecord(Game &game, const ReplayRecord &rec);
+
+// describeRecord writes a record in the controller's command syntax
+export string describeRecord(const ReplayRecord &rec);
+
+// collectReplayFiles expands directories into the .rpl files inside them, sorted for stable output
+export vector<string> collectReplayFiles(const vector<string> &paths);
+
+// ReplayWriter records a game into the binary replay format
+//  * file layout: 96 byte header, 4 byte records, then a table of GameState keyframes
+//  * keyframe j is the state before record j * interval, so any ply is at most interval - 1 records away
+//  * records are buffered in memory and written in large blocks, a move costs a 4 byte append
+export class ReplayWriter
+{
+public:
+    ReplayWriter(const string &path, const CommandLineOptions &options, unsigned long long seed,
+                 const Game &start, int keyframeInterval = 64);
+    ~ReplayWriter();
+
+    ReplayWriter(const ReplayWriter &) = delete;
+    ReplayWriter &operator=(const ReplayWriter &) = delete;
+
+    // recordMove and recordAbility append a record; game must already reflect it
+    void recordMove(const Game &game, char label, Direction dir);
+    void recordAbility(const Game &game, int slot, bool hasLabel, char label, bool hasPos, Position pos);
+
+    // close writes out buffered records, the keyframe table and the final header
+    void close();
+
+private:
+    int fd;
+    int interval;
+    unsigned long long count;
+    bool closed;
+    vector<unsigned char> buffer;
+    vector<GameState> keyframes;
+
+    void append(const Game &game, const ReplayRecord &rec);
+    void writeAll(const unsigned char *data, size_t size);
+};
+
+// ReplayReader memory-maps a replay file for random access
+export class ReplayReader
+{
+public:
+    explicit ReplayReader(const string &path);
+    ~ReplayReader();
+
+    ReplayReader(const ReplayReader &) = delete;
+    ReplayReader &operator=(const ReplayReader &) = delete;
+
+    // options returns the setup the game was started with
+    const CommandLineOptions &options() const;
+    unsigned long long seed() const;
+
+    // size returns the number of records (plies, counting ability uses)
+    long long size() const;
+
+    // record returns record i in O(1)
+    ReplayRecord record(long long i) const;
+
+    // seek puts game into the state before record ply (0 is the start, size() is the end)
+    //  * restores the nearest keyframe and replays fewer than one interval of records
+    void seek(Game &game, long long ply) const;
+
+private:
+    const unsigned char *data;
+    size_t length;
+    CommandLineOptions setup;
+    unsigned long long seedValue;
+    long long records;
+    int interval;
+    unsigned long long keyframeOffset; // 0 when the writer never closed the file
+};
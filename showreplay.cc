@@ -0,0 +1,77 @@
+import <iostream>;
+import <string>;
+import <exception>;
+
+import types;
+import cli;
+import game;
+import view;
+import replay;
+import errors;
+
+using namespace std;
+
+// main prints a replay's setup and shows the board at any ply
+//  * usage: showreplay <file> [ply] [-list]
+int main(int argc, char *argv[])
+{
+    try
+    {
+        if (argc < 2)
+        {
+            throw ParseError("usage: showreplay <file> [ply] [-list]");
+        }
+
+        ReplayReader reader{argv[1]};
+        long long ply = reader.size();
+        bool list = false;
+
+        for (int i = 2; i < argc; ++i)
+        {
+            string arg = argv[i];
+            if (arg == "-list")
+            {
+                list = true;
+            }
+            else
+            {
+                ply = stoll(arg);
+            }
+        }
+
+        cout << "setup: " << optionString(reader.options()) << endl;
+        cout << "seed: " << reader.seed() << ", records: " << reader.size() << endl;
+
+        if (list)
+        {
+            for (long long i = 0; i < reader.size(); ++i)
+            {
+                cout << i << ": " << describeRecord(reader.record(i)) << endl;
+            }
+        }
+
+        Game game{reader.options()};
+        reader.seek(game, ply);
+
+        TextView view;
+        cout << "position before record " << ply << endl;
+        view.showBoard(game);
+    }
+    catch (const ParseError &e)
+    {
+        cerr << "Command line error: " << e.message() << endl;
+        return 1;
+    }
+    catch (const RaiiError &e)
+    {
+        cerr << "showreplay error: " << e.message() << endl;
+        return 1;
+    }
+    catch (const exception &e)
+    {
+        cerr << "Unexpected standard exception: " << e.what() << endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,311 @@
+import <iostream>;
+import <string>;
+import <vector>;
+import <mutex>;
+import <atomic>;
+import <memory>;
+import <exception>;
+
+import types;
+import cli;
+import game;
+import bot;
+import match;
+import threadpool;
+import rating;
+import errors;
+
+using namespace std;
+
+// SprtOptions stores the test configuration parsed from argv
+struct SprtOptions
+{
+    string testBot;
+    string baseBot;
+    vector<CommandLineOptions> configs;
+    double elo0 = 0.0;
+    double elo1 = 5.0;
+    double alpha = 0.05;
+    double beta = 0.05;
+    unsigned threads = 0;
+    long long maxPairs = 100000;
+    int maxPlies = 400;
+    unsigned long long seed = 1;
+};
+
+static SprtOptions parseSprtOptions(int argc, char *argv[])
+{
+    SprtOptions opts;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "-test" && hasValue)
+        {
+            opts.testBot = argv[++i];
+        }
+        else if (arg == "-base" && hasValue)
+        {
+            opts.baseBot = argv[++i];
+        }
+        else if (arg == "-config" && hasValue)
+        {
+            opts.configs.push_back(parseOptionString(argv[++i]));
+        }
+        else if (arg == "-elo0" && hasValue)
+        {
+            opts.elo0 = stod(argv[++i]);
+        }
+        else if (arg == "-elo1" && hasValue)
+        {
+            opts.elo1 = stod(argv[++i]);
+        }
+        else if (arg == "-alpha" && hasValue)
+        {
+            opts.alpha = stod(argv[++i]);
+        }
+        else if (arg == "-beta" && hasValue)
+        {
+            opts.beta = stod(argv[++i]);
+        }
+        else if (arg == "-threads" && hasValue)
+        {
+            opts.threads = static_cast<unsigned>(stoi(argv[++i]));
+        }
+        else if (arg == "-maxPairs" && hasValue)
+        {
+            opts.maxPairs = stoll(argv[++i]);
+        }
+        else if (arg == "-maxPlies" && hasValue)
+        {
+            opts.maxPlies = stoi(argv[++i]);
+        }
+        else if (arg == "-seed" && hasValue)
+        {
+            opts.seed = stoull(argv[++i]);
+        }
+        else
+        {
+            throw ParseError("unknown or incomplete option: " + arg);
+        }
+    }
+
+    if (opts.testBot.empty() || opts.baseBot.empty())
+    {
+        throw ParseError("usage: sprt -test <bot> -base <bot> [-elo0 E] [-elo1 E] [-config \"...\"]");
+    }
+    makeBot(opts.testBot);
+    makeBot(opts.baseBot);
+
+    if (opts.elo1 <= opts.elo0)
+    {
+        throw ParseError("elo1 must be greater than elo0");
+    }
+    if (opts.alpha <= 0 || opts.alpha >= 1 || opts.beta <= 0 || opts.beta >= 1)
+    {
+        throw ParseError("alpha and beta must be between 0 and 1");
+    }
+
+    if (opts.configs.empty())
+    {
+        opts.configs.push_back(CommandLineOptions{});
+    }
+
+    return opts;
+}
+
+// mirrored swaps the two sides of a configuration
+static CommandLineOptions mirrored(const CommandLineOptions &opts)
+{
+    CommandLineOptions m = opts;
+    m.ability1 = opts.ability2;
+    m.ability2 = opts.ability1;
+    m.link1 = opts.link2;
+    m.link2 = opts.link1;
+    return m;
+}
+
+// pairSeed derives the shared seed for both games of a pair
+static unsigned long long pairSeed(unsigned long long base, long long pair)
+{
+    unsigned long long x = base ^ (static_cast<unsigned long long>(pair) * 0x9E3779B97F4A7C15ULL);
+    x ^= x >> 31;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 29;
+    return x;
+}
+
+// SprtRun plays game pairs on every worker until the LLR crosses a bound
+class SprtRun
+{
+public:
+    SprtRun(const SprtOptions &o) : opts{o},
+                                    pool{o.threads},
+                                    nextPair{0},
+                                    decided{false},
+                                    pairsDone{0}
+    {
+        for (int i = 0; i < 5; ++i)
+        {
+            penta[i] = 0;
+        }
+        sprtBounds(opts.alpha, opts.beta, lower, upper);
+    }
+
+    // run returns 0 when H1 is accepted, 1 when H0 is accepted, 2 when undecided
+    int run()
+    {
+        cerr << "sprt: " << opts.testBot << " vs " << opts.baseBot
+             << " elo0=" << opts.elo0 << " elo1=" << opts.elo1
+             << " bounds [" << lower << ", " << upper << "] on " << pool.size() << " threads" << endl;
+
+        for (unsigned w = 0; w < pool.size(); ++w)
+        {
+            pool.submit([this]
+                        { workerLoop(); });
+        }
+        pool.wait();
+
+        double llr = currentLLR();
+        cerr << endl;
+
+        long long wins = 0, draws = 0, losses = 0;
+        for (long long s : gameScores)
+        {
+            s == 2 ? ++wins : s == 1 ? ++draws : ++losses;
+        }
+        EloEstimate elo = eloFromScore(static_cast<int>(wins), static_cast<int>(draws), static_cast<int>(losses));
+
+        cout << "pairs " << pairsDone << ", games W/D/L " << wins << "/" << draws << "/" << losses
+             << ", elo " << elo.elo << " +/- " << elo.error << endl;
+        cout << "pentanomial [" << penta[0] << ", " << penta[1] << ", " << penta[2]
+             << ", " << penta[3] << ", " << penta[4] << "]" << endl;
+
+        if (llr >= upper)
+        {
+            cout << "H1 accepted (pass), LLR " << llr << endl;
+            return 0;
+        }
+        if (llr <= lower)
+        {
+            cout << "H0 accepted (fail), LLR " << llr << endl;
+            return 1;
+        }
+        cout << "undecided after " << pairsDone << " pairs, LLR " << llr << endl;
+        return 2;
+    }
+
+private:
+    const SprtOptions &opts;
+    WorkStealingPool pool;
+    atomic<long long> nextPair;
+    atomic<bool> decided;
+
+    mutex statsLock;
+    long long penta[5];
+    long long pairsDone;
+    vector<long long> gameScores; // doubled score of the test bot per game
+    double lower;
+    double upper;
+
+    double currentLLR()
+    {
+        return sprtLLR(penta, opts.elo0, opts.elo1);
+    }
+
+    // gamePoints returns the test bot's doubled score for one finished game
+    static int gamePoints(const MatchResult &res, PlayerId testSide)
+    {
+        if (res.winner == PlayerId::None)
+        {
+            return 1;
+        }
+        return res.winner == testSide ? 2 : 0;
+    }
+
+    void workerLoop()
+    {
+        // each worker reuses one Game and one pair of bots for every pair it plays
+        Game game{opts.configs[0]};
+        unique_ptr<Bot> test = makeBot(opts.testBot);
+        unique_ptr<Bot> base = makeBot(opts.baseBot);
+
+        while (!decided.load(memory_order_relaxed))
+        {
+            long long pair = nextPair.fetch_add(1);
+            if (pair >= opts.maxPairs)
+            {
+                return;
+            }
+
+            // alternate each config with its mirrored setup so neither side keeps a layout
+            const CommandLineOptions &cfg = opts.configs[(pair / 2) % opts.configs.size()];
+            CommandLineOptions setup = (pair % 2 == 0) ? cfg : mirrored(cfg);
+            unsigned long long seed = pairSeed(opts.seed, pair);
+
+            // same setup, swapped colours
+            game.reset(setup);
+            test->seed(seed);
+            base->seed(seed + 1);
+            int first = gamePoints(playMatch(game, *test, *base, opts.maxPlies), PlayerId::P1);
+
+            game.reset(setup);
+            base->seed(seed + 2);
+            test->seed(seed + 3);
+            int second = gamePoints(playMatch(game, *base, *test, opts.maxPlies), PlayerId::P2);
+
+            record(first, second);
+        }
+    }
+
+    void record(int first, int second)
+    {
+        lock_guard<mutex> guard{statsLock};
+        if (decided.load())
+        {
+            return; // pairs finishing after the decision are not counted
+        }
+
+        ++penta[first + second];
+        ++pairsDone;
+        gameScores.push_back(first);
+        gameScores.push_back(second);
+
+        double llr = currentLLR();
+        cerr << "\rpairs " << pairsDone << "  LLR " << llr
+             << " [" << lower << ", " << upper << "]   " << flush;
+
+        if (llr >= upper || llr <= lower)
+        {
+            decided.store(true);
+        }
+    }
+};
+
+// main runs a sequential probability ratio test between two bots in-process
+int main(int argc, char *argv[])
+{
+    try
+    {
+        SprtOptions opts = parseSprtOptions(argc, argv);
+        SprtRun run{opts};
+        return run.run();
+    }
+    catch (const ParseError &e)
+    {
+        cerr << "Command line error: " << e.message() << endl;
+        return 3;
+    }
+    catch (const RaiiError &e)
+    {
+        cerr << "sprt error: " << e.message() << endl;
+        return 3;
+    }
+    catch (const exception &e)
+    {
+        cerr << "Unexpected standard exception: " << e.what() << endl;
+        return 3;
+    }
+}
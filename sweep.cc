@@ -0,0 +1,480 @@
+import <iostream>;
+import <fstream>;
+import <sstream>;
+import <string>;
+import <vector>;
+import <set>;
+import <mutex>;
+import <memory>;
+import <random>;
+import <algorithm>;
+import <filesystem>;
+import <exception>;
+import <climits>;
+
+import types;
+import cli;
+import game;
+import bot;
+import match;
+import threadpool;
+import errors;
+
+using namespace std;
+
+// SweepOptions stores the sweep configuration parsed from argv
+//  * each axis is "all", "ordered" (abilities only), "sample:N" or a literal value
+struct SweepOptions
+{
+    string ability1Axis = "LFDSP";
+    string ability2Axis = "LFDSP";
+    string link1Axis = "V1V2V3V4D1D2D3D4";
+    string link2Axis = "V1V2V3V4D1D2D3D4";
+    string bot1 = "greedy";
+    string bot2 = "greedy";
+    int games = 20;
+    long long limit = 0; // 0 keeps every cell
+    int maxPlies = 400;
+    unsigned threads = 0;
+    unsigned long long seed = 1;
+    string cacheDir = "sweep-cache";
+    string outFile;
+};
+
+// CellResult is what the cache stores for one configuration
+struct CellResult
+{
+    int p1Wins = 0;
+    int draws = 0;
+    int p2Wins = 0;
+    long long plies = 0;
+};
+
+static SweepOptions parseSweepOptions(int argc, char *argv[])
+{
+    SweepOptions opts;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "-ability1" && hasValue)
+        {
+            opts.ability1Axis = argv[++i];
+        }
+        else if (arg == "-ability2" && hasValue)
+        {
+            opts.ability2Axis = argv[++i];
+        }
+        else if (arg == "-link1" && hasValue)
+        {
+            opts.link1Axis = argv[++i];
+        }
+        else if (arg == "-link2" && hasValue)
+        {
+            opts.link2Axis = argv[++i];
+        }
+        else if (arg == "-bot1" && hasValue)
+        {
+            opts.bot1 = argv[++i];
+        }
+        else if (arg == "-bot2" && hasValue)
+        {
+            opts.bot2 = argv[++i];
+        }
+        else if (arg == "-games" && hasValue)
+        {
+            opts.games = stoi(argv[++i]);
+        }
+        else if (arg == "-limit" && hasValue)
+        {
+            opts.limit = stoll(argv[++i]);
+        }
+        else if (arg == "-maxPlies" && hasValue)
+        {
+            opts.maxPlies = stoi(argv[++i]);
+        }
+        else if (arg == "-threads" && hasValue)
+        {
+            opts.threads = static_cast<unsigned>(stoi(argv[++i]));
+        }
+        else if (arg == "-seed" && hasValue)
+        {
+            opts.seed = stoull(argv[++i]);
+        }
+        else if (arg == "-cache" && hasValue)
+        {
+            opts.cacheDir = argv[++i];
+        }
+        else if (arg == "-out" && hasValue)
+        {
+            opts.outFile = argv[++i];
+        }
+        else
+        {
+            throw ParseError("unknown or incomplete option: " + arg);
+        }
+    }
+
+    makeBot(opts.bot1);
+    makeBot(opts.bot2);
+    if (opts.games <= 0)
+    {
+        throw ParseError("-games must be positive");
+    }
+    return opts;
+}
+
+// allAbilityStrings lists every legal loadout, or one per multiset of cards when ordered is false
+static vector<string> allAbilityStrings(bool ordered)
+{
+    const string codes = "LFDSPWJH";
+    vector<string> result;
+    set<string> seenSets;
+
+    string s(5, ' ');
+    for (int n = 0; n < 8 * 8 * 8 * 8 * 8; ++n)
+    {
+        int rest = n;
+        for (int i = 0; i < 5; ++i)
+        {
+            s[i] = codes[rest % 8];
+            rest /= 8;
+        }
+
+        // the cli rules decide what a legal loadout is
+        try
+        {
+            validateAbilityString(s, "ability");
+        }
+        catch (const ParseError &)
+        {
+            continue;
+        }
+
+        if (!ordered)
+        {
+            string key = s;
+            sort(key.begin(), key.end());
+            if (!seenSets.insert(key).second)
+            {
+                continue;
+            }
+        }
+        result.push_back(s);
+    }
+    return result;
+}
+
+// allLinkOrders lists every distinct arrangement of V1..V4 and D1..D4
+static vector<string> allLinkOrders()
+{
+    vector<string> pieces = {"D1", "D2", "D3", "D4", "V1", "V2", "V3", "V4"};
+    vector<string> result;
+    do
+    {
+        string order;
+        for (const string &p : pieces)
+        {
+            order += p;
+        }
+        result.push_back(order);
+    } while (next_permutation(pieces.begin(), pieces.end()));
+    return result;
+}
+
+// expandAxis turns an axis spec into its list of values
+static vector<string> expandAxis(const string &spec, bool abilities, mt19937_64 &rng)
+{
+    bool sample = spec.rfind("sample:", 0) == 0;
+    if (spec == "all" || spec == "ordered" || sample)
+    {
+        vector<string> values = abilities ? allAbilityStrings(spec == "ordered") : allLinkOrders();
+        if (sample)
+        {
+            size_t n = static_cast<size_t>(stoul(spec.substr(7)));
+            shuffle(values.begin(), values.end(), rng);
+            if (n < values.size())
+            {
+                values.resize(n);
+            }
+        }
+        return values;
+    }
+
+    // a literal value goes through the normal option checks
+    if (abilities)
+    {
+        validateAbilityString(spec, "ability");
+    }
+    else
+    {
+        parseOptionString("-link1 " + spec);
+    }
+    return {spec};
+}
+
+// fnv1a hashes a cache key; the cache is addressed by this hash
+static unsigned long long fnv1a(const string &s)
+{
+    unsigned long long h = 0xcbf29ce484222325ULL;
+    for (unsigned char ch : s)
+    {
+        h ^= ch;
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+static string hexHash(unsigned long long h)
+{
+    const char *digits = "0123456789abcdef";
+    string out(16, '0');
+    for (int i = 15; i >= 0; --i)
+    {
+        out[i] = digits[h & 0xf];
+        h >>= 4;
+    }
+    return out;
+}
+
+// a sweep without -limit builds every cell up front, past this many it has to be sampled
+static const long long maxCells = 10000000;
+
+// Sweep plays every cell on the pool, skipping cells already in the cache
+class Sweep
+{
+public:
+    Sweep(const SweepOptions &o) : opts{o}, pool{o.threads}, cached{0}, played{0} {}
+
+    void run()
+    {
+        mt19937_64 rng{opts.seed};
+        vector<string> a1 = expandAxis(opts.ability1Axis, true, rng);
+        vector<string> a2 = expandAxis(opts.ability2Axis, true, rng);
+        vector<string> l1 = expandAxis(opts.link1Axis, false, rng);
+        vector<string> l2 = expandAxis(opts.link2Axis, false, rng);
+
+        // cells are numbered in mixed radix over the four axes, only the cells that will be played are built
+        long long total = 1;
+        for (size_t size : {a1.size(), a2.size(), l1.size(), l2.size()})
+        {
+            if (total > LLONG_MAX / static_cast<long long>(size))
+            {
+                throw ParseError("the axes have too many cells to number, narrow one of them");
+            }
+            total *= static_cast<long long>(size);
+        }
+
+        auto cellAt = [&](long long index)
+        {
+            CommandLineOptions cfg;
+            cfg.link2 = l2[static_cast<size_t>(index % static_cast<long long>(l2.size()))];
+            index /= static_cast<long long>(l2.size());
+            cfg.link1 = l1[static_cast<size_t>(index % static_cast<long long>(l1.size()))];
+            index /= static_cast<long long>(l1.size());
+            cfg.ability2 = a2[static_cast<size_t>(index % static_cast<long long>(a2.size()))];
+            index /= static_cast<long long>(a2.size());
+            cfg.ability1 = a1[static_cast<size_t>(index)];
+            return cfg;
+        };
+
+        if (opts.limit > 0 && total > opts.limit)
+        {
+            // Floyd's sample: limit distinct indexes in limit draws, without listing the rest
+            set<long long> picked;
+            for (long long j = total - opts.limit; j < total; ++j)
+            {
+                long long t = uniform_int_distribution<long long>{0, j}(rng);
+                picked.insert(picked.count(t) ? j : t);
+            }
+            for (long long index : picked)
+            {
+                cells.push_back(cellAt(index));
+            }
+        }
+        else
+        {
+            if (total > maxCells)
+            {
+                throw ParseError("the axes have more than " + to_string(maxCells) + " cells, use -limit to sample them");
+            }
+            for (long long index = 0; index < total; ++index)
+            {
+                cells.push_back(cellAt(index));
+            }
+        }
+        results.assign(cells.size(), CellResult{});
+
+        filesystem::create_directories(opts.cacheDir);
+        cerr << "sweep: " << cells.size() << " cells x " << opts.games << " games on "
+             << pool.size() << " threads, cache " << opts.cacheDir << endl;
+
+        for (size_t i = 0; i < cells.size(); ++i)
+        {
+            pool.submit([this, i]
+                        { runCell(i); });
+        }
+        pool.wait();
+
+        cerr << "sweep: " << played << " cells played, " << cached << " cells from cache" << endl;
+        writeReport();
+    }
+
+private:
+    const SweepOptions &opts;
+    WorkStealingPool pool;
+    vector<CommandLineOptions> cells;
+    vector<CellResult> results;
+    mutex countLock;
+    long long cached;
+    long long played;
+
+    // cacheKey covers everything that influences a cell's results
+    string cacheKey(const CommandLineOptions &cfg) const
+    {
+        return "raiinet-sweep-v1 " + optionString(cfg) +
+               " -bot1 " + opts.bot1 + " -bot2 " + opts.bot2 +
+               " -games " + to_string(opts.games) +
+               " -maxPlies " + to_string(opts.maxPlies) +
+               " -seed " + to_string(opts.seed);
+    }
+
+    string cachePath(const string &key) const
+    {
+        return opts.cacheDir + "/" + hexHash(fnv1a(key));
+    }
+
+    // loadCell reads a cached result, checking the stored key against hash collisions
+    bool loadCell(const string &key, CellResult &out) const
+    {
+        ifstream in{cachePath(key)};
+        string storedKey;
+        if (!in || !getline(in, storedKey) || storedKey != key)
+        {
+            return false;
+        }
+        return static_cast<bool>(in >> out.p1Wins >> out.draws >> out.p2Wins >> out.plies);
+    }
+
+    // storeCell writes to a temporary file and renames it so a killed run never leaves half a cell
+    void storeCell(const string &key, const CellResult &r) const
+    {
+        string path = cachePath(key);
+        string tmp = path + ".tmp";
+        {
+            ofstream out{tmp};
+            out << key << '\n'
+                << r.p1Wins << ' ' << r.draws << ' ' << r.p2Wins << ' ' << r.plies << '\n';
+        }
+        filesystem::rename(tmp, path);
+    }
+
+    void runCell(size_t i)
+    {
+        const CommandLineOptions &cfg = cells[i];
+        string key = cacheKey(cfg);
+
+        CellResult r;
+        if (loadCell(key, r))
+        {
+            results[i] = r;
+            lock_guard<mutex> guard{countLock};
+            ++cached;
+            return;
+        }
+
+        // one Game per cell, reset between games
+        Game game{cfg};
+        unique_ptr<Bot> p1 = makeBot(opts.bot1);
+        unique_ptr<Bot> p2 = makeBot(opts.bot2);
+        unsigned long long cellSeed = fnv1a(key);
+
+        for (int g = 0; g < opts.games; ++g)
+        {
+            if (g > 0)
+            {
+                game.reset(cfg);
+            }
+            p1->seed(cellSeed + 2 * g);
+            p2->seed(cellSeed + 2 * g + 1);
+
+            MatchResult res = playMatch(game, *p1, *p2, opts.maxPlies);
+            if (res.winner == PlayerId::P1)
+            {
+                ++r.p1Wins;
+            }
+            else if (res.winner == PlayerId::P2)
+            {
+                ++r.p2Wins;
+            }
+            else
+            {
+                ++r.draws;
+            }
+            r.plies += res.plies;
+        }
+
+        storeCell(key, r);
+        results[i] = r;
+
+        lock_guard<mutex> guard{countLock};
+        ++played;
+    }
+
+    void writeReport() const
+    {
+        ofstream file;
+        if (!opts.outFile.empty())
+        {
+            file.open(opts.outFile);
+            if (!file)
+            {
+                throw ParseError("could not open output file: " + opts.outFile);
+            }
+        }
+        ostream &out = opts.outFile.empty() ? cout : file;
+
+        out << "ability1,ability2,link1,link2,games,p1wins,draws,p2wins,p1score,avgplies" << '\n';
+        for (size_t i = 0; i < cells.size(); ++i)
+        {
+            const CellResult &r = results[i];
+            int games = r.p1Wins + r.draws + r.p2Wins;
+            double score = games ? (r.p1Wins + 0.5 * r.draws) / games : 0.0;
+            double avgPlies = games ? static_cast<double>(r.plies) / games : 0.0;
+            out << cells[i].ability1 << ',' << cells[i].ability2 << ','
+                << cells[i].link1 << ',' << cells[i].link2 << ','
+                << games << ',' << r.p1Wins << ',' << r.draws << ',' << r.p2Wins << ','
+                << score << ',' << avgPlies << '\n';
+        }
+    }
+};
+
+// main sweeps ability and link configurations with bot-vs-bot matches
+int main(int argc, char *argv[])
+{
+    try
+    {
+        SweepOptions opts = parseSweepOptions(argc, argv);
+        Sweep sweep{opts};
+        sweep.run();
+    }
+    catch (const ParseError &e)
+    {
+        cerr << "Command line error: " << e.message() << endl;
+        return 1;
+    }
+    catch (const RaiiError &e)
+    {
+        cerr << "sweep error: " << e.message() << endl;
+        return 1;
+    }
+    catch (const exception &e)
+    {
+        cerr << "Unexpected standard exception: " << e.what() << endl;
+        return 1;
+    }
+
+    return 0;
+}
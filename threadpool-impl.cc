@@ -0,0 +1,184 @@
+module threadpool;
+
+import <functional>;
+import <vector>;
+import <deque>;
+import <memory>;
+import <mutex>;
+import <thread>;
+import <condition_variable>;
+import <atomic>;
+import <exception>;
+
+using namespace std;
+
+// index of the worker running on this thread, -1 outside the pool
+static thread_local int currentWorker = -1;
+static thread_local const WorkStealingPool *currentPool = nullptr;
+
+WorkStealingPool::WorkStealingPool(unsigned threadCount) : queued{0},
+                                                           pending{0},
+                                                           stopping{false},
+                                                           firstError{},
+                                                           nextWorker{0}
+{
+    if (threadCount == 0)
+    {
+        threadCount = thread::hardware_concurrency();
+    }
+    if (threadCount == 0)
+    {
+        threadCount = 1;
+    }
+
+    for (unsigned i = 0; i < threadCount; ++i)
+    {
+        workers.push_back(make_unique<Worker>());
+    }
+    for (unsigned i = 0; i < threadCount; ++i)
+    {
+        threads.emplace_back([this, i]
+                             { workerLoop(i); });
+    }
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+    {
+        lock_guard<mutex> guard{stateLock};
+        stopping = true;
+    }
+    workAvailable.notify_all();
+
+    for (thread &t : threads)
+    {
+        t.join();
+    }
+}
+
+unsigned WorkStealingPool::size() const
+{
+    return static_cast<unsigned>(workers.size());
+}
+
+void WorkStealingPool::submit(function<void()> task)
+{
+    // keep nested work local so the submitting worker picks it up hot
+    unsigned target;
+    if (currentPool == this && currentWorker >= 0)
+    {
+        target = static_cast<unsigned>(currentWorker);
+    }
+    else
+    {
+        target = nextWorker.fetch_add(1, memory_order_relaxed) % workers.size();
+    }
+
+    {
+        lock_guard<mutex> guard{stateLock};
+        ++pending;
+    }
+    {
+        lock_guard<mutex> guard{workers[target]->lock};
+        workers[target]->tasks.push_back(std::move(task));
+    }
+    {
+        lock_guard<mutex> guard{stateLock};
+        ++queued;
+    }
+    workAvailable.notify_one();
+}
+
+void WorkStealingPool::wait()
+{
+    unique_lock<mutex> guard{stateLock};
+    allDone.wait(guard, [this]
+                 { return pending == 0; });
+
+    if (firstError)
+    {
+        exception_ptr err = firstError;
+        firstError = nullptr;
+        rethrow_exception(err);
+    }
+}
+
+// takeTask pops from our own deque first, then tries to steal from every other worker
+bool WorkStealingPool::takeTask(unsigned self, function<void()> &task)
+{
+    {
+        Worker &own = *workers[self];
+        lock_guard<mutex> guard{own.lock};
+        if (!own.tasks.empty())
+        {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+
+    size_t n = workers.size();
+    for (size_t k = 1; k < n; ++k)
+    {
+        Worker &victim = *workers[(self + k) % n];
+        lock_guard<mutex> guard{victim.lock};
+        if (!victim.tasks.empty())
+        {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkStealingPool::workerLoop(unsigned self)
+{
+    currentWorker = static_cast<int>(self);
+    currentPool = this;
+
+    while (true)
+    {
+        function<void()> task;
+        if (takeTask(self, task))
+        {
+            {
+                lock_guard<mutex> guard{stateLock};
+                --queued;
+            }
+
+            exception_ptr err;
+            try
+            {
+                task();
+            }
+            catch (...)
+            {
+                err = current_exception();
+            }
+
+            lock_guard<mutex> guard{stateLock};
+            if (err && !firstError)
+            {
+                firstError = err;
+            }
+            if (--pending == 0)
+            {
+                allDone.notify_all();
+            }
+            continue;
+        }
+
+        unique_lock<mutex> guard{stateLock};
+        if (stopping && pending == 0)
+        {
+            return;
+        }
+        workAvailable.wait(guard, [this]
+                           { return stopping || queued > 0; });
+        if (stopping && queued <= 0)
+        {
+            return;
+        }
+    }
+}
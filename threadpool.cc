@@ -0,0 +1,117 @@
+export module threadpool;
+
+import <functional>;
+import <vector>;
+import <deque>;
+import <memory>;
+import <mutex>;
+import <thread>;
+import <condition_variable>;
+import <atomic>;
+import <exception>;
+
+using namespace std;
+
+// WorkStealingPool runs tasks on a fixed set of worker threads
+//  * each worker has its own deque, pops from the back and steals from the front of the others
+//  * tasks submitted from inside a task go to the submitting worker's own deque
+export class WorkStealingPool
+{
+public:
+    // threads == 0 uses one worker per hardware thread
+    explicit WorkStealingPool(unsigned threads = 0);
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool &) = delete;
+    WorkStealingPool &operator=(const WorkStealingPool &) = delete;
+
+    // submit queues a task for execution
+    void submit(function<void()> task);
+
+    // wait blocks until every submitted task has finished
+    //  * rethrows the first exception thrown by a task, if any
+    void wait();
+
+    // size returns the number of worker threads
+    unsigned size() const;
+
+private:
+    struct Worker
+    {
+        mutex lock;
+        deque<function<void()>> tasks;
+    };
+
+    vector<unique_ptr<Worker>> workers;
+    vector<thread> threads;
+
+    mutex stateLock;
+    condition_variable workAvailable;
+    condition_variable allDone;
+    long queued;     // tasks sitting in deques, guarded by stateLock
+    size_t pending;  // tasks submitted but not finished, guarded by stateLock
+    bool stopping;
+    exception_ptr firstError;
+
+    atomic<unsigned> nextWorker;
+
+    void workerLoop(unsigned self);
+    bool takeTask(unsigned self, function<void()> &task);
+};
+
+// MpscQueue is an unbounded lock-free queue with any number of producers and a single consumer
+//  * push is wait-free: one allocation, one exchange and one store
+//  * pop must only be called from the consumer thread; it can report empty while a push is half done,
+//    so producers should wake the consumer after pushing rather than rely on it polling
+//  * items are copied in and out, it is meant for small handoff records
+export template <typename T>
+class MpscQueue
+{
+public:
+    MpscQueue() : head{new Node{}}, tail{head.load(memory_order_relaxed)}
+    {
+    }
+
+    ~MpscQueue()
+    {
+        while (tail)
+        {
+            Node *next = tail->next.load(memory_order_relaxed);
+            delete tail;
+            tail = next;
+        }
+    }
+
+    MpscQueue(const MpscQueue &) = delete;
+    MpscQueue &operator=(const MpscQueue &) = delete;
+
+    void push(const T &value)
+    {
+        Node *node = new Node{value, {nullptr}};
+        Node *prev = head.exchange(node, memory_order_acq_rel);
+        prev->next.store(node, memory_order_release);
+    }
+
+    bool pop(T &out)
+    {
+        Node *next = tail->next.load(memory_order_acquire);
+        if (!next)
+        {
+            return false;
+        }
+        out = next->value;
+        delete tail;
+        tail = next;
+        return true;
+    }
+
+private:
+    struct Node
+    {
+        T value;
+        atomic<Node *> next;
+    };
+
+    atomic<Node *> head; // last node pushed, producers swap themselves in here
+    Node *tail;          // the consumer's stub node, its successor is the next item
+};
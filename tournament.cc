@@ -0,0 +1,638 @@
+import <iostream>;
+import <fstream>;
+import <sstream>;
+import <string>;
+import <vector>;
+import <map>;
+import <set>;
+import <mutex>;
+import <memory>;
+import <algorithm>;
+import <filesystem>;
+import <exception>;
+
+import types;
+import cli;
+import game;
+import bot;
+import match;
+import threadpool;
+import rating;
+import replay;
+import errors;
+
+using namespace std;
+
+// TournamentOptions stores the tournament configuration parsed from argv
+struct TournamentOptions
+{
+    vector<string> bots;
+    vector<CommandLineOptions> configs;
+    bool swiss = false;
+    int rounds = 0; // 0 picks a default for the format
+    unsigned threads = 0;
+    string resultsFile = "tournament.results";
+    int maxPlies = 400;
+    unsigned long long seed = 1;
+    string replayDir; // empty when replays are not archived
+};
+
+// GameKey names a game by its place in the schedule: the round, the board in that round, and the game
+// on that board, one per config and colour
+struct GameKey
+{
+    int round;
+    int board;
+    int game;
+
+    bool operator<(const GameKey &other) const
+    {
+        if (round != other.round)
+        {
+            return round < other.round;
+        }
+        if (board != other.board)
+        {
+            return board < other.board;
+        }
+        return game < other.game;
+    }
+};
+
+// GameRecord is one line of the results file
+struct GameRecord
+{
+    GameKey key;
+    int first;
+    int second;
+    int config;
+    unsigned long long seed;
+    double score; // for the first player
+    int plies;
+};
+
+// Pairing is one scheduled game
+struct Pairing
+{
+    GameKey key;
+    int first;
+    int second;
+    int config;
+};
+
+// splitList splits "a,b,c" into its parts
+static vector<string> splitList(const string &s)
+{
+    vector<string> parts;
+    string cur;
+    for (char ch : s)
+    {
+        if (ch == ',')
+        {
+            if (!cur.empty())
+            {
+                parts.push_back(cur);
+            }
+            cur.clear();
+        }
+        else
+        {
+            cur += ch;
+        }
+    }
+    if (!cur.empty())
+    {
+        parts.push_back(cur);
+    }
+    return parts;
+}
+
+// parseTournamentOptions handles the tournament flags, configs go through parseOptionString
+static TournamentOptions parseTournamentOptions(int argc, char *argv[])
+{
+    TournamentOptions opts;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "-bots" && hasValue)
+        {
+            opts.bots = splitList(argv[++i]);
+        }
+        else if (arg == "-config" && hasValue)
+        {
+            opts.configs.push_back(parseOptionString(argv[++i]));
+        }
+        else if (arg == "-configs" && hasValue)
+        {
+            string file = argv[++i];
+            ifstream in{file};
+            if (!in)
+            {
+                throw ParseError("could not open configs file: " + file);
+            }
+            string line;
+            while (getline(in, line))
+            {
+                if (line.find_first_not_of(" \t\r") == string::npos || line[0] == '#')
+                {
+                    continue;
+                }
+                opts.configs.push_back(parseOptionString(line));
+            }
+        }
+        else if (arg == "-format" && hasValue)
+        {
+            string format = argv[++i];
+            if (format == "swiss")
+            {
+                opts.swiss = true;
+            }
+            else if (format != "roundrobin")
+            {
+                throw ParseError("format must be roundrobin or swiss");
+            }
+        }
+        else if (arg == "-rounds" && hasValue)
+        {
+            opts.rounds = stoi(argv[++i]);
+        }
+        else if (arg == "-threads" && hasValue)
+        {
+            opts.threads = static_cast<unsigned>(stoi(argv[++i]));
+        }
+        else if (arg == "-results" && hasValue)
+        {
+            opts.resultsFile = argv[++i];
+        }
+        else if (arg == "-maxPlies" && hasValue)
+        {
+            opts.maxPlies = stoi(argv[++i]);
+        }
+        else if (arg == "-seed" && hasValue)
+        {
+            opts.seed = stoull(argv[++i]);
+        }
+        else if (arg == "-replays" && hasValue)
+        {
+            opts.replayDir = argv[++i];
+        }
+        else
+        {
+            throw ParseError("unknown or incomplete option: " + arg);
+        }
+    }
+
+    if (opts.bots.size() < 2)
+    {
+        throw ParseError("-bots needs at least two bots, e.g. -bots random,greedy");
+    }
+
+    set<string> seen;
+    for (const string &name : opts.bots)
+    {
+        makeBot(name); // throws ParseError for unknown bots
+        if (!seen.insert(name).second)
+        {
+            throw ParseError("duplicate bot: " + name);
+        }
+    }
+
+    if (opts.configs.empty())
+    {
+        opts.configs.push_back(CommandLineOptions{});
+    }
+
+    if (opts.rounds <= 0)
+    {
+        // swiss defaults to enough rounds to separate the field
+        int n = static_cast<int>(opts.bots.size());
+        int r = 1;
+        while ((1 << r) < n)
+        {
+            ++r;
+        }
+        opts.rounds = opts.swiss ? r + 1 : 1;
+    }
+
+    return opts;
+}
+
+// mixSeed folds one schedule coordinate into a seed
+static unsigned long long mixSeed(unsigned long long base, long long value)
+{
+    unsigned long long x = base ^ (static_cast<unsigned long long>(value) * 0x9E3779B97F4A7C15ULL);
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    return x;
+}
+
+// gameSeed derives a per-game seed from its key so resumed runs replay the same games
+static unsigned long long gameSeed(unsigned long long base, const GameKey &key)
+{
+    return mixSeed(mixSeed(mixSeed(base, key.round), key.board), key.game);
+}
+
+// botList writes the -bots list the way the results file header records it
+static string botList(const vector<string> &bots)
+{
+    string list;
+    for (const string &name : bots)
+    {
+        list += (list.empty() ? "" : ",") + name;
+    }
+    return list;
+}
+
+static string scoreText(double score)
+{
+    if (score > 0.75)
+    {
+        return "1-0";
+    }
+    if (score < 0.25)
+    {
+        return "0-1";
+    }
+    return "1/2-1/2";
+}
+
+// loadResults reads previously finished games so an interrupted tournament can resume
+//  * bots are stored as indexes into -bots, so the file's "# bots" header must match the command line
+static map<GameKey, GameRecord> loadResults(const string &file, const TournamentOptions &opts)
+{
+    map<GameKey, GameRecord> done;
+    ifstream in{file};
+    if (!in)
+    {
+        return done;
+    }
+
+    int bots = static_cast<int>(opts.bots.size());
+    int configs = static_cast<int>(opts.configs.size());
+    bool header = false;
+    string line;
+    while (getline(in, line))
+    {
+        if (line.rfind("# bots ", 0) == 0)
+        {
+            if (line.substr(7) != botList(opts.bots))
+            {
+                throw ParseError("results file was written for other bots: " + line.substr(7));
+            }
+            header = true;
+            continue;
+        }
+        if (line.empty() || line[0] == '#')
+        {
+            continue;
+        }
+        if (!header)
+        {
+            throw ParseError("results file has no \"# bots\" header: " + file);
+        }
+
+        istringstream iss{line};
+        GameRecord rec;
+        string result;
+        if (!(iss >> rec.key.round >> rec.key.board >> rec.key.game >> rec.first >> rec.second >> rec.config >>
+              rec.seed >> result >> rec.plies))
+        {
+            continue; // a line cut off by an interrupted run
+        }
+
+        if (rec.first < 0 || rec.first >= bots || rec.second < 0 || rec.second >= bots || rec.first == rec.second)
+        {
+            throw ParseError("results file has a bot index outside -bots: " + line);
+        }
+        if (rec.config < 0 || rec.config >= configs)
+        {
+            throw ParseError("results file has a config index outside the configs given: " + line);
+        }
+        if (rec.key.round < 0 || rec.key.board < 0 || rec.key.game < 0)
+        {
+            throw ParseError("results file has a negative round, board or game: " + line);
+        }
+        rec.score = (result == "1-0") ? 1.0 : (result == "0-1") ? 0.0 : 0.5;
+        done[rec.key] = rec;
+    }
+    return done;
+}
+
+// Tournament schedules pairings on the pool and appends finished games to the results file
+class Tournament
+{
+public:
+    Tournament(const TournamentOptions &o) : opts{o},
+                                             pool{o.threads},
+                                             done{loadResults(o.resultsFile, o)},
+                                             out{o.resultsFile, ios::app}
+    {
+        if (!out)
+        {
+            throw ParseError("could not open results file: " + o.resultsFile);
+        }
+        if (done.empty())
+        {
+            out << "# bots " << botList(o.bots) << "\n# round board game first second config seed result plies"
+                << endl;
+        }
+    }
+
+    void run()
+    {
+        cout << "tournament: " << opts.bots.size() << " bots, " << opts.configs.size()
+             << " configs, " << pool.size() << " threads, " << done.size() << " games already played" << endl;
+
+        if (!opts.replayDir.empty())
+        {
+            filesystem::create_directories(opts.replayDir);
+        }
+
+        if (opts.swiss)
+        {
+            runSwiss();
+        }
+        else
+        {
+            runRoundRobin();
+        }
+        printStandings();
+    }
+
+private:
+    const TournamentOptions &opts;
+    WorkStealingPool pool;
+    map<GameKey, GameRecord> done;
+    ofstream out;
+    mutex resultsLock;
+
+    // schedule queues every configuration with both colour assignments for a pair of bots
+    void schedule(int round, int board, int a, int b)
+    {
+        int configs = static_cast<int>(opts.configs.size());
+        for (int c = 0; c < configs; ++c)
+        {
+            play(Pairing{GameKey{round, board, 2 * c}, a, b, c});
+            play(Pairing{GameKey{round, board, 2 * c + 1}, b, a, c});
+        }
+    }
+
+    // play submits a game unless the results file already has it
+    //  * a recorded game must be the one scheduled, down to its seed, anything else means the file
+    //    belongs to another run
+    void play(const Pairing &p)
+    {
+        {
+            lock_guard<mutex> guard{resultsLock};
+            auto found = done.find(p.key);
+            if (found != done.end())
+            {
+                const GameRecord &r = found->second;
+                if (r.first != p.first || r.second != p.second || r.config != p.config ||
+                    r.seed != gameSeed(opts.seed, p.key))
+                {
+                    throw ParseError("results file does not match the schedule at round " + to_string(p.key.round) +
+                                     " board " + to_string(p.key.board) + " game " + to_string(p.key.game));
+                }
+                return;
+            }
+        }
+
+        pool.submit([this, p]
+                    {
+            // one headless Game and fresh bots per task, nothing shared between workers
+            unsigned long long seed = gameSeed(opts.seed, p.key);
+            Game game{opts.configs[p.config]};
+            unique_ptr<Bot> first = makeBot(opts.bots[p.first]);
+            unique_ptr<Bot> second = makeBot(opts.bots[p.second]);
+            first->seed(seed);
+            second->seed(seed + 1);
+
+            unique_ptr<ReplayWriter> recorder;
+            if (!opts.replayDir.empty())
+            {
+                string path = opts.replayDir + "/r" + to_string(p.key.round) + "-b" + to_string(p.key.board) + "-g" +
+                              to_string(p.key.game) + ".rpl";
+                recorder = make_unique<ReplayWriter>(path, opts.configs[p.config], seed, game);
+            }
+
+            MatchResult res = playMatch(game, *first, *second, opts.maxPlies, recorder.get());
+            if (recorder)
+            {
+                recorder->close();
+            }
+            double score = (res.winner == PlayerId::P1) ? 1.0 : (res.winner == PlayerId::P2) ? 0.0 : 0.5;
+
+            lock_guard<mutex> guard{resultsLock};
+            done[p.key] = GameRecord{p.key, p.first, p.second, p.config, seed, score, res.plies};
+            out << p.key.round << ' ' << p.key.board << ' ' << p.key.game << ' ' << p.first << ' ' << p.second << ' '
+                << p.config << ' ' << seed << ' ' << scoreText(score) << ' ' << res.plies << endl; });
+    }
+
+    void runRoundRobin()
+    {
+        int n = static_cast<int>(opts.bots.size());
+
+        for (int cycle = 0; cycle < opts.rounds; ++cycle)
+        {
+            int board = 0;
+            for (int a = 0; a < n; ++a)
+            {
+                for (int b = a + 1; b < n; ++b)
+                {
+                    schedule(cycle, board++, a, b);
+                }
+            }
+        }
+        pool.wait();
+    }
+
+    // standings fills each bot's score and the pairs that have met from the games of rounds before round
+    //  * later rounds are left out, so a resumed run sees what the original run saw when it paired round
+    void standings(int round, vector<double> &pts, set<pair<int, int>> &met)
+    {
+        pts.assign(opts.bots.size(), 0.0);
+        met.clear();
+        lock_guard<mutex> guard{resultsLock};
+        for (const auto &entry : done)
+        {
+            const GameRecord &r = entry.second;
+            if (r.key.round >= round)
+            {
+                break; // done is ordered by round first
+            }
+            pts[r.first] += r.score;
+            pts[r.second] += 1.0 - r.score;
+            met.insert({min(r.first, r.second), max(r.first, r.second)});
+        }
+    }
+
+    // runSwiss pairs bots with equal scores each round, avoiding rematches when possible
+    //  * pairings only depend on earlier rounds so a resumed run rebuilds the same schedule
+    void runSwiss()
+    {
+        int n = static_cast<int>(opts.bots.size());
+        set<pair<int, int>> met;
+        vector<double> pts;
+        vector<double> byes(n, 0.0);
+
+        for (int round = 0; round < opts.rounds; ++round)
+        {
+            standings(round, pts, met);
+            for (int i = 0; i < n; ++i)
+            {
+                pts[i] += byes[i];
+            }
+
+            vector<int> order(n);
+            for (int i = 0; i < n; ++i)
+            {
+                order[i] = i;
+            }
+            stable_sort(order.begin(), order.end(), [&](int x, int y)
+                        { return pts[x] > pts[y]; });
+
+            vector<bool> paired(n, false);
+            int board = 0;
+            long long perPair = 2LL * static_cast<long long>(opts.configs.size());
+
+            for (int i = 0; i < n; ++i)
+            {
+                int a = order[i];
+                if (paired[a])
+                {
+                    continue;
+                }
+
+                int partner = -1;
+                for (int j = i + 1; j < n; ++j)
+                {
+                    int b = order[j];
+                    if (paired[b])
+                    {
+                        continue;
+                    }
+                    if (partner < 0)
+                    {
+                        partner = b; // fallback if everyone left was already met
+                    }
+                    if (!met.count({min(a, b), max(a, b)}))
+                    {
+                        partner = b;
+                        break;
+                    }
+                }
+
+                paired[a] = true;
+                if (partner < 0)
+                {
+                    // odd bot out gets a bye, scored as a 50% result over the 2 * configs games a pairing plays
+                    byes[a] += static_cast<double>(perPair) / 2.0;
+                    continue;
+                }
+
+                paired[partner] = true;
+                met.insert({min(a, partner), max(a, partner)});
+                schedule(round, board++, a, partner);
+            }
+
+            pool.wait();
+            cout << "round " << (round + 1) << " finished" << endl;
+        }
+    }
+
+    void printStandings()
+    {
+        int n = static_cast<int>(opts.bots.size());
+        vector<int> wins(n, 0), draws(n, 0), losses(n, 0);
+        vector<GameScore> games;
+
+        for (const auto &entry : done)
+        {
+            const GameRecord &r = entry.second;
+            games.push_back(GameScore{r.first, r.second, r.score});
+            if (r.score > 0.75)
+            {
+                ++wins[r.first];
+                ++losses[r.second];
+            }
+            else if (r.score < 0.25)
+            {
+                ++losses[r.first];
+                ++wins[r.second];
+            }
+            else
+            {
+                ++draws[r.first];
+                ++draws[r.second];
+            }
+        }
+
+        BayesEloModel model = bayesElo(n, games);
+
+        vector<int> order(n);
+        for (int i = 0; i < n; ++i)
+        {
+            order[i] = i;
+        }
+        sort(order.begin(), order.end(), [&](int x, int y)
+             { return model.ratings[x] > model.ratings[y]; });
+
+        cout << "rank name            games   W   D   L    score        elo  bayeselo" << endl;
+        int rank = 1;
+        for (int i : order)
+        {
+            int g = wins[i] + draws[i] + losses[i];
+            double score = g ? (wins[i] + 0.5 * draws[i]) / g : 0.0;
+            EloEstimate elo = eloFromScore(wins[i], draws[i], losses[i]);
+
+            ostringstream row;
+            row.setf(ios::fixed);
+            row.precision(1);
+            row << rank++ << "    " << opts.bots[i];
+            string s = row.str();
+            s.resize(max<size_t>(s.size(), 21), ' ');
+
+            ostringstream rest;
+            rest.setf(ios::fixed);
+            rest.precision(1);
+            rest << g << "  " << wins[i] << "  " << draws[i] << "  " << losses[i] << "  "
+                 << (100.0 * score) << "%  " << elo.elo << " +/- " << elo.error
+                 << "  " << model.ratings[i];
+            cout << s << rest.str() << endl;
+        }
+        cout << "drawelo " << model.drawElo << ", first move advantage " << model.advantage << endl;
+    }
+};
+
+// main runs a bot tournament in-process on a work-stealing pool
+int main(int argc, char *argv[])
+{
+    try
+    {
+        TournamentOptions opts = parseTournamentOptions(argc, argv);
+        Tournament tournament{opts};
+        tournament.run();
+    }
+    catch (const ParseError &e)
+    {
+        cerr << "Command line error: " << e.message() << endl;
+        return 1;
+    }
+    catch (const RaiiError &e)
+    {
+        cerr << "tournament error: " << e.message() << endl;
+        return 1;
+    }
+    catch (const exception &e)
+    {
+        cerr << "Unexpected standard exception: " << e.what() << endl;
+        return 1;
+    }
+
+    return 0;
+}
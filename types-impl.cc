@@ -1,5 +1,41 @@
 module types;
 
-MoveResult::MoveResult(bool okValue, bool gameOverValue, PlayerId winnerValue) : ok{okValue},
-                                                                                 gameOver{gameOverValue},
-                                                                                 winner{winnerValue} {}
+MoveResult::MoveResult(bool okValue, bool gameOverValue, PlayerId winnerValue,
+                       MoveOutcome outcomeValue, int downloadedValue) : ok{okValue},
+                                                                        gameOver{gameOverValue},
+                                                                        winner{winnerValue},
+                                                                        outcome{outcomeValue},
+                                                                        downloaded{downloadedValue},
+                                                                        firewall{false},
+                                                                        shieldUsed{false} {}
+
+void putU32(unsigned char *p, unsigned v)
+{
+    for (int i = 0; i < 4; ++i)
+    {
+        p[i] = static_cast<unsigned char>(v >> (8 * i));
+    }
+}
+
+void putU64(unsigned char *p, unsigned long long v)
+{
+    for (int i = 0; i < 8; ++i)
+    {
+        p[i] = static_cast<unsigned char>(v >> (8 * i));
+    }
+}
+
+unsigned getU32(const unsigned char *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<unsigned>(p[3]) << 24);
+}
+
+unsigned long long getU64(const unsigned char *p)
+{
+    unsigned long long v = 0;
+    for (int i = 0; i < 8; ++i)
+    {
+        v |= static_cast<unsigned long long>(p[i]) << (8 * i);
+    }
+    return v;
+}
@@ -36,12 +36,34 @@ export struct Position
     int col;
 };
 
+// what a successful move did to the moving link
+export enum class MoveOutcome {
+    Moved,
+    Swapped,
+    EdgeDownload,     // moved off the far edge
+    PortDownload,     // moved into the opponent's server port
+    BattleWon,        // attacker downloaded the defender
+    BattleLost,       // defender downloaded the attacker
+    FirewallDownload  // virus stopped by an opponent firewall
+};
+
 // MoveResult summarizes the outcome of a moveLink call
 export struct MoveResult
 {
     bool ok;
     bool gameOver;
     PlayerId winner;
+    MoveOutcome outcome;
+    int downloaded;  // index of the downloaded link or -1
+    bool firewall;   // the link passed through an opponent firewall
+    bool shieldUsed; // a battle outcome was flipped by Shield
 
-    MoveResult(bool ok = false, bool gameOver = false, PlayerId winner = PlayerId::None);
+    MoveResult(bool ok = false, bool gameOver = false, PlayerId winner = PlayerId::None,
+               MoveOutcome outcome = MoveOutcome::Moved, int downloaded = -1);
 };
+
+// little-endian byte helpers, so every file format reads the same on any host
+export void putU32(unsigned char *p, unsigned v);
+export void putU64(unsigned char *p, unsigned long long v);
+export unsigned getU32(const unsigned char *p);
+export unsigned long long getU64(const unsigned char *p);
@@ -1,12 +1,18 @@
 module;
 
 #include <curses.h>
+#include <poll.h>
+#include <unistd.h>
+#include <cerrno>
 
 module view;
 
 import <iostream>;
 import <sstream>;
 import <string>;
+import <vector>;
+import <string_view>;
+import <memory>;
 import <cctype>;
 import game;
 import types;
@@ -15,6 +21,7 @@ import link;
 import player;
 import ability;
 import xwindow;
+import errors;
 
 using namespace std;
 
@@ -24,145 +31,142 @@ static PlayerId viewerFor(const Game &game)
     return game.currentPlayer();
 }
 
-// formatLinkDetails prints "x: V1" or "x: ?" for a single link slot
-// formatLinkDetails handles visibility rules so the view only shows info known to the viewer
-static void formatLinkDetails(const Game &game, PlayerId viewer, PlayerId owner, int slot, ostream &out)
+// linkDetails writes "x: V1", "x: ?" or "x: ." for a single link slot into out and returns the length
+//  * visibility comes from the viewer's projection, so the view only shows info known to the viewer
+static int linkDetails(const Game &game, const Projection &seen, PlayerId owner, int slot, char out[6])
 {
     const PlayerState &ps = game.getPlayer(owner);
     int linkIdx = ps.getLinkIndex(slot);
 
-    char label = (owner == PlayerId::P1)
-                     ? static_cast<char>('a' + slot)
-                     : static_cast<char>('A' + slot);
-
-    out << label << ": ";
+    out[0] = (owner == PlayerId::P1)
+                 ? static_cast<char>('a' + slot)
+                 : static_cast<char>('A' + slot);
+    out[1] = ':';
+    out[2] = ' ';
 
     if (linkIdx < 0)
     {
         // downloaded or missing link
-        out << ".";
-        return;
+        out[3] = '.';
+        return 4;
     }
 
-    const Link &link = game.getLink(linkIdx);
-
-    bool reveal = false;
-
-    if (owner == viewer)
+    const LinkView &link = seen.links[linkIdx];
+    if (!link.known)
     {
-        // a player always sees their own links
-        reveal = true;
+        out[3] = '?';
+        return 4;
     }
-    else
+
+    out[3] = (link.kind == LinkKind::Virus) ? 'V' : 'D';
+    int strength = link.strength;
+    if (strength >= 0 && strength <= 9)
     {
-        // otherwise only show details if this link is known to the viewer
-        reveal = link.isKnownBy(viewer);
+        out[4] = static_cast<char>('0' + strength);
+        return 5;
     }
+    out[4] = static_cast<char>('0' + strength / 10 % 10);
+    out[5] = static_cast<char>('0' + strength % 10);
+    return 6;
+}
 
-    if (!reveal)
+// appendNumber writes a non-negative count without going through a stream
+static void appendNumber(string &frame, int n)
+{
+    char digits[12];
+    int len = 0;
+    do
     {
-        out << "?";
-        return;
+        digits[len++] = static_cast<char>('0' + n % 10);
+        n /= 10;
+    } while (n > 0 && len < 12);
+    while (len > 0)
+    {
+        frame += digits[--len];
     }
-
-    char typeChar = (link.getKind() == LinkKind::Virus) ? 'V' : 'D';
-    int strength = link.getStrength();
-
-    out << typeChar << strength;
 }
 
-// printPlayerSection writes one player's summary block (downloads, abilities, links)
-static void printPlayerSection(const Game &game, PlayerId who, ostream &out)
+// appendPlayerSection writes one player's summary block (downloads, abilities, links)
+//  * a timed game shows the player's clock after the name
+static void appendPlayerSection(const Game &game, const Projection &seen, PlayerId who, const string &clock,
+                                string &frame)
 {
-    PlayerId viewer = viewerFor(game);
     const PlayerState &ps = game.getPlayer(who);
     const PlayerAbilities &pa = game.getAbilities(who);
 
-    int playerNum = (who == PlayerId::P1) ? 1 : 2;
-
-    out << "Player " << playerNum << ": " << endl;
-    out << "Downloaded: " << ps.getDownloadedData()
-        << "D, " << ps.getDownloadedVirus() << "V" << endl;
-    out << "Abilities: " << pa.remaining() << endl;
+    frame += (who == PlayerId::P1) ? "Player 1: " : "Player 2: ";
+    frame += clock;
+    frame += '\n';
+    frame += "Downloaded: ";
+    appendNumber(frame, ps.getDownloadedData());
+    frame += "D, ";
+    appendNumber(frame, ps.getDownloadedVirus());
+    frame += "V\nAbilities: ";
+    appendNumber(frame, pa.remaining());
+    frame += '\n';
 
     // two rows of four links each
-    for (int row = 0; row < 2; ++row)
+    char details[6];
+    for (int slot = 0; slot < 8; ++slot)
     {
-        int startSlot = row * 4;
-        int endSlot = startSlot + 4;
-
-        for (int slot = startSlot; slot < endSlot; ++slot)
-        {
-            formatLinkDetails(game, viewer, who, slot, out);
-            if (slot + 1 < endSlot)
-            {
-                out << " ";
-            }
-        }
-        out << endl;
+        frame.append(details, linkDetails(game, seen, who, slot, details));
+        frame += (slot % 4 == 3) ? '\n' : ' ';
     }
 }
 
-// printBoardRows writes the 8x8 board grid using the display rules from the spec
-static void printBoardRows(const Game &game, ostream &out)
+// appendBoardRows writes the 8x8 board grid, which the projection already holds glyph by glyph
+static void appendBoardRows(const Projection &seen, string &frame)
 {
-    const Board &board = game.board();
-
     for (int r = 0; r < 8; ++r)
     {
-        for (int c = 0; c < 8; ++c)
-        {
-            Position p{r, c};
-            const Cell &cell = board.at(p);
-
-            char ch = '.';
-
-            if (cell.getKind() == CellKind::Link)
-            {
-                int idx = cell.getLinkIndex();
-                const Link &lnk = game.getLink(idx);
-                ch = lnk.getLabel();
-            }
-            else if (cell.firewallPresent())
-            {
-                PlayerId owner = cell.getFirewallOwner();
-                // m for player 1 firewalls, w for player 2 firewalls
-                ch = (owner == PlayerId::P1) ? 'm' : 'w';
-            }
-            else if (cell.isServerPortFor(PlayerId::P1) ||
-                     cell.isServerPortFor(PlayerId::P2))
-            {
-                ch = 'S';
-            }
-
-            out << ch;
-        }
-        out << endl;
+        frame.append(seen.glyphs + r * 8, 8);
+        frame += '\n';
     }
 }
 
+// renderTextFrame replaces frame with the full text display, player 1 on top and player 2 on the bottom
+//  * frame keeps its capacity between calls, so steady state rendering does not allocate
+static void renderTextFrame(const Game &game, const string clocks[2], string &frame)
+{
+    shared_ptr<const Projection> seen = game.projection(viewerFor(game));
+
+    frame.clear();
+    frame += "=========================\n";
+    appendPlayerSection(game, *seen, PlayerId::P1, clocks[0], frame);
+    frame += "========\n";
+    appendBoardRows(*seen, frame);
+    frame += "========\n";
+    appendPlayerSection(game, *seen, PlayerId::P2, clocks[1], frame);
+    frame += "=========================\n";
+}
+
 // ==================== TextView ====================
 
-// showBoard prints the full display with player 1 on top and player 2 on the bottom
-void TextView::showBoard(const Game &game)
+TextView::TextView(bool skipUnchangedValue) : skipUnchanged{skipUnchangedValue}
 {
-    cout << "=========================" << endl;
-
-    printPlayerSection(game, PlayerId::P1, cout);
+    frame.reserve(512);
+    lastFrame.reserve(512);
+}
 
-    cout << "========" << endl;
-    printBoardRows(game, cout);
-    cout << "========" << endl;
+// showBoard renders the frame into a buffer and hands it to the stream in one write and one flush
+void TextView::showBoard(const Game &game)
+{
+    renderTextFrame(game, clocks, frame);
 
-    printPlayerSection(game, PlayerId::P2, cout);
+    if (skipUnchanged && frame == lastFrame)
+    {
+        return;
+    }
 
-    cout << "=========================" << endl;
+    cout.write(frame.data(), static_cast<streamsize>(frame.size()));
+    cout.flush();
+    frame.swap(lastFrame);
 }
 
-// showMessage prints a single line as-is
+// showMessage prints a single line as-is, the next prompt flushes it
 void TextView::showMessage(const string &msg)
 {
-    cout << msg << endl;
+    cout << msg << '\n';
 }
 
 // showPrompt prints a prompt (with leading space) and flushes so the user sees it
@@ -184,9 +188,151 @@ string TextView::readCommand()
     return line;
 }
 
+void TextView::showClocks(const string &p1, const string &p2)
+{
+    clocks[0] = p1;
+    clocks[1] = p2;
+}
+
+// ==================== CaptureView ====================
+
+CaptureView::CaptureView(const vector<string> &lines) : input{lines},
+                                                        nextLine{0} {}
+
+// showBoard writes the same text TextView sends to stdout
+void CaptureView::showBoard(const Game &game)
+{
+    renderTextFrame(game, clocks, frame);
+    out << frame;
+}
+
+void CaptureView::showMessage(const string &msg)
+{
+    out << msg << '\n';
+}
+
+void CaptureView::showPrompt(const string &prompt)
+{
+    out << " " << prompt;
+}
+
+// readCommand hands out the next scripted line, then quits like TextView at EOF
+string CaptureView::readCommand()
+{
+    if (nextLine >= input.size())
+    {
+        return "quit";
+    }
+    return input[nextLine++];
+}
+
+void CaptureView::showClocks(const string &p1, const string &p2)
+{
+    clocks[0] = p1;
+    clocks[1] = p2;
+}
+
+string CaptureView::output() const
+{
+    return out.str();
+}
+
+// ==================== BufferView ====================
+
+BufferView::BufferView(string &target) : out{target}
+{
+    frame.reserve(512);
+}
+
+void BufferView::showBoard(const Game &game)
+{
+    renderTextFrame(game, clocks, frame);
+    out += frame;
+}
+
+void BufferView::showMessage(const string &msg)
+{
+    out += msg;
+    out += '\n';
+}
+
+void BufferView::showPrompt(const string &prompt)
+{
+    out += ' ';
+    out += prompt;
+}
+
+string BufferView::readCommand()
+{
+    return "quit";
+}
+
+void BufferView::showClocks(const string &p1, const string &p2)
+{
+    clocks[0] = p1;
+    clocks[1] = p2;
+}
+
+// movableSquares returns the squares of the current player's links that have at least one legal move
+static unsigned long long movableSquares(const Game &game)
+{
+    const LegalMask &legal = game.legalMask();
+    if (legal.player != PlayerId::P1 && legal.player != PlayerId::P2)
+    {
+        return 0;
+    }
+
+    shared_ptr<const Projection> seen = game.projection(legal.player);
+    const PlayerState &ps = game.getPlayer(legal.player);
+    unsigned long long squares = 0;
+    for (int slot = 0; slot < 8; ++slot)
+    {
+        int idx = ps.getLinkIndex(slot);
+        if (legal.movable(slot) && idx >= 0 && seen->links[idx].pos.row >= 0)
+        {
+            squares |= 1ULL << (seen->links[idx].pos.row * 8 + seen->links[idx].pos.col);
+        }
+    }
+    return squares;
+}
+
 // ==================== CursesView ====================
 
-CursesView::CursesView()
+// the text frame is split across three windows, each row belongs to exactly one of them
+static const int framePanelRows = 7; // border, five player lines, separator
+static const int frameBoardRows = 8;
+static const int frameRows = 2 * framePanelRows + frameBoardRows;
+
+struct CursesPanels
+{
+    WINDOW *p1Panel;
+    WINDOW *board;
+    WINDOW *p2Panel;
+    WINDOW *messages;       // messages and the prompt, scrolls when full
+    string shown[frameRows]; // what each frame row currently shows on screen
+    string frame;
+    string clocks[2];
+    unsigned long long underlined; // board squares shown underlined, links with a legal move
+};
+
+// windowForRow maps a frame row to its window and the row inside that window
+static WINDOW *windowForRow(CursesPanels &p, int row, int &local)
+{
+    if (row < framePanelRows)
+    {
+        local = row;
+        return p.p1Panel;
+    }
+    if (row < framePanelRows + frameBoardRows)
+    {
+        local = row - framePanelRows;
+        return p.board;
+    }
+    local = row - framePanelRows - frameBoardRows;
+    return p.p2Panel;
+}
+
+CursesView::CursesView() : panels{make_unique<CursesPanels>()}
 {
     // initialize ncurses once when the curses view is constructed
     initscr();
@@ -194,55 +340,128 @@ CursesView::CursesView()
     noecho();
     keypad(stdscr, TRUE);
     inputBuffer[0] = '\0';
+
+    int messageRows = LINES - frameRows;
+    if (messageRows < 1)
+    {
+        endwin();
+        throw FatalError("the curses view needs a terminal with at least " + to_string(frameRows + 1) + " rows");
+    }
+
+    panels->p1Panel = newwin(framePanelRows, COLS, 0, 0);
+    panels->board = newwin(frameBoardRows, COLS, framePanelRows, 0);
+    panels->p2Panel = newwin(framePanelRows, COLS, framePanelRows + frameBoardRows, 0);
+    panels->messages = newwin(messageRows, COLS, frameRows, 0);
+    scrollok(panels->messages, TRUE);
+    keypad(panels->messages, TRUE);
+    panels->frame.reserve(512);
 }
 
 CursesView::~CursesView()
 {
+    delwin(panels->messages);
+    delwin(panels->p2Panel);
+    delwin(panels->board);
+    delwin(panels->p1Panel);
+
     // restore terminal state
     endwin();
 }
 
+// showBoard rewrites only the rows and squares that differ from what is on screen
 void CursesView::showBoard(const Game &game)
 {
-    // render into a string first so we can dump it with a single printw
-    ostringstream out;
+    CursesPanels &p = *panels;
+    renderTextFrame(game, p.clocks, p.frame);
+
+    bool touched[3] = {false, false, false};
+    size_t start = 0;
+    for (int row = 0; row < frameRows && start < p.frame.size(); ++row)
+    {
+        size_t end = p.frame.find('\n', start);
+        string_view line{p.frame.data() + start, end - start};
+        start = end + 1;
+
+        string &old = p.shown[row];
+        if (line == old)
+        {
+            continue;
+        }
+
+        int local = 0;
+        WINDOW *win = windowForRow(p, row, local);
+        bool isBoard = (win == p.board);
+        touched[(row >= framePanelRows) + (row >= framePanelRows + frameBoardRows)] = true;
 
-    out << "=========================" << '\n';
-    printPlayerSection(game, PlayerId::P1, out);
-    out << "========" << '\n';
-    printBoardRows(game, out);
-    out << "========" << '\n';
-    printPlayerSection(game, PlayerId::P2, out);
-    out << "=========================" << '\n';
+        if (isBoard && old.size() == line.size())
+        {
+            // board rows keep their width, so only the squares that changed are sent
+            for (size_t c = 0; c < line.size(); ++c)
+            {
+                if (line[c] != old[c])
+                {
+                    mvwaddch(win, local, static_cast<int>(c), static_cast<unsigned char>(line[c]));
+                }
+            }
+        }
+        else
+        {
+            mvwaddnstr(win, local, 0, line.data(), static_cast<int>(line.size()));
+            wclrtoeol(win);
+        }
+        old.assign(line);
+    }
+
+    // the current player's links that have a legal move are underlined
+    //  * a rewritten square lost its attribute, so every movable square is set again, others only if they had it
+    unsigned long long movable = movableSquares(game);
+    for (int sq = 0; sq < 64; ++sq)
+    {
+        bool on = (movable >> sq & 1) != 0;
+        if (on || (p.underlined >> sq & 1) != 0)
+        {
+            mvwchgat(p.board, sq / 8, sq % 8, 1, on ? A_UNDERLINE : A_NORMAL, 0, nullptr);
+        }
+    }
+    touched[1] = touched[1] || movable != p.underlined;
+    p.underlined = movable;
 
-    string s = out.str();
+    // a new frame replaces the previous turn's messages
+    //  * the erase is only flushed with the next message, so text that is the same both turns is not resent
+    werase(p.messages);
 
-    // only 1 board (avoid stacking) refresh, clear, refresh, then print the new board
-    refresh();
-    clear();
-    refresh();
-    move(0, 0); // reset print location to top left
-    printw("%s", s.c_str());
-    refresh();
+    WINDOW *wins[3] = {p.p1Panel, p.board, p.p2Panel};
+    for (int i = 0; i < 3; ++i)
+    {
+        if (touched[i])
+        {
+            wnoutrefresh(wins[i]);
+        }
+    }
+    doupdate();
 }
 
 void CursesView::showMessage(const string &msg)
 {
-    printw("%s\n", msg.c_str());
-    refresh();
+    waddstr(panels->messages, msg.c_str());
+    waddch(panels->messages, '\n');
+    wnoutrefresh(panels->messages);
+    doupdate();
 }
 
 void CursesView::showPrompt(const string &prompt)
 {
-    printw(" %s", prompt.c_str());
-    refresh();
+    waddch(panels->messages, ' ');
+    waddstr(panels->messages, prompt.c_str());
+    wnoutrefresh(panels->messages);
+    doupdate();
 }
 
 string CursesView::readCommand()
 {
     // read one line of input after prompt is printed
     echo();
-    int rc = getnstr(inputBuffer, static_cast<int>(sizeof(inputBuffer) - 1));
+    int rc = wgetnstr(panels->messages, inputBuffer, static_cast<int>(sizeof(inputBuffer) - 1));
     noecho();
 
     if (rc == ERR)
@@ -254,10 +473,26 @@ string CursesView::readCommand()
     return string{inputBuffer};
 }
 
+void CursesView::showClocks(const string &p1, const string &p2)
+{
+    panels->clocks[0] = p1;
+    panels->clocks[1] = p2;
+}
+
 // ==================== XView (X11) ====================
 
-XView::XView()
-    : window{XWIN_WIDTH, XWIN_HEIGHT},
+XView::XView() : XView{new Xwindow{XWIN_WIDTH, XWIN_HEIGHT}, nullptr}
+{
+}
+
+XView::XView(Surface &target) : XView{nullptr, &target}
+{
+}
+
+// the X window, when there is one, is also the surface unless another target is given
+XView::XView(Xwindow *display, Surface *target)
+    : window{display},
+      surface{target ? *target : *display},
       cellSize{40},
       boardOriginX{60},
       boardOriginY{120},
@@ -268,110 +503,90 @@ XView::XView()
       abilityLinesDrawn{0},
       abilityHeader{},
       abilitiesOwner{PlayerId::None},
-      lastBoardPlayer{PlayerId::None}
+      lastBoardPlayer{PlayerId::None},
+      painted{false},
+      pendingInput{},
+      inputClosed{false},
+      selectedSquare{-1},
+      legal{},
+      hintedSquares{0}
 {
     for (int i = 0; i < 5; ++i)
     {
         abilityLines[i].clear();
     }
+    for (int i = 0; i < 64; ++i)
+    {
+        shownGlyph[i] = '\0';
+        shownColour[i] = -1;
+    }
 }
 
 void XView::clearAll()
 {
     // fill entire window with white
-    window.fillRectangle(0, 0, XWIN_WIDTH, XWIN_HEIGHT, Xwindow::White);
+    surface.fillRectangle(0, 0, XWIN_WIDTH, XWIN_HEIGHT, Surface::White);
 }
 
-void XView::drawGrid()
+int XView::colourForLink(const LinkView &link) const
 {
-    // simple white squares; links and markers will be drawn on top
-    for (int r = 0; r < 8; ++r)
-    {
-        for (int c = 0; c < 8; ++c)
-        {
-            int x = boardOriginX + c * cellSize;
-            int y = boardOriginY + r * cellSize;
-            window.fillRectangle(x, y, cellSize - 1, cellSize - 1, Xwindow::White);
-        }
-    }
-}
-
-int XView::colourForLink(const Link &link, PlayerId viewer) const
-{
-    bool known = (link.getOwner() == viewer) || link.isKnownBy(viewer);
-
-    if (!known)
+    if (!link.known)
     {
         // unknown links are rendered in black
-        return Xwindow::Black;
+        return Surface::Black;
     }
 
-    if (link.getKind() == LinkKind::Data)
+    if (link.kind == LinkKind::Data)
     {
-        return Xwindow::Green; // Link
+        return Surface::Green; // Link
     }
 
-    return Xwindow::Red; // Virus
+    return Surface::Red; // Virus
 }
 
-void XView::drawLinks(const Game &game)
+// drawSquares repaints only the squares whose glyph or colour differs from the last frame
+void XView::drawSquares(const Projection &seen)
 {
-    const Board &board = game.board();
-    PlayerId viewer = viewerFor(game);
-
     for (int r = 0; r < 8; ++r)
     {
         for (int c = 0; c < 8; ++c)
         {
-            Position p{r, c};
-            const Cell &cell = board.at(p);
-
-            int x = boardOriginX + c * cellSize;
-            int y = boardOriginY + r * cellSize;
-
-            // base background for the cell
-            window.fillRectangle(x, y, cellSize - 1, cellSize - 1, Xwindow::White);
+            int square = r * 8 + c;
 
-            if (cell.getKind() == CellKind::Link)
+            // links are a label on their colour, markers are a letter on white, empty squares are blank
+            char glyph = seen.glyphs[square];
+            int colour = Surface::White;
+            if (seen.linkAt[square] >= 0)
             {
-                int idx = cell.getLinkIndex();
-                const Link &lnk = game.getLink(idx);
-
-                int colour = colourForLink(lnk, viewer);
-                window.fillRectangle(x, y, cellSize - 1, cellSize - 1, colour);
-
-                string labelStr(1, lnk.getLabel());
-                // draw label roughly centred
-                int textX = x + cellSize / 3;
-                int textY = y + (2 * cellSize) / 3;
-                window.drawString(textX, textY, labelStr);
+                colour = colourForLink(seen.links[seen.linkAt[square]]);
+            }
+            else if (glyph == '.')
+            {
+                glyph = ' ';
             }
-            else if (cell.firewallPresent())
+
+            if (glyph == shownGlyph[square] && colour == shownColour[square])
             {
-                // render firewall marker
-                PlayerId owner = cell.getFirewallOwner();
-                char fw = (owner == PlayerId::P1) ? 'm' : 'w';
-                string fwStr(1, fw);
-                int textX = x + cellSize / 3;
-                int textY = y + (2 * cellSize) / 3;
-                window.drawString(textX, textY, fwStr);
+                continue;
             }
-            else if (cell.isServerPortFor(PlayerId::P1) ||
-                     cell.isServerPortFor(PlayerId::P2))
+            shownGlyph[square] = glyph;
+            shownColour[square] = colour;
+
+            int x = boardOriginX + c * cellSize;
+            int y = boardOriginY + r * cellSize;
+            surface.fillRectangle(x, y, cellSize - 1, cellSize - 1, colour);
+            if (glyph != ' ')
             {
-                string sStr("S");
-                int textX = x + cellSize / 3;
-                int textY = y + (2 * cellSize) / 3;
-                window.drawString(textX, textY, sStr);
+                // draw label roughly centred
+                surface.drawString(x + cellSize / 3, y + (2 * cellSize) / 3, string(1, glyph));
             }
-            // empty cells stay as white squares
         }
     }
 }
 
-void XView::drawPlayerPanel(const Game &game, PlayerId who, bool top)
+// drawPlayerPanel redraws the lines of one player's legend that changed
+void XView::drawPlayerPanel(const Game &game, const Projection &seen, PlayerId who, bool top)
 {
-    PlayerId viewer = viewerFor(game);
     const PlayerState &ps = game.getPlayer(who);
     const PlayerAbilities &pa = game.getAbilities(who);
 
@@ -380,46 +595,97 @@ void XView::drawPlayerPanel(const Game &game, PlayerId who, bool top)
     int baseY = top ? 30 : (boardOriginY + 8 * cellSize + 20);
     int x = 20;
 
-    ostringstream line;
+    string lines[5];
+    lines[0] = "Player " + to_string(playerNum) + ":";
+    if (!clocks[playerNum - 1].empty())
+    {
+        lines[0] += " " + clocks[playerNum - 1];
+    }
+    lines[1] = "Downloaded: " + to_string(ps.getDownloadedData()) + "D, " +
+               to_string(ps.getDownloadedVirus()) + "V";
+    lines[2] = "Abilities: " + to_string(pa.remaining());
 
-    line << "Player " << playerNum << ":";
-    window.drawString(x, baseY, line.str());
-    line.str("");
-    line.clear();
+    // two rows of four links each
+    char details[6];
+    for (int slot = 0; slot < 8; ++slot)
+    {
+        string &line = lines[3 + slot / 4];
+        line.append(details, linkDetails(game, seen, who, slot, details));
+        if (slot % 4 != 3)
+        {
+            line += ' ';
+        }
+    }
 
-    line << "Downloaded: " << ps.getDownloadedData()
-         << "D, " << ps.getDownloadedVirus() << "V";
-    window.drawString(x, baseY + 15, line.str());
-    line.str("");
-    line.clear();
+    string *shown = shownPanel[top ? 0 : 1];
+    for (int i = 0; i < 5; ++i)
+    {
+        if (lines[i] == shown[i])
+        {
+            continue;
+        }
+        int y = baseY + 15 * i;
+        surface.fillRectangle(0, y - 12, XWIN_WIDTH, 15, Surface::White);
+        surface.drawString(x, y, lines[i]);
+        shown[i] = lines[i];
+    }
+}
 
-    line << "Abilities: " << pa.remaining();
-    window.drawString(x, baseY + 30, line.str());
-    line.str("");
-    line.clear();
+// drawMessageBand redraws the status line below the P2 legend if its text changed
+void XView::drawMessageBand(const string &msg)
+{
+    if (msg == shownMessage)
+    {
+        return;
+    }
+    int msgY = boardOriginY + 8 * cellSize + 20 + 80;
+    surface.fillRectangle(0, msgY - 15, XWIN_WIDTH, 20, Surface::White);
+    if (!msg.empty())
+    {
+        surface.drawString(20, msgY, msg);
+    }
+    shownMessage = msg;
+}
 
-    // two rows of four links each
-    for (int row = 0; row < 2; ++row)
+// overlayText is the abilities overlay as one string, used to tell whether it needs redrawing
+string XView::overlayText() const
+{
+    string text = abilityHeader;
+    for (int i = 0; i < abilityLinesDrawn && i < 5; ++i)
+    {
+        text += '\n' + abilityLines[i];
+    }
+    return text;
+}
+
+// drawOverlay redraws the abilities region when its content changed
+void XView::drawOverlay(const string &overlay)
+{
+    if (overlay == shownOverlay)
     {
-        int startSlot = row * 4;
-        int endSlot = startSlot + 4;
+        return;
+    }
+    int abilitiesStartY = boardOriginY + 8 * cellSize + 20 + 80 + 20;
+    surface.fillRectangle(0, abilitiesStartY - 15, XWIN_WIDTH, 20 * 6, Surface::White);
 
-        for (int slot = startSlot; slot < endSlot; ++slot)
+    if (!overlay.empty())
+    {
+        if (!abilityHeader.empty())
+        {
+            surface.drawString(20, abilitiesStartY, abilityHeader);
+        }
+        for (int i = 0; i < abilityLinesDrawn && i < 5; ++i)
         {
-            formatLinkDetails(game, viewer, who, slot, line);
-            if (slot + 1 < endSlot)
+            if (!abilityLines[i].empty())
             {
-                line << " ";
+                surface.drawString(20, abilitiesStartY + 15 * (i + 1), abilityLines[i]);
             }
         }
-
-        window.drawString(x, baseY + 45 + row * 15, line.str());
-        line.str("");
-        line.clear();
     }
+    shownOverlay = overlay;
 }
 
-// showBoard draws the full board and both player panels
+// showBoard brings the back buffer up to date with the game, then presents it in one flush
 void XView::showBoard(const Game &game)
 {
     PlayerId current = game.currentPlayer();
@@ -427,64 +693,48 @@ void XView::showBoard(const Game &game)
     // if the turn has changed hands, wipe any cached abilities overlay
     if (lastBoardPlayer != PlayerId::None && lastBoardPlayer != current)
     {
-        abilitiesActive = false;
-        abilitiesOwner = PlayerId::None;
-        abilityHeader.clear();
-        abilityLinesDrawn = 0;
-        for (int i = 0; i < 5; ++i)
-        {
-            abilityLines[i].clear();
-        }
+        clearAbilityOverlay();
     }
     lastBoardPlayer = current;
 
-    clearAll();
-    drawGrid();
-    drawLinks(game);
-    drawPlayerPanel(game, PlayerId::P1, true);
-    drawPlayerPanel(game, PlayerId::P2, false);
-
-    int p2BaseY = boardOriginY + 8 * cellSize + 20;
-
-    // place the message band below the P2 legend lines
-    int msgY = p2BaseY + 80;
-    int abilitiesStartY = msgY + 20;
-
-    // redraw the message band from lastMessage
-    window.fillRectangle(0, msgY - 15, XWIN_WIDTH, 20, Xwindow::White);
-    if (!lastMessage.empty())
+    // a pending selection frame and its destination marks are dropped by forcing their squares to repaint
+    if (selectedSquare >= 0)
     {
-        window.drawString(20, msgY, lastMessage);
+        shownGlyph[selectedSquare] = '\0';
+        selectedSquare = -1;
     }
-
-    // redraw abilities overlay only if it belongs to the current player
-    window.fillRectangle(0, abilitiesStartY - 15, XWIN_WIDTH, 20 * 6, Xwindow::White);
-
-    if (abilitiesActive && abilitiesOwner == current)
+    for (int sq = 0; sq < 64; ++sq)
     {
-        if (!abilityHeader.empty())
+        if ((hintedSquares >> sq & 1) != 0)
         {
-            window.drawString(20, abilitiesStartY, abilityHeader);
+            shownGlyph[sq] = '\0';
         }
+    }
+    hintedSquares = 0;
+    legal = game.legalMask();
 
-        for (int i = 0; i < abilityLinesDrawn && i < 5; ++i)
-        {
-            if (!abilityLines[i].empty())
-            {
-                int y = abilitiesStartY + 15 * (i + 1);
-                window.drawString(20, y, abilityLines[i]);
-            }
-        }
+    if (!painted)
+    {
+        // only the first frame paints the whole background
+        clearAll();
+        painted = true;
     }
+
+    shared_ptr<const Projection> seen = game.projection(viewerFor(game));
+    drawSquares(*seen);
+    drawPlayerPanel(game, *seen, PlayerId::P1, true);
+    drawPlayerPanel(game, *seen, PlayerId::P2, false);
+    drawMessageBand(lastMessage);
+
+    // show the abilities overlay only if it belongs to the current player
+    drawOverlay((abilitiesActive && abilitiesOwner == current) ? overlayText() : string{});
+
+    surface.present();
 }
 
 // showMessage draws or updates the message line below the board
 void XView::showMessage(const string &msg)
 {
-    int p2BaseY = boardOriginY + 8 * cellSize + 20;
-    int msgY = p2BaseY + 80;
-    int abilitiesStartY = msgY + 20;
-
     // abilities header "Abilities:"
     if (msg.rfind("Abilities:", 0) == 0)
     {
@@ -511,9 +761,8 @@ void XView::showMessage(const string &msg)
         }
         abilitiesOwner = owner;
 
-        // draw the header into the abilities region
-        window.fillRectangle(0, abilitiesStartY - 15, XWIN_WIDTH, 20 * 6, Xwindow::White);
-        window.drawString(20, abilitiesStartY, abilityHeader);
+        drawOverlay(overlayText());
+        surface.present();
         return;
     }
 
@@ -531,19 +780,16 @@ void XView::showMessage(const string &msg)
             {
                 abilityLinesDrawn = slot + 1;
             }
-
-            int y = abilitiesStartY + 15 * (slot + 1);
-            window.drawString(20, y, msg);
+            drawOverlay(overlayText());
+            surface.present();
         }
         return;
     }
 
     // any other message is treated as a normal status line
     lastMessage = msg;
-
-    // update the message band
-    window.fillRectangle(0, msgY - 15, XWIN_WIDTH, 20, Xwindow::White);
-    window.drawString(20, msgY, msg);
+    drawMessageBand(msg);
+    surface.present();
 
     // abilities persist until an ability command is typed or the turn changes
 }
@@ -557,13 +803,187 @@ void XView::showPrompt(const string &prompt)
     cout.flush();
 }
 
-// readCommand still reads from stdin; X11 is used only for output
+void XView::clearAbilityOverlay()
+{
+    abilitiesActive = false;
+    abilitiesOwner = PlayerId::None;
+    abilityHeader.clear();
+    abilityLinesDrawn = 0;
+    for (int i = 0; i < 5; ++i)
+    {
+        abilityLines[i].clear();
+    }
+}
+
+// takeLine moves one complete line out of pendingInput, or the unterminated rest once stdin is closed
+bool XView::takeLine(string &line)
+{
+    size_t eol = pendingInput.find('\n');
+    if (eol == string::npos)
+    {
+        if (!inputClosed || pendingInput.empty())
+        {
+            return false;
+        }
+        eol = pendingInput.size();
+    }
+    line.assign(pendingInput, 0, eol);
+    pendingInput.erase(0, eol + 1 <= pendingInput.size() ? eol + 1 : eol);
+    return true;
+}
+
+// repaintSquare draws a square again from its cached state
+void XView::repaintSquare(int square)
+{
+    int x = boardOriginX + (square % 8) * cellSize;
+    int y = boardOriginY + (square / 8) * cellSize;
+    surface.fillRectangle(x, y, cellSize - 1, cellSize - 1, shownColour[square]);
+    if (shownGlyph[square] != ' ')
+    {
+        surface.drawString(x + cellSize / 3, y + (2 * cellSize) / 3, string(1, shownGlyph[square]));
+    }
+}
+
+// setSelection outlines a square in blue and marks where its link may move, forgetting the squares so
+// the next frame repaints them plainly
+void XView::setSelection(int square)
+{
+    if (selectedSquare >= 0)
+    {
+        repaintSquare(selectedSquare);
+    }
+    for (int sq = 0; sq < 64; ++sq)
+    {
+        if ((hintedSquares >> sq & 1) != 0)
+        {
+            repaintSquare(sq);
+        }
+    }
+    hintedSquares = 0;
+
+    selectedSquare = square;
+    if (square >= 0)
+    {
+        int x = boardOriginX + (square % 8) * cellSize;
+        int y = boardOriginY + (square / 8) * cellSize;
+        surface.fillRectangle(x, y, cellSize - 1, 3, Surface::Blue);
+        surface.fillRectangle(x, y + cellSize - 4, cellSize - 1, 3, Surface::Blue);
+        surface.fillRectangle(x, y, 3, cellSize - 1, Surface::Blue);
+        surface.fillRectangle(x + cellSize - 4, y, 3, cellSize - 1, Surface::Blue);
+
+        // a small square in the corner of every destination, off-board moves have none
+        int slot = shownGlyph[square] - ((lastBoardPlayer == PlayerId::P1) ? 'a' : 'A');
+        for (int d = 0; d < 4 && slot >= 0 && slot < 8; ++d)
+        {
+            int to = legal.dest[slot][d];
+            if ((legal.moves[slot] >> d & 1) != 0 && to >= 0)
+            {
+                hintedSquares |= 1ULL << to;
+                surface.fillRectangle(boardOriginX + (to % 8) * cellSize + 4, boardOriginY + (to / 8) * cellSize + 4,
+                                      6, 6, Surface::Blue);
+            }
+        }
+    }
+    surface.present();
+}
+
+// clickToCommand turns two clicks into a move: first one of the current player's links, then a square
+// in line with it; the direction is all that matters, so clicking just past the far edge downloads
+bool XView::clickToCommand(int x, int y, string &command)
+{
+    int col = (x - boardOriginX) >= 0 ? (x - boardOriginX) / cellSize : -1;
+    int row = (y - boardOriginY) >= 0 ? (y - boardOriginY) / cellSize : -1;
+
+    if (selectedSquare < 0)
+    {
+        if (row < 0 || row >= 8 || col < 0 || col >= 8)
+        {
+            return false;
+        }
+        int square = row * 8 + col;
+        char glyph = shownGlyph[square];
+        bool isLink = shownColour[square] != Surface::White;
+        bool ours = (lastBoardPlayer == PlayerId::P1) ? (glyph >= 'a' && glyph <= 'h') : (glyph >= 'A' && glyph <= 'H');
+        int slot = glyph - ((lastBoardPlayer == PlayerId::P1) ? 'a' : 'A');
+        if (isLink && ours && legal.movable(slot))
+        {
+            setSelection(square);
+        }
+        return false;
+    }
+
+    int fromRow = selectedSquare / 8;
+    int fromCol = selectedSquare % 8;
+    char label = shownGlyph[selectedSquare];
+    setSelection(-1);
+
+    const char *dir = nullptr;
+    if (col == fromCol && row != fromRow)
+    {
+        dir = (row < fromRow) ? "up" : "down";
+    }
+    else if (row == fromRow && col != fromCol && col >= 0 && col < 8)
+    {
+        dir = (col < fromCol) ? "left" : "right";
+    }
+    if (!dir)
+    {
+        return false; // anything else cancels the selection
+    }
+
+    command = string{"move "} + label + " " + dir;
+    return true;
+}
+
+// readCommand waits for a typed line or a click-to-move, answering X events while it waits
 string XView::readCommand()
 {
     string line;
-    if (!getline(cin, line))
+    while (!takeLine(line))
     {
-        return "quit";
+        if (inputClosed)
+        {
+            return "quit";
+        }
+
+        // Xlib may already hold queued events that poll cannot see, so drain them first
+        int clickX = 0;
+        int clickY = 0;
+        if (window && window->processEvents(clickX, clickY))
+        {
+            if (clickToCommand(clickX, clickY, line))
+            {
+                // echo it so the terminal transcript matches what was played
+                cout << line << endl;
+                break;
+            }
+            continue;
+        }
+
+        // an offscreen view has no connection and waits on stdin alone
+        pollfd fds[2] = {{STDIN_FILENO, POLLIN, 0}, {window ? window->connection() : -1, POLLIN, 0}};
+        if (poll(fds, window ? 2 : 1, -1) < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return "quit";
+        }
+
+        if (fds[0].revents & (POLLIN | POLLHUP | POLLERR))
+        {
+            char buf[4096];
+            ssize_t n = ::read(STDIN_FILENO, buf, sizeof(buf));
+            if (n <= 0)
+            {
+                inputClosed = true;
+            }
+            else
+            {
+                pendingInput.append(buf, static_cast<size_t>(n));
+            }
+        }
     }
 
     // trim leading spaces
@@ -585,16 +1005,15 @@ string XView::readCommand()
         // if the command is "ability", clear the overlay to avoid stale data
         if (word == "ability")
         {
-            abilitiesActive = false;
-            abilitiesOwner = PlayerId::None;
-            abilityHeader.clear();
-            abilityLinesDrawn = 0;
-            for (int i = 0; i < 5; ++i)
-            {
-                abilityLines[i].clear();
-            }
+            clearAbilityOverlay();
         }
     }
 
     return line;
 }
+
+void XView::showClocks(const string &p1, const string &p2)
+{
+    clocks[0] = p1;
+    clocks[1] = p2;
+}
@@ -1,6 +1,9 @@
 export module view;
 
 import <string>;
+import <vector>;
+import <sstream>;
+import <memory>;
 import game;
 import xwindow;
 import types;
@@ -25,23 +28,83 @@ public:
 
     // readCommand reads one full command line from the user
     virtual string readCommand() = 0;
+
+    // showClocks sets the time left shown next to each player from the next board on, empty strings for none
+    virtual void showClocks(const string &p1, const string &p2) = 0;
 };
 
 // TextView prints the game to stdout using plain text
+//  * each frame is rendered into a reused buffer and written at once
+//  * with skipUnchanged a frame identical to the last one printed is dropped
 export class TextView : public IView
 {
+    string frame;
+    string lastFrame;
+    bool skipUnchanged;
+    string clocks[2];
+
+public:
+    explicit TextView(bool skipUnchanged = false);
+
+    void showBoard(const Game &game) override;
+    void showMessage(const string &msg) override;
+    void showPrompt(const string &prompt) override;
+    string readCommand() override;
+    void showClocks(const string &p1, const string &p2) override;
+};
+
+// CaptureView renders exactly like TextView but into a buffer, reading its commands from a list
+//  * lets headless runners see what RAIInet would have printed for a script
+export class CaptureView : public IView
+{
+    ostringstream out;
+    string frame;
+    string clocks[2];
+    vector<string> input;
+    size_t nextLine;
+
+public:
+    explicit CaptureView(const vector<string> &lines);
+
+    void showBoard(const Game &game) override;
+    void showMessage(const string &msg) override;
+    void showPrompt(const string &prompt) override;
+    string readCommand() override;
+    void showClocks(const string &p1, const string &p2) override;
+
+    // output returns everything rendered so far
+    string output() const;
+};
+
+// BufferView renders exactly like TextView but appends to a string owned by the caller
+//  * used by network sessions, which send the string and drain it themselves
+//  * input comes from the caller through Controller::handleLine, readCommand only ever answers "quit"
+export class BufferView : public IView
+{
+    string &out;
+    string frame;
+    string clocks[2];
+
 public:
+    explicit BufferView(string &target);
+
     void showBoard(const Game &game) override;
     void showMessage(const string &msg) override;
     void showPrompt(const string &prompt) override;
     string readCommand() override;
+    void showClocks(const string &p1, const string &p2) override;
 };
 
-// CursesView clears and redraws the board on each update
+// CursesPanels holds the ncurses windows behind a CursesView, defined next to the implementation
+struct CursesPanels;
+
+// CursesView draws the player panels, board and message line in separate ncurses windows
+//  * only lines and squares that changed since the last frame are rewritten, then flushed with one doupdate
 //  * Needs a char[] buffer to take in text via getnstr from curses.h
 export class CursesView : public IView
 {
     char inputBuffer[1024];
+    unique_ptr<CursesPanels> panels;
 
 public:
     CursesView();
@@ -51,18 +114,23 @@ public:
     void showMessage(const string &msg) override;
     void showPrompt(const string &prompt) override;
     string readCommand() override;
+    void showClocks(const string &p1, const string &p2) override;
 };
 
-// XView draws the game using an X11 window via Xwindow
+// XView draws the game using an X11 window via Xwindow, or onto any other Surface
+//  * remembers what each square, panel line and the message band show, and only redraws what changed
+//  * readCommand waits on stdin and the X connection together, so Expose and clicks are handled while idle
 export class XView : public IView
 {
-    Xwindow window;
+    unique_ptr<Xwindow> window; // null when drawing to an offscreen surface
+    Surface &surface;
     int cellSize;
     int boardOriginX;
     int boardOriginY;
     int statusHeight;
     string lastMessage;
     string lastPrompt;
+    string clocks[2];
 
     // abilities overlay state
     //  * unique to XView to persist ability overlay until player changes
@@ -73,19 +141,49 @@ export class XView : public IView
     PlayerId abilitiesOwner;
     PlayerId lastBoardPlayer;
 
+    // what is on screen now, a frame only redraws entries that differ
+    bool painted;
+    char shownGlyph[64];
+    int shownColour[64];
+    string shownPanel[2][5];
+    string shownMessage;
+    string shownOverlay;
+
+    // input state: stdin bytes not yet returned as a line, and the square picked by a first click
+    string pendingInput;
+    bool inputClosed;
+    int selectedSquare;
+
+    // the current turn's legal mask, and the squares marked as the selected link's destinations
+    LegalMask legal;
+    unsigned long long hintedSquares;
+
 public:
     XView();
+
+    // XView(target) draws on target without opening a display; readCommand then reads stdin only
+    explicit XView(Surface &target);
     ~XView() override = default;
 
     void showBoard(const Game &game) override;
     void showMessage(const string &msg) override;
     void showPrompt(const string &prompt) override;
     string readCommand() override;
+    void showClocks(const string &p1, const string &p2) override;
 
 private:
+    XView(Xwindow *display, Surface *target);
+
     void clearAll();
-    void drawGrid();
-    void drawLinks(const Game &game);
-    void drawPlayerPanel(const Game &game, PlayerId who, bool top);
-    int colourForLink(const Link &link, PlayerId viewer) const;
+    void drawSquares(const Projection &seen);
+    void drawPlayerPanel(const Game &game, const Projection &seen, PlayerId who, bool top);
+    void drawMessageBand(const string &msg);
+    void drawOverlay(const string &overlay);
+    string overlayText() const;
+    int colourForLink(const LinkView &link) const;
+    bool takeLine(string &line);
+    bool clickToCommand(int x, int y, string &command);
+    void setSelection(int square);
+    void repaintSquare(int square);
+    void clearAbilityOverlay();
 };
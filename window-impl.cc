@@ -6,10 +6,13 @@ module xwindow;
 import <iostream>;
 import <cstdlib>;
 import <string>;
+import <algorithm>;
 
 using namespace std;
 
-Xwindow::Xwindow(int width, int height) {
+Xwindow::Xwindow(int width, int height) : width{width}, height{height}, foreground{-1},
+                                         fontAscent{10}, fontDescent{3}, font{nullptr}, dirty{false},
+                                         dirtyX1{0}, dirtyY1{0}, dirtyX2{0}, dirtyY2{0} {
 
   d = XOpenDisplay(NULL);
   if (d == NULL) {
@@ -19,15 +22,13 @@ Xwindow::Xwindow(int width, int height) {
   s = DefaultScreen(d);
   w = XCreateSimpleWindow(d, RootWindow(d, s), 10, 10, width, height, 1,
                           BlackPixel(d, s), WhitePixel(d, s));
-  XSelectInput(d, w, ExposureMask | KeyPressMask);
+  XSelectInput(d, w, ExposureMask | KeyPressMask | ButtonPressMask);
   XMapRaised(d, w);
 
-  Pixmap pix = XCreatePixmap(d,w,width,
+  // every draw goes to this back buffer, the window only ever receives copies
+  buffer = XCreatePixmap(d,w,width,
         height,DefaultDepth(d,DefaultScreen(d)));
-  gc = XCreateGC(d, pix, 0,(XGCValues *)0);
-
-  XFlush(d);
-  XFlush(d);
+  gc = XCreateGC(d, buffer, 0,(XGCValues *)0);
 
   // Set up colours.
   XColor xcolour;
@@ -41,7 +42,17 @@ Xwindow::Xwindow(int width, int height) {
       colours[i]=xcolour.pixel;
   }
 
-  XSetForeground(d,gc,colours[Black]);
+  // font metrics let drawString mark exactly the area it touched
+  font = XQueryFont(d, XGContextFromGC(gc));
+  if (font) {
+    fontAscent = font->ascent;
+    fontDescent = font->descent;
+  }
+
+  // start from a white buffer, matching the window background
+  setForeground(White);
+  XFillRectangle(d, buffer, gc, 0, 0, width, height);
+  setForeground(Black);
 
   // Make window non-resizeable.
   XSizeHints hints;
@@ -50,24 +61,82 @@ Xwindow::Xwindow(int width, int height) {
   hints.width = hints.base_width = hints.min_width = hints.max_width = width;
   XSetNormalHints(d, w, &hints);
 
-  XSynchronize(d, True);
-
-  usleep(10);
+  XFlush(d);
 }
 
 Xwindow::~Xwindow() {
+  if (font) XFreeFontInfo(NULL, font, 1);
+  XFreePixmap(d, buffer);
   XFreeGC(d, gc);
   XCloseDisplay(d);
 }
 
+void Xwindow::setForeground(int colour) {
+  if (colour != foreground) {
+    XSetForeground(d, gc, colours[colour]);
+    foreground = colour;
+  }
+}
+
+void Xwindow::markDirty(int x, int y, int width, int height) {
+  int x2 = x + width, y2 = y + height;
+  if (!dirty) {
+    dirtyX1 = x; dirtyY1 = y; dirtyX2 = x2; dirtyY2 = y2;
+    dirty = true;
+    return;
+  }
+  dirtyX1 = min(dirtyX1, x); dirtyY1 = min(dirtyY1, y);
+  dirtyX2 = max(dirtyX2, x2); dirtyY2 = max(dirtyY2, y2);
+}
+
 void Xwindow::fillRectangle(int x, int y, int width, int height, int colour) {
-  XSetForeground(d, gc, colours[colour]);
-  XFillRectangle(d, w, gc, x, y, width, height);
-  XSetForeground(d, gc, colours[Black]);
+  setForeground(colour);
+  XFillRectangle(d, buffer, gc, x, y, width, height);
+  markDirty(x, y, width, height);
 }
 
-void Xwindow::drawString(int x, int y, string msg) {
-  XDrawString(d, w, DefaultGC(d, s), x, y, msg.c_str(), msg.length());
+void Xwindow::drawString(int x, int y, const string &msg) {
+  setForeground(Black);
+  XDrawString(d, buffer, gc, x, y, msg.c_str(), msg.length());
+  int textWidth = font ? XTextWidth(font, msg.c_str(), msg.length()) : 6 * static_cast<int>(msg.length());
+  markDirty(x, y - fontAscent, textWidth, fontAscent + fontDescent);
 }
 
+void Xwindow::present() {
+  if (dirty) {
+    int x1 = max(dirtyX1, 0), y1 = max(dirtyY1, 0);
+    int x2 = min(dirtyX2, width), y2 = min(dirtyY2, height);
+    if (x2 > x1 && y2 > y1) {
+      XCopyArea(d, buffer, w, gc, x1, y1, x2 - x1, y2 - y1, x1, y1);
+    }
+    dirty = false;
+  }
+  XFlush(d);
+}
 
+void Xwindow::repaint(int x, int y, int width, int height) {
+  XCopyArea(d, buffer, w, gc, x, y, width, height, x, y);
+}
+
+int Xwindow::connection() const {
+  return ConnectionNumber(d);
+}
+
+bool Xwindow::processEvents(int &clickX, int &clickY) {
+  bool exposed = false;
+  while (XPending(d) > 0) {
+    XEvent event;
+    XNextEvent(d, &event);
+    if (event.type == Expose) {
+      repaint(event.xexpose.x, event.xexpose.y, event.xexpose.width, event.xexpose.height);
+      exposed = true;
+    } else if (event.type == ButtonPress) {
+      clickX = event.xbutton.x;
+      clickY = event.xbutton.y;
+      if (exposed) XFlush(d);
+      return true;
+    }
+  }
+  if (exposed) XFlush(d);
+  return false;
+}
@@ -8,28 +8,66 @@ import <string>;
 export inline constexpr int XWIN_WIDTH = 500;
 export inline constexpr int XWIN_HEIGHT = 650;
 
-export class Xwindow {
+// Surface is anything XView can draw on: an X window, or an in-memory image for batch rendering
+export class Surface {
+ public:
+  virtual ~Surface() = default;
+
+  // Available colours.
+  enum {White=0, Black, Red, Green, Blue, Cyan, Yellow, Magenta, Orange, Brown};
+
+  // Draws a rectangle
+  virtual void fillRectangle(int x, int y, int width, int height, int colour=Black) = 0;
+
+  // Draws a string in black with its baseline at y
+  virtual void drawString(int x, int y, const std::string &msg) = 0;
+
+  // Makes everything drawn so far visible
+  virtual void present() = 0;
+};
+
+// Xwindow draws into an off-screen Pixmap; present() copies the changed area to the window
+//  * requests are batched by Xlib and sent with one XFlush per present()
+export class Xwindow : public Surface {
   Display *d;
   Window w;
   int s;
   GC gc;
+  Pixmap buffer;
+  int width, height;
   unsigned long colours[10];
+  int foreground;              // colour currently set on gc, avoids redundant XSetForeground
+  int fontAscent, fontDescent;
+  XFontStruct *font;
+  bool dirty;                  // dirty rectangle since the last present()
+  int dirtyX1, dirtyY1, dirtyX2, dirtyY2;
+
+  void setForeground(int colour);
+  void markDirty(int x, int y, int width, int height);
 
  public:
   Xwindow(int width=XWIN_WIDTH, int height=XWIN_HEIGHT);  // Constructor; displays the window.
-  ~Xwindow();                              // Destructor; destroys the window.
+  ~Xwindow() override;                     // Destructor; destroys the window.
   Xwindow(const Xwindow&) = delete;
   Xwindow &operator=(const Xwindow&) = delete;
 
-  // Available colours.
-  enum {White=0, Black, Red, Green, Blue, Cyan, Yellow, Magenta, Orange, Brown};
-
   // Draws a rectangle
-  void fillRectangle(int x, int y, int width, int height, int colour=Black);
+  void fillRectangle(int x, int y, int width, int height, int colour=Black) override;
 
   // Draws a string
-  void drawString(int x, int y, std::string msg);
+  void drawString(int x, int y, const std::string &msg) override;
 
-};
+  // Copies everything drawn since the last call to the window and flushes once
+  void present() override;
+
+  // Copies a region of the back buffer to the window again, e.g. after an Expose
+  void repaint(int x, int y, int width, int height);
 
+  // File descriptor of the X connection, for poll
+  int connection() const;
 
+  // Handles every queued event without blocking; Expose is answered from the back buffer
+  // Returns true with the position when a mouse button was pressed, later events stay queued
+  bool processEvents(int &clickX, int &clickY);
+
+};
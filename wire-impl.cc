@@ -0,0 +1,778 @@
+module;
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+
+module wire;
+
+import <string>;
+import <vector>;
+import types;
+import board;
+import link;
+import player;
+import game;
+import errors;
+
+using namespace std;
+
+// delta item opcodes, the high nibble of an item's first byte; the low nibble is a link index unless noted
+static const unsigned char OpMoved = 0;       // + square
+static const unsigned char OpSwapped = 1;     // + other link
+static const unsigned char OpDownloaded = 2;  // + receiver | cause << 1
+static const unsigned char OpRevealed = 3;    // + virus << 3 | strength
+static const unsigned char OpFirewall = 4;    // low nibble owner, + square
+static const unsigned char OpBoosted = 5;
+static const unsigned char OpPolarized = 6;
+static const unsigned char OpShielded = 7;
+static const unsigned char OpTurn = 8;        // low nibble player
+static const unsigned char OpAbilityUsed = 9; // low nibble player * 8 + slot, slot 7 when it is not the viewer's card
+static const unsigned char OpBattle = 10;     // + other | attacker won << 4 | shield used << 5
+static const unsigned char OpGameOver = 11;   // low nibble winner
+
+// link flag bits in a snapshot
+static const unsigned char FlagAlive = 1;
+static const unsigned char FlagKnown = 2;
+static const unsigned char FlagVirus = 4;
+static const unsigned char FlagBoosted = 8;
+static const unsigned char FlagShielded = 16;
+
+static int playerCode(PlayerId id)
+{
+    return id == PlayerId::P1 ? 0 : id == PlayerId::P2 ? 1 : 2;
+}
+
+static PlayerId playerFromCode(int code)
+{
+    return code == 0 ? PlayerId::P1 : code == 1 ? PlayerId::P2 : PlayerId::None;
+}
+
+static char labelFor(int idx)
+{
+    return idx < 8 ? static_cast<char>('a' + idx) : static_cast<char>('A' + idx - 8);
+}
+
+static PlayerId ownerOf(int idx)
+{
+    return idx < 8 ? PlayerId::P1 : PlayerId::P2;
+}
+
+static int square(Position pos)
+{
+    return pos.row * 8 + pos.col;
+}
+
+// ==================== requests ====================
+
+void encodeMove(string &out, char label, Direction dir)
+{
+    out += static_cast<char>(static_cast<int>(WireRequestKind::Move) << 4 | static_cast<int>(dir));
+    out += label;
+}
+
+void encodeAbility(string &out, int slot, bool hasLabel, char label, bool hasPos, Position pos)
+{
+    bool packable = hasPos && pos.row >= 0 && pos.row < 16 && pos.col >= 0 && pos.col < 16;
+    out += static_cast<char>(static_cast<int>(WireRequestKind::Ability) << 4 | slot);
+    out += hasLabel ? label : static_cast<char>(WireNoArg);
+    out += static_cast<char>(packable ? pos.row * 16 + pos.col : WireNoArg);
+}
+
+void encodeResync(string &out)
+{
+    out += static_cast<char>(static_cast<int>(WireRequestKind::Resync) << 4);
+}
+
+void encodeQuit(string &out)
+{
+    out += static_cast<char>(static_cast<int>(WireRequestKind::Quit) << 4);
+}
+
+size_t decodeRequest(const char *data, size_t size, WireRequest &out)
+{
+    if (size == 0)
+    {
+        return 0;
+    }
+
+    const unsigned char *p = reinterpret_cast<const unsigned char *>(data);
+    int kind = p[0] >> 4;
+    int low = p[0] & 0x0f;
+    out = WireRequest{static_cast<WireRequestKind>(kind), 0, Direction::Up, 0, false, false, Position{0, 0}};
+
+    switch (static_cast<WireRequestKind>(kind))
+    {
+    case WireRequestKind::Move:
+        if (low > static_cast<int>(Direction::Right))
+        {
+            throw ParseError("bad direction in move request");
+        }
+        if (size < 2)
+        {
+            return 0;
+        }
+        out.dir = static_cast<Direction>(low);
+        out.label = static_cast<char>(p[1]);
+        return 2;
+    case WireRequestKind::Ability:
+        if (low >= 5)
+        {
+            throw ParseError("bad card slot in ability request");
+        }
+        if (size < 3)
+        {
+            return 0;
+        }
+        out.slot = low;
+        out.hasLabel = p[1] != WireNoArg;
+        out.label = static_cast<char>(p[1]);
+        out.hasPos = p[2] != WireNoArg;
+        out.pos = Position{p[2] / 16, p[2] % 16};
+        return 3;
+    case WireRequestKind::Resync:
+    case WireRequestKind::Quit:
+        return 1;
+    default:
+        throw ParseError("unknown request kind " + to_string(kind));
+    }
+}
+
+void encodeError(string &out, WireError error)
+{
+    out += static_cast<char>(WireErrorFrame | static_cast<unsigned char>(error));
+}
+
+// ==================== state ====================
+
+WireState wireState(const Game &game, PlayerId viewer)
+{
+    WireState s{};
+    shared_ptr<const Projection> seen = game.projection(viewer);
+
+    s.viewer = viewer;
+    s.current = game.currentPlayer();
+    s.winner = game.winner();
+
+    for (int i = 0; i < 16; ++i)
+    {
+        s.links[i] = seen->links[i];
+        const Link &lnk = game.getLink(i);
+        bool own = lnk.getOwner() == viewer && lnk.isAlive();
+        s.boosted[i] = own && lnk.isBoosted();
+        s.shielded[i] = own && lnk.isShielded();
+    }
+
+    for (int sq = 0; sq < 64; ++sq)
+    {
+        s.linkAt[sq] = seen->linkAt[sq];
+        const Cell &cell = game.board().at(Position{sq / 8, sq % 8});
+        s.firewalls[sq] = cell.firewallPresent() ? static_cast<unsigned char>(playerCode(cell.getFirewallOwner()) + 1) : 0;
+    }
+
+    for (int p = 0; p < 2; ++p)
+    {
+        const PlayerState &ps = game.getPlayer(playerFromCode(p));
+        s.downloads[p * 2] = ps.getDownloadedData();
+        s.downloads[p * 2 + 1] = ps.getDownloadedVirus();
+        s.abilitiesLeft[p] = game.getAbilities(playerFromCode(p)).remaining();
+    }
+
+    const PlayerAbilities &own = game.getAbilities(viewer);
+    for (int slot = 0; slot < 5; ++slot)
+    {
+        s.abilityCodes[slot] = own.abilityAt(slot).code();
+        s.abilityUsed[slot] = own.isUsed(slot);
+    }
+    return s;
+}
+
+bool sameState(const WireState &a, const WireState &b)
+{
+    if (a.viewer != b.viewer || a.current != b.current || a.winner != b.winner)
+    {
+        return false;
+    }
+    for (int i = 0; i < 16; ++i)
+    {
+        const LinkView &x = a.links[i];
+        const LinkView &y = b.links[i];
+        if (x.label != y.label || x.alive != y.alive || x.known != y.known || x.kind != y.kind ||
+            x.strength != y.strength || x.pos.row != y.pos.row || x.pos.col != y.pos.col ||
+            a.boosted[i] != b.boosted[i] || a.shielded[i] != b.shielded[i])
+        {
+            return false;
+        }
+    }
+    for (int sq = 0; sq < 64; ++sq)
+    {
+        if (a.linkAt[sq] != b.linkAt[sq] || a.firewalls[sq] != b.firewalls[sq])
+        {
+            return false;
+        }
+    }
+    for (int i = 0; i < 5; ++i)
+    {
+        if (a.abilityCodes[i] != b.abilityCodes[i] || a.abilityUsed[i] != b.abilityUsed[i])
+        {
+            return false;
+        }
+    }
+    return a.downloads[0] == b.downloads[0] && a.downloads[1] == b.downloads[1] &&
+           a.downloads[2] == b.downloads[2] && a.downloads[3] == b.downloads[3] &&
+           a.abilitiesLeft[0] == b.abilitiesLeft[0] && a.abilitiesLeft[1] == b.abilitiesLeft[1];
+}
+
+// snapshot layout after the type byte:
+//  * current | winner << 2, then per link its square (or NoArg) and flags | strength << 5
+//  * firewall owners at 2 bits per square, the four download counts, the viewer's five card codes,
+//    the viewer's used cards as bits, and the remaining card counts as two nibbles
+void encodeSnapshot(string &out, const WireState &s)
+{
+    out += static_cast<char>(WireSnapshot | playerCode(s.viewer));
+    out += static_cast<char>(playerCode(s.current) | playerCode(s.winner) << 2);
+
+    for (int i = 0; i < 16; ++i)
+    {
+        const LinkView &v = s.links[i];
+        unsigned char flags = 0;
+        flags |= v.alive ? FlagAlive : 0;
+        flags |= v.known ? FlagKnown : 0;
+        flags |= (v.known && v.kind == LinkKind::Virus) ? FlagVirus : 0;
+        flags |= s.boosted[i] ? FlagBoosted : 0;
+        flags |= s.shielded[i] ? FlagShielded : 0;
+        out += static_cast<char>(v.pos.row >= 0 ? square(v.pos) : WireNoArg);
+        out += static_cast<char>(flags | v.strength << 5);
+    }
+
+    for (int sq = 0; sq < 64; sq += 4)
+    {
+        out += static_cast<char>(s.firewalls[sq] | s.firewalls[sq + 1] << 2 | s.firewalls[sq + 2] << 4 |
+                                 s.firewalls[sq + 3] << 6);
+    }
+
+    for (int i = 0; i < 4; ++i)
+    {
+        out += static_cast<char>(s.downloads[i]);
+    }
+
+    unsigned char used = 0;
+    for (int slot = 0; slot < 5; ++slot)
+    {
+        out += s.abilityCodes[slot];
+        used |= s.abilityUsed[slot] ? 1 << slot : 0;
+    }
+    out += static_cast<char>(used);
+    out += static_cast<char>(s.abilitiesLeft[0] | s.abilitiesLeft[1] << 4);
+}
+
+// decodeSnapshot reads a whole snapshot frame, the type byte included
+static WireState decodeSnapshot(const unsigned char *p)
+{
+    WireState s{};
+    s.viewer = playerFromCode(p[0] & 0x0f);
+    s.current = playerFromCode(p[1] & 3);
+    s.winner = playerFromCode(p[1] >> 2);
+
+    for (int sq = 0; sq < 64; ++sq)
+    {
+        s.linkAt[sq] = -1;
+    }
+
+    const unsigned char *q = p + 2;
+    for (int i = 0; i < 16; ++i, q += 2)
+    {
+        LinkView &v = s.links[i];
+        v.label = labelFor(i);
+        v.alive = (q[1] & FlagAlive) != 0;
+        v.known = (q[1] & FlagKnown) != 0;
+        v.kind = (q[1] & FlagVirus) ? LinkKind::Virus : LinkKind::Data;
+        v.strength = q[1] >> 5;
+        v.pos = Position{-1, -1};
+        if (q[0] != WireNoArg)
+        {
+            v.pos = Position{q[0] / 8, q[0] % 8};
+            s.linkAt[q[0]] = static_cast<signed char>(i);
+        }
+        s.boosted[i] = (q[1] & FlagBoosted) != 0;
+        s.shielded[i] = (q[1] & FlagShielded) != 0;
+    }
+
+    for (int sq = 0; sq < 64; ++sq)
+    {
+        s.firewalls[sq] = (q[sq / 4] >> (sq % 4 * 2)) & 3;
+    }
+    q += 16;
+
+    for (int i = 0; i < 4; ++i)
+    {
+        s.downloads[i] = q[i];
+    }
+    q += 4;
+
+    for (int slot = 0; slot < 5; ++slot)
+    {
+        s.abilityCodes[slot] = static_cast<char>(q[slot]);
+        s.abilityUsed[slot] = (q[5] >> slot) & 1;
+    }
+    s.abilitiesLeft[0] = q[6] & 0x0f;
+    s.abilitiesLeft[1] = q[6] >> 4;
+    return s;
+}
+
+// ==================== WireEncoder ====================
+
+WireEncoder::WireEncoder(const Game &game, PlayerId viewer) : game{game},
+                                                               viewer{viewer},
+                                                               items{},
+                                                               stale{true},
+                                                               overSent{false}
+{
+    items.reserve(64);
+}
+
+void WireEncoder::item(unsigned char op, int low)
+{
+    items.push_back(static_cast<unsigned char>(op << 4 | low));
+}
+
+void WireEncoder::item(unsigned char op, int low, int arg)
+{
+    items.push_back(static_cast<unsigned char>(op << 4 | low));
+    items.push_back(static_cast<unsigned char>(arg));
+}
+
+// onGameEvent keeps only what the viewer can see: their own reveals, and boosts and shields on their own links
+void WireEncoder::onGameEvent(const GameEvent &e)
+{
+    if (stale)
+    {
+        // the next flush sends the whole state anyway
+        return;
+    }
+
+    switch (e.kind)
+    {
+    case GameEventKind::Moved:
+        item(OpMoved, e.link, square(e.to));
+        break;
+    case GameEventKind::Swapped:
+        item(OpSwapped, e.link, e.other);
+        break;
+    case GameEventKind::Battle:
+        item(OpBattle, e.link, e.other | (e.attackerWon ? 16 : 0) | (e.shieldUsed ? 32 : 0));
+        break;
+    case GameEventKind::Downloaded:
+        item(OpDownloaded, e.link, playerCode(e.player) | static_cast<int>(e.cause) << 1);
+        if (!overSent && game.winner() != PlayerId::None)
+        {
+            item(OpGameOver, playerCode(game.winner()));
+            overSent = true;
+        }
+        break;
+    case GameEventKind::Revealed:
+        if (e.player == viewer)
+        {
+            const Link &lnk = game.getLink(e.link);
+            item(OpRevealed, e.link, (lnk.getKind() == LinkKind::Virus ? 8 : 0) | lnk.getStrength());
+        }
+        break;
+    case GameEventKind::FirewallPlaced:
+        item(OpFirewall, playerCode(e.player), square(e.to));
+        break;
+    case GameEventKind::Boosted:
+        if (ownerOf(e.link) == viewer)
+        {
+            item(OpBoosted, e.link);
+        }
+        break;
+    case GameEventKind::Polarized:
+        if (ownerOf(e.link) == viewer || game.getLink(e.link).isKnownBy(viewer))
+        {
+            item(OpPolarized, e.link);
+        }
+        break;
+    case GameEventKind::Shielded:
+        if (ownerOf(e.link) == viewer)
+        {
+            item(OpShielded, e.link);
+        }
+        break;
+    case GameEventKind::TurnChanged:
+        item(OpTurn, playerCode(e.player));
+        break;
+    case GameEventKind::Reset:
+        stale = true;
+        items.clear();
+        break;
+    }
+}
+
+void WireEncoder::abilityUsed(PlayerId user, int slot)
+{
+    if (!stale)
+    {
+        item(OpAbilityUsed, playerCode(user) * 8 + (user == viewer ? slot : 7));
+    }
+}
+
+void WireEncoder::resync()
+{
+    stale = true;
+    items.clear();
+}
+
+void WireEncoder::flush(string &out)
+{
+    // a single request produces a few dozen bytes at most, a snapshot covers anything larger
+    if (stale || items.size() > 255)
+    {
+        encodeSnapshot(out, wireState(game, viewer));
+        items.clear();
+        stale = false;
+        overSent = game.winner() != PlayerId::None;
+        return;
+    }
+
+    out += static_cast<char>(WireDelta | playerCode(viewer));
+    out += static_cast<char>(items.size());
+    out.append(reinterpret_cast<const char *>(items.data()), items.size());
+    items.clear();
+}
+
+// ==================== WireMirror ====================
+
+// applyDelta replays delta items onto a state with the same effects the game had
+static void applyDelta(WireState &s, const unsigned char *p, size_t size)
+{
+    size_t i = 0;
+    while (i < size)
+    {
+        int op = p[i] >> 4;
+        int low = p[i] & 0x0f;
+        bool hasArg = op == OpMoved || op == OpSwapped || op == OpDownloaded || op == OpRevealed ||
+                      op == OpFirewall || op == OpBattle;
+        if (hasArg && i + 1 >= size)
+        {
+            throw ParseError("truncated delta item");
+        }
+        int arg = hasArg ? p[i + 1] : 0;
+        i += hasArg ? 2 : 1;
+
+        LinkView &lnk = s.links[low];
+        switch (op)
+        {
+        case OpMoved:
+            if (lnk.pos.row >= 0)
+            {
+                s.linkAt[square(lnk.pos)] = -1;
+            }
+            lnk.pos = Position{arg / 8, arg % 8};
+            s.linkAt[arg] = static_cast<signed char>(low);
+            break;
+        case OpSwapped:
+        {
+            LinkView &other = s.links[arg & 0x0f];
+            Position at = lnk.pos;
+            lnk.pos = other.pos;
+            other.pos = at;
+            s.linkAt[square(lnk.pos)] = static_cast<signed char>(low);
+            s.linkAt[square(other.pos)] = static_cast<signed char>(arg & 0x0f);
+            break;
+        }
+        case OpBattle:
+            if (arg & 32)
+            {
+                // the shield that flipped the result belonged to whoever would have lost
+                s.shielded[(arg & 16) ? low : (arg & 0x0f)] = false;
+            }
+            break;
+        case OpDownloaded:
+            if (lnk.pos.row >= 0)
+            {
+                s.linkAt[square(lnk.pos)] = -1;
+            }
+            lnk.pos = Position{-1, -1};
+            lnk.alive = false;
+            s.boosted[low] = false;
+            s.shielded[low] = false;
+            ++s.downloads[(arg & 1) * 2 + (lnk.kind == LinkKind::Virus ? 1 : 0)];
+            break;
+        case OpRevealed:
+            lnk.known = true;
+            lnk.kind = (arg & 8) ? LinkKind::Virus : LinkKind::Data;
+            lnk.strength = arg & 7;
+            break;
+        case OpFirewall:
+            s.firewalls[arg] = static_cast<unsigned char>(low + 1);
+            break;
+        case OpBoosted:
+            s.boosted[low] = true;
+            break;
+        case OpPolarized:
+            if (lnk.known)
+            {
+                lnk.kind = lnk.kind == LinkKind::Data ? LinkKind::Virus : LinkKind::Data;
+            }
+            break;
+        case OpShielded:
+            s.shielded[low] = true;
+            break;
+        case OpTurn:
+            s.current = playerFromCode(low);
+            break;
+        case OpAbilityUsed:
+            --s.abilitiesLeft[low / 8];
+            if (playerFromCode(low / 8) == s.viewer)
+            {
+                s.abilityUsed[low % 8] = true;
+            }
+            break;
+        case OpGameOver:
+            s.winner = playerFromCode(low);
+            break;
+        default:
+            throw ParseError("unknown delta item " + to_string(op));
+        }
+    }
+}
+
+WireMirror::WireMirror() : states{},
+                           snapshot{},
+                           seen{false, false},
+                           last{0}
+{
+}
+
+size_t WireMirror::apply(const char *data, size_t size)
+{
+    if (size == 0)
+    {
+        return 0;
+    }
+
+    const unsigned char *p = reinterpret_cast<const unsigned char *>(data);
+    int type = p[0] & 0xf0;
+    int low = p[0] & 0x0f;
+
+    if (type == WireErrorFrame)
+    {
+        last = p[0];
+        return 1;
+    }
+    if ((type != WireSnapshot && type != WireDelta) || low > 1)
+    {
+        throw ParseError("unknown frame type " + to_string(p[0]));
+    }
+
+    if (type == WireSnapshot)
+    {
+        if (size < WireSnapshotSize)
+        {
+            return 0;
+        }
+        snapshot = decodeSnapshot(p);
+        states[low] = snapshot;
+        seen[low] = true;
+        last = p[0];
+        return WireSnapshotSize;
+    }
+
+    if (size < 2 || size < 2u + p[1])
+    {
+        return 0;
+    }
+    if (!seen[low])
+    {
+        throw ParseError("delta before snapshot");
+    }
+    applyDelta(states[low], p + 2, p[1]);
+    last = p[0];
+    return 2u + p[1];
+}
+
+const WireState &WireMirror::state(PlayerId viewer) const
+{
+    return states[viewer == PlayerId::P2 ? 1 : 0];
+}
+
+bool WireMirror::ready() const
+{
+    return seen[0] && seen[1];
+}
+
+unsigned char WireMirror::lastFrame() const
+{
+    return last;
+}
+
+const WireState &WireMirror::lastSnapshot() const
+{
+    return snapshot;
+}
+
+// ==================== WireClient ====================
+
+WireClient::WireClient(const string &unixPath, int port) : fd{-1},
+                                                           mirror{},
+                                                           request{},
+                                                           in{},
+                                                           sent{0},
+                                                           received{0}
+{
+    if (unixPath.empty())
+    {
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(static_cast<unsigned short>(port));
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd >= 0 && ::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) == 0)
+        {
+            int one = 1;
+            ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        }
+        else
+        {
+            string msg = string{"could not connect to port "} + to_string(port) + ": " + strerror(errno);
+            ::close(fd);
+            throw FatalError(msg);
+        }
+    }
+    else
+    {
+        sockaddr_un addr{};
+        if (unixPath.size() >= sizeof(addr.sun_path))
+        {
+            throw ParseError("socket path too long: " + unixPath);
+        }
+        addr.sun_family = AF_UNIX;
+        memcpy(addr.sun_path, unixPath.c_str(), unixPath.size() + 1);
+        fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0 || ::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0)
+        {
+            string msg = "could not connect to " + unixPath + ": " + strerror(errno);
+            ::close(fd);
+            throw FatalError(msg);
+        }
+    }
+
+    request.reserve(8);
+    in.reserve(256);
+    if ((readFrame() & 0xf0) == WireErrorFrame)
+    {
+        ::close(fd);
+        throw FatalError("server is full");
+    }
+    readFrame();
+}
+
+WireClient::~WireClient()
+{
+    if (fd >= 0)
+    {
+        ::close(fd);
+    }
+}
+
+// readFrame receives until the mirror can apply one whole frame and returns its type byte
+unsigned char WireClient::readFrame()
+{
+    while (true)
+    {
+        size_t used = mirror.apply(in.data(), in.size());
+        if (used > 0)
+        {
+            in.erase(0, used);
+            return mirror.lastFrame();
+        }
+
+        char buf[512];
+        ssize_t got = ::recv(fd, buf, sizeof(buf), 0);
+        if (got < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (got <= 0)
+        {
+            throw FatalError("server closed the connection");
+        }
+        in.append(buf, static_cast<size_t>(got));
+        received += static_cast<unsigned long long>(got);
+    }
+}
+
+// exchange sends the pending request and reads its reply: one error frame, or a frame for each viewer
+WireError WireClient::exchange()
+{
+    size_t done = 0;
+    while (done < request.size())
+    {
+        ssize_t put = ::send(fd, request.data() + done, request.size() - done, MSG_NOSIGNAL);
+        if (put < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (put <= 0)
+        {
+            throw FatalError("server closed the connection");
+        }
+        done += static_cast<size_t>(put);
+    }
+    sent += request.size();
+    request.clear();
+
+    unsigned char first = readFrame();
+    if ((first & 0xf0) == WireErrorFrame)
+    {
+        return static_cast<WireError>(first & 0x0f);
+    }
+    readFrame();
+    return WireError::Ok;
+}
+
+WireError WireClient::move(char label, Direction dir)
+{
+    encodeMove(request, label, dir);
+    return exchange();
+}
+
+WireError WireClient::ability(int slot, bool hasLabel, char label, bool hasPos, Position pos)
+{
+    encodeAbility(request, slot, hasLabel, label, hasPos, pos);
+    return exchange();
+}
+
+WireError WireClient::resync()
+{
+    encodeResync(request);
+    return exchange();
+}
+
+void WireClient::quit()
+{
+    encodeQuit(request);
+    ::send(fd, request.data(), request.size(), MSG_NOSIGNAL);
+    sent += request.size();
+    request.clear();
+}
+
+const WireState &WireClient::state(PlayerId viewer) const
+{
+    return mirror.state(viewer);
+}
+
+unsigned long long WireClient::bytesSent() const
+{
+    return sent;
+}
+
+unsigned long long WireClient::bytesReceived() const
+{
+    return received;
+}
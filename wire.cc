@@ -0,0 +1,192 @@
+export module wire;
+
+import <string>;
+import <vector>;
+import types;
+import game;
+
+using namespace std;
+
+// The binary game protocol, for programs that play over a socket
+//  * requests are 1 to 3 bytes: the high nibble of the first byte is the request kind
+//  * every request is answered by exactly one error frame, or by one frame per viewer, P1's first
+//  * a delta frame carries what changed for one viewer since its last frame, derived from game events,
+//    and never anything that viewer could not see on the board
+//  * a snapshot frame carries a viewer's whole state; it is sent on connect, on request and after a reset
+
+// WireRequestKind is the high nibble of a request's first byte
+export enum class WireRequestKind : unsigned char
+{
+    Move = 1,    // low nibble direction, then the link label
+    Ability = 2, // low nibble card slot 0..4, then a link label or NoArg, then row * 16 + col or NoArg
+    Resync = 3,  // answered by a snapshot for each viewer
+    Quit = 4     // the server closes the connection once its replies are sent
+};
+
+// WireRequest is a decoded request
+export struct WireRequest
+{
+    WireRequestKind kind;
+    char label;    // move, and ability when hasLabel
+    Direction dir; // move
+    int slot;      // ability, 0 based
+    bool hasLabel;
+    bool hasPos;
+    Position pos;
+};
+
+// WireError is the reason carried by an error frame
+export enum class WireError : unsigned char
+{
+    Ok = 0,          // not sent, WireClient's result for a request that succeeded
+    Malformed = 1,   // malformed request, the server closes the connection after sending it
+    IllegalMove = 2,
+    AbilityRejected = 3,
+    GameOver = 4     // also sent on connect, before closing, when the server is full
+};
+
+// frame types, the low nibble is the viewer (0 for P1) or the error code
+export constexpr unsigned char WireSnapshot = 0x10;
+export constexpr unsigned char WireDelta = 0x20;
+export constexpr unsigned char WireErrorFrame = 0x30;
+export constexpr unsigned char WireNoArg = 0xff;
+
+// snapshots are a fixed size, delta frames are the type, a length byte and at most 255 bytes of items
+export constexpr size_t WireSnapshotSize = 61;
+
+// request encoders append to out
+export void encodeMove(string &out, char label, Direction dir);
+export void encodeAbility(string &out, int slot, bool hasLabel, char label, bool hasPos, Position pos);
+export void encodeResync(string &out);
+export void encodeQuit(string &out);
+
+// decodeRequest reads one request from the front of data
+//  * returns the bytes it used, or 0 when data holds only part of a request
+//  * throws ParseError on an unknown request kind
+export size_t decodeRequest(const char *data, size_t size, WireRequest &out);
+
+// encodeError appends an error frame
+export void encodeError(string &out, WireError error);
+
+// WireState is everything one viewer knows about a game, the state a client rebuilds from frames
+//  * links and linkAt are as in Projection; kind and strength are only set for known links
+//  * boosted and shielded are only tracked for the viewer's own links, the opponent cannot see them
+//  * firewalls is 0 for none, 1 for P1's and 2 for P2's
+export struct WireState
+{
+    PlayerId viewer;
+    PlayerId current;
+    PlayerId winner;
+    LinkView links[16];
+    bool boosted[16];
+    bool shielded[16];
+    signed char linkAt[64];
+    unsigned char firewalls[64];
+    int downloads[4];        // P1 data, P1 virus, P2 data, P2 virus
+    char abilityCodes[5];    // the viewer's own cards
+    bool abilityUsed[5];
+    int abilitiesLeft[2];    // remaining cards for P1 and P2
+};
+
+// wireState builds viewer's state from the game
+export WireState wireState(const Game &game, PlayerId viewer);
+
+// sameState compares two states field by field
+export bool sameState(const WireState &a, const WireState &b);
+
+// encodeSnapshot appends a snapshot frame for state.viewer
+export void encodeSnapshot(string &out, const WireState &state);
+
+// WireEncoder turns one viewer's share of the game events into delta items
+//  * subscribe it to the game; after each request, flush appends the frame for this viewer
+//  * a Reset event makes the next flush send a snapshot instead
+export class WireEncoder : public GameObserver
+{
+public:
+    WireEncoder(const Game &game, PlayerId viewer);
+
+    void onGameEvent(const GameEvent &event) override;
+
+    // abilityUsed records a card use, which the game has no event for; the opponent is not told the slot
+    void abilityUsed(PlayerId user, int slot);
+
+    // flush appends a frame with everything since the last flush, an empty delta when nothing changed
+    void flush(string &out);
+
+    // resync makes the next flush send a snapshot
+    void resync();
+
+private:
+    const Game &game;
+    PlayerId viewer;
+    vector<unsigned char> items;
+    bool stale;
+    bool overSent;
+
+    void item(unsigned char op, int low);
+    void item(unsigned char op, int low, int arg);
+};
+
+// WireMirror is the client side: it applies frames to a WireState per viewer
+export class WireMirror
+{
+public:
+    WireMirror();
+
+    // apply reads one frame from the front of data
+    //  * returns the bytes it used, or 0 when data holds only part of a frame
+    //  * throws ParseError on an unknown frame type or a delta before the viewer's first snapshot
+    size_t apply(const char *data, size_t size);
+
+    const WireState &state(PlayerId viewer) const;
+
+    // ready is true once both viewers have had a snapshot
+    bool ready() const;
+
+    // lastFrame is the type byte of the frame apply last read, lastSnapshot the state it carried if it was a snapshot
+    unsigned char lastFrame() const;
+    const WireState &lastSnapshot() const;
+
+private:
+    WireState states[2];
+    WireState snapshot;
+    bool seen[2];
+    unsigned char last;
+};
+
+// WireClient is a blocking connection to a server's wire socket, the reference client
+//  * it keeps a WireMirror up to date from every frame, so state() is always what the server has sent
+//  * bytesSent and bytesReceived count everything on the wire, snapshots included
+export class WireClient
+{
+public:
+    // WireClient connects to the Unix socket unixPath, or to 127.0.0.1:port when it is empty, and reads the snapshots
+    WireClient(const string &unixPath, int port);
+    ~WireClient();
+
+    WireClient(const WireClient &) = delete;
+    WireClient &operator=(const WireClient &) = delete;
+
+    // move, ability and resync send one request and wait for its reply, returning the error or WireError::Ok
+    WireError move(char label, Direction dir);
+    WireError ability(int slot, bool hasLabel, char label, bool hasPos, Position pos);
+    WireError resync();
+
+    // quit asks the server to end the game and close the connection
+    void quit();
+
+    const WireState &state(PlayerId viewer) const;
+    unsigned long long bytesSent() const;
+    unsigned long long bytesReceived() const;
+
+private:
+    int fd;
+    WireMirror mirror;
+    string request;
+    string in;
+    unsigned long long sent;
+    unsigned long long received;
+
+    WireError exchange();
+    unsigned char readFrame();
+};
@@ -0,0 +1,248 @@
+import <iostream>;
+import <string>;
+import <vector>;
+import <random>;
+import <algorithm>;
+import <exception>;
+
+import types;
+import game;
+import wire;
+import errors;
+
+using namespace std;
+
+// WireClientOptions holds the command line settings for the reference client
+struct WireClientOptions
+{
+    string unixPath;
+    int port;
+    int games;
+    unsigned long long seed;
+    bool abilities; // also try random ability uses
+    bool verify;    // resync after every request and compare the mirror with the snapshot
+    int maxPlies;
+};
+
+static WireClientOptions parseWireClientOptions(int argc, char *argv[])
+{
+    WireClientOptions opts{"", 0, 1, 1, false, false, 1000};
+
+    for (int i = 1; i < argc; ++i)
+    {
+        string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "-unix" && hasValue)
+        {
+            opts.unixPath = argv[++i];
+        }
+        else if (arg == "-port" && hasValue)
+        {
+            opts.port = stoi(argv[++i]);
+        }
+        else if (arg == "-games" && hasValue)
+        {
+            opts.games = stoi(argv[++i]);
+        }
+        else if (arg == "-seed" && hasValue)
+        {
+            opts.seed = stoull(argv[++i]);
+        }
+        else if (arg == "-maxPlies" && hasValue)
+        {
+            opts.maxPlies = stoi(argv[++i]);
+        }
+        else if (arg == "-abilities")
+        {
+            opts.abilities = true;
+        }
+        else if (arg == "-verify")
+        {
+            opts.verify = true;
+        }
+        else
+        {
+            throw ParseError("unknown option " + arg);
+        }
+    }
+
+    if ((opts.unixPath.empty() && opts.port == 0) || opts.games < 1)
+    {
+        throw ParseError("usage: wireclient -unix <path> | -port <n> [-games N] [-seed S] [-abilities] [-verify] "
+                         "[-maxPlies N]");
+    }
+    return opts;
+}
+
+// WireTally counts what the client sent and received, and what for
+struct WireTally
+{
+    long long moves = 0;
+    long long abilities = 0;
+    long long rejected = 0;
+    long long mismatches = 0;
+    unsigned long long moveBytes = 0; // both directions, accepted moves only
+};
+
+// plausibleMoves lists the current player's moves that look legal from what the client has been told
+//  * the server still has the last word, jump and swap cards are not tracked here
+static vector<pair<char, Direction>> plausibleMoves(const WireState &s)
+{
+    vector<pair<char, Direction>> moves;
+    bool p1 = s.current == PlayerId::P1;
+    int first = p1 ? 0 : 8;
+
+    for (int i = first; i < first + 8; ++i)
+    {
+        const LinkView &lnk = s.links[i];
+        if (!lnk.alive || lnk.pos.row < 0)
+        {
+            continue;
+        }
+        int step = s.boosted[i] ? 2 : 1;
+        const int dr[4] = {-1, 1, 0, 0};
+        const int dc[4] = {0, 0, -1, 1};
+        for (int d = 0; d < 4; ++d)
+        {
+            int row = lnk.pos.row + dr[d] * step;
+            int col = lnk.pos.col + dc[d] * step;
+            if (col < 0 || col >= 8)
+            {
+                continue;
+            }
+            if (row < 0 || row >= 8)
+            {
+                // only straight off the far edge
+                if (p1 ? (lnk.pos.row == 7 && dr[d] > 0) : (lnk.pos.row == 0 && dr[d] < 0))
+                {
+                    moves.push_back({lnk.label, static_cast<Direction>(d)});
+                }
+                continue;
+            }
+            bool ownPort = (row == (p1 ? 0 : 7)) && (col == 3 || col == 4);
+            int at = s.linkAt[row * 8 + col];
+            bool ownLink = at >= 0 && (at < 8) == p1;
+            if (!ownPort && !ownLink)
+            {
+                moves.push_back({lnk.label, static_cast<Direction>(d)});
+            }
+        }
+    }
+    return moves;
+}
+
+// verify asks for snapshots and counts a mismatch for each viewer whose mirror disagreed with them
+static void verify(WireClient &client, WireTally &tally)
+{
+    WireState before[2] = {client.state(PlayerId::P1), client.state(PlayerId::P2)};
+    client.resync();
+    for (int v = 0; v < 2; ++v)
+    {
+        if (!sameState(before[v], client.state(v == 0 ? PlayerId::P1 : PlayerId::P2)))
+        {
+            ++tally.mismatches;
+        }
+    }
+}
+
+// playGame plays one game with random moves for both seats, and random card uses if asked to
+static void playGame(const WireClientOptions &opts, mt19937_64 &rng, WireTally &tally)
+{
+    WireClient client{opts.unixPath, opts.port};
+
+    for (int ply = 0; ply < opts.maxPlies; ++ply)
+    {
+        const WireState &s = client.state(PlayerId::P1);
+        if (s.winner != PlayerId::None)
+        {
+            break;
+        }
+
+        if (opts.abilities && rng() % 6 == 0)
+        {
+            const WireState &own = client.state(s.current);
+            int slot = static_cast<int>(rng() % 5);
+            if (!own.abilityUsed[slot])
+            {
+                int target = static_cast<int>(rng() % 16);
+                int sq = static_cast<int>(rng() % 64);
+                char label = target < 8 ? static_cast<char>('a' + target) : static_cast<char>('A' + target - 8);
+                WireError err = client.ability(slot, true, label, true, Position{sq / 8, sq % 8});
+                (err == WireError::Ok ? tally.abilities : tally.rejected) += 1;
+                if (opts.verify)
+                {
+                    verify(client, tally);
+                }
+            }
+        }
+
+        vector<pair<char, Direction>> moves = plausibleMoves(client.state(PlayerId::P1));
+        shuffle(moves.begin(), moves.end(), rng);
+        bool moved = false;
+        for (const pair<char, Direction> &m : moves)
+        {
+            unsigned long long bytes = client.bytesSent() + client.bytesReceived();
+            if (client.move(m.first, m.second) == WireError::Ok)
+            {
+                tally.moveBytes += client.bytesSent() + client.bytesReceived() - bytes;
+                ++tally.moves;
+                moved = true;
+                break;
+            }
+            ++tally.rejected;
+        }
+        if (!moved)
+        {
+            break;
+        }
+        if (opts.verify)
+        {
+            verify(client, tally);
+        }
+    }
+    client.quit();
+}
+
+// main plays games against a server's wire socket and reports the bytes per move
+int main(int argc, char *argv[])
+{
+    try
+    {
+        WireClientOptions opts = parseWireClientOptions(argc, argv);
+        mt19937_64 rng{opts.seed};
+        WireTally tally;
+
+        for (int g = 0; g < opts.games; ++g)
+        {
+            playGame(opts, rng, tally);
+        }
+
+        cout << "games: " << opts.games << ", moves: " << tally.moves << ", abilities: " << tally.abilities
+             << ", rejected: " << tally.rejected << endl;
+        if (tally.moves > 0)
+        {
+            cout << "bytes per move: " << static_cast<double>(tally.moveBytes) / static_cast<double>(tally.moves)
+                 << endl;
+        }
+        if (opts.verify)
+        {
+            cout << "mirror mismatches: " << tally.mismatches << endl;
+        }
+        return tally.mismatches == 0 ? 0 : 1;
+    }
+    catch (const ParseError &e)
+    {
+        cerr << "Command line error: " << e.message() << endl;
+        return 1;
+    }
+    catch (const RaiiError &e)
+    {
+        cerr << "wireclient error: " << e.message() << endl;
+        return 1;
+    }
+    catch (const exception &e)
+    {
+        cerr << "Unexpected standard exception: " << e.what() << endl;
+        return 1;
+    }
+}